@@ -272,13 +272,20 @@ int afuc_util_init(int gpuver, bool colors)
    }
 
    rnn_init();
-   db = rnn_newdb();
+
+   /* prefer the built in database, unless overridden with RNN_PATH: */
+   if (!getenv("RNN_PATH"))
+      db = rnn_builtin_db("adreno.xml");
+
+   if (!db) {
+      db = rnn_newdb();
+      rnn_parsefile(db, "adreno.xml");
+      rnn_prepdb(db);
+   }
 
    ctx = rnndec_newcontext(db);
    ctx->colors = colors ? &envy_def_colors : &envy_null_colors;
 
-   rnn_parsefile(db, "adreno.xml");
-   rnn_prepdb(db);
    if (db->estatus)
       errx(db->estatus, "failed to parse register database");
    dom[0] = rnn_finddomain(db, name);
@@ -0,0 +1,137 @@
+#
+# Copyright © 2026 agent <agent@local>
+#
+# Permission is hereby granted, free of charge, to any person obtaining a
+# copy of this software and associated documentation files (the "Software"),
+# to deal in the Software without restriction, including without limitation
+# the rights to use, copy, modify, merge, publish, distribute, sublicense,
+# and/or sell copies of the Software, and to permit persons to whom the
+# Software is furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice (including the next
+# paragraph) shall be included in all copies or substantial portions of the
+# Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+# THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+# FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+# IN THE SOFTWARE.
+
+"""
+Runs a decoder for the meson benchmark() suite, measuring its wall/cpu
+time, peak RSS, the number (and total size) of allocations and the number
+of reallocations, summed over the decoder and any children it forks, and
+the bytes of output.  The results are printed, and appended as a line of JSON to the
+--report file, ie:
+
+  {"name": "cffdump-default", "wall_s": 3.2, "user_s": 3.1, "sys_s": 0.04,
+   "peak_rss_kib": 21424, "allocs": 106203, "alloc_bytes": 41207821,
+   "reallocs": 5342, "output_bytes": 35212094, "status": 0, "cmd": [...]}
+
+allocs, alloc_bytes and reallocs are only known when the --alloc-lib
+preload library can be used, and are null otherwise.
+"""
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+
+def run(args):
+    env = dict(os.environ)
+    allocfile = None
+    if args.alloc_lib:
+        fd, allocfile = tempfile.mkstemp(prefix='fd-bench-')
+        os.close(fd)
+        preload = [args.alloc_lib]
+        if env.get('LD_PRELOAD'):
+            preload.append(env['LD_PRELOAD'])
+        env['LD_PRELOAD'] = ' '.join(preload)
+        env['FD_BENCH_ALLOC_OUT'] = allocfile
+
+    start = time.monotonic()
+    proc = subprocess.Popen(args.cmd, stdout=subprocess.PIPE, env=env)
+
+    output_bytes = 0
+    while True:
+        chunk = proc.stdout.read(1 << 16)
+        if not chunk:
+            break
+        output_bytes += len(chunk)
+
+    # wait4() rather than proc.wait(), for the rusage of just this child:
+    _, status, rusage = os.wait4(proc.pid, 0)
+    proc.returncode = status
+    wall = time.monotonic() - start
+
+    allocs = alloc_bytes = reallocs = None
+    if allocfile:
+        # a line per process:
+        with open(allocfile) as f:
+            lines = [line.split() for line in f]
+        os.unlink(allocfile)
+        lines = [counts for counts in lines if len(counts) == 3]
+        if lines:
+            allocs, alloc_bytes, reallocs = \
+                [sum(int(counts[i]) for counts in lines) for i in range(3)]
+
+    if os.WIFEXITED(status):
+        status = os.WEXITSTATUS(status)
+    else:
+        status = -os.WTERMSIG(status)
+
+    return {
+        'name': args.name,
+        'wall_s': round(wall, 3),
+        'user_s': round(rusage.ru_utime, 3),
+        'sys_s': round(rusage.ru_stime, 3),
+        'peak_rss_kib': rusage.ru_maxrss,
+        'allocs': allocs,
+        'alloc_bytes': alloc_bytes,
+        'reallocs': reallocs,
+        'output_bytes': output_bytes,
+        'status': status,
+        'cmd': args.cmd,
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--name', required=True,
+                        help='name of the benchmark, for the report')
+    parser.add_argument('--report',
+                        help='file to append the results to, as a line of JSON')
+    parser.add_argument('--alloc-lib',
+                        help='preload library to count allocations with')
+    parser.add_argument('cmd', nargs=argparse.REMAINDER,
+                        help='the command to benchmark, after --')
+    args = parser.parse_args()
+
+    if args.cmd and args.cmd[0] == '--':
+        args.cmd = args.cmd[1:]
+    if not args.cmd:
+        parser.error('no command given')
+
+    result = run(args)
+    line = json.dumps(result)
+    print(line)
+
+    if args.report:
+        os.makedirs(os.path.dirname(os.path.abspath(args.report)),
+                    exist_ok=True)
+        with open(args.report, 'a') as f:
+            f.write(line + '\n')
+
+    # a decoder which fails is a failed benchmark, not a fast one:
+    return 0 if result['status'] == 0 else 1
+
+
+if __name__ == '__main__':
+    sys.exit(main())
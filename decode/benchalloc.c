@@ -0,0 +1,147 @@
+/*
+ * Copyright © 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * LD_PRELOAD library for the decoder benchmarks (see bench.py), which
+ * counts the allocations made by the process, and the bytes requested,
+ * and (separately) the reallocations, and appends them as a line to
+ * $FD_BENCH_ALLOC_OUT at exit.  Each process (ie. forked children too)
+ * appends its own line, which bench.py sums.  The allocations are passed
+ * through to glibc's malloc.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t nmemb, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+
+static uint64_t nallocs, nbytes, nreallocs;
+
+static inline void
+count(size_t size)
+{
+   /* the decoders load register databases from multiple threads: */
+   __atomic_fetch_add(&nallocs, 1, __ATOMIC_RELAXED);
+   __atomic_fetch_add(&nbytes, size, __ATOMIC_RELAXED);
+}
+
+/* a forked child only reports its own allocations: */
+static void
+reset_counts(void)
+{
+   nallocs = nbytes = nreallocs = 0;
+}
+
+static void __attribute__((constructor))
+init(void)
+{
+   pthread_atfork(NULL, NULL, reset_counts);
+}
+
+void *
+malloc(size_t size)
+{
+   count(size);
+   return __libc_malloc(size);
+}
+
+void *
+calloc(size_t nmemb, size_t size)
+{
+   count(nmemb * size);
+   return __libc_calloc(nmemb, size);
+}
+
+void *
+realloc(void *ptr, size_t size)
+{
+   /* resizing isn't a new allocation: */
+   if (ptr)
+      __atomic_fetch_add(&nreallocs, 1, __ATOMIC_RELAXED);
+   else
+      count(size);
+   return __libc_realloc(ptr, size);
+}
+
+void *
+memalign(size_t alignment, size_t size)
+{
+   count(size);
+   return __libc_memalign(alignment, size);
+}
+
+void *
+aligned_alloc(size_t alignment, size_t size)
+{
+   return memalign(alignment, size);
+}
+
+int
+posix_memalign(void **memptr, size_t alignment, size_t size)
+{
+   void *ptr = memalign(alignment, size);
+   if (!ptr)
+      return ENOMEM;
+   *memptr = ptr;
+   return 0;
+}
+
+static void __attribute__((destructor))
+report(void)
+{
+   const char *path = getenv("FD_BENCH_ALLOC_OUT");
+   static const char error[] = "could not write $FD_BENCH_ALLOC_OUT\n";
+   char buf[96];
+   int fd, len;
+
+   if (!path)
+      return;
+
+   /* avoid stdio, which would allocate, and write the line in one go, so
+    * that the lines of each process don't get mixed up:
+    */
+   fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+   if (fd < 0)
+      return;
+
+   len = snprintf(buf, sizeof(buf), "%" PRIu64 " %" PRIu64 " %" PRIu64 "\n",
+                  __atomic_load_n(&nallocs, __ATOMIC_RELAXED),
+                  __atomic_load_n(&nbytes, __ATOMIC_RELAXED),
+                  __atomic_load_n(&nreallocs, __ATOMIC_RELAXED));
+   if (write(fd, buf, len) != len) {
+      if (write(STDERR_FILENO, error, sizeof(error) - 1) < 0) {
+         /* nothing more to be done */
+      }
+   }
+   close(fd);
+}
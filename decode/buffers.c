@@ -30,32 +30,33 @@
 #include <stdlib.h>
 
 #include "util/rb_tree.h"
+#include "util/u64_map.h"
 #include "buffers.h"
+#include "profile.h"
 
 struct buffer {
    struct rb_node node;
    void *hostptr;
    unsigned int len;
    uint64_t gpuaddr;
-
-   /* for 'once' mode, for buffers containing cmdstream keep track per offset
-    * into buffer of which modes it has already been dumped;
-    */
-   struct {
-      unsigned offset;
-      unsigned dumped_mask;
-   } offsets[64];
-   unsigned noffsets;
 };
 
 static struct rb_tree buffers;
 
+/* for 'once' mode, for cmdstream keep track per address of which modes it
+ * has already been dumped in:
+ */
+static struct u64_map dumped;
+
 static int
 buffer_insert_cmp(const struct rb_node *n1, const struct rb_node *n2)
 {
    const struct buffer *buf1 = (const struct buffer *)n1;
    const struct buffer *buf2 = (const struct buffer *)n2;
-   return buf1->gpuaddr - buf2->gpuaddr;
+   /* note, the difference of the addresses may not fit in an int: */
+   if (buf1->gpuaddr < buf2->gpuaddr)
+      return -1;
+   return buf1->gpuaddr > buf2->gpuaddr;
 }
 
 static int
@@ -73,10 +74,17 @@ buffer_search_cmp(const struct rb_node *node, const void *addrptr)
 static struct buffer *
 get_buffer(uint64_t gpuaddr)
 {
+   struct buffer *buf;
+
    if (gpuaddr == 0)
       return NULL;
-   return (struct buffer *)rb_tree_search(&buffers, &gpuaddr,
-                                          buffer_search_cmp);
+
+   prof_begin(PROF_BUFFERS);
+   buf = (struct buffer *)rb_tree_search(&buffers, &gpuaddr,
+                                         buffer_search_cmp);
+   prof_end();
+
+   return buf;
 }
 
 static int
@@ -88,12 +96,19 @@ buffer_contains_hostptr(struct buffer *buf, void *hostptr)
 uint64_t
 gpuaddr(void *hostptr)
 {
+   uint64_t addr = 0;
+
+   prof_begin(PROF_BUFFERS);
    rb_tree_foreach(struct buffer, buf, &buffers, node)
    {
-      if (buffer_contains_hostptr(buf, hostptr))
-         return buf->gpuaddr + (hostptr - buf->hostptr);
+      if (buffer_contains_hostptr(buf, hostptr)) {
+         addr = buf->gpuaddr + (hostptr - buf->hostptr);
+         break;
+      }
    }
-   return 0;
+   prof_end();
+
+   return addr;
 }
 
 uint64_t
@@ -132,32 +147,21 @@ has_dumped(uint64_t gpuaddr, unsigned enable_mask)
    if (!gpuaddr)
       return false;
 
-   struct buffer *b = get_buffer(gpuaddr);
-   if (!b)
+   if (!get_buffer(gpuaddr))
       return false;
 
-   assert(gpuaddr >= b->gpuaddr);
-   unsigned offset = gpuaddr - b->gpuaddr;
+   struct u64_map_entry *entry = u64_map_get(&dumped, gpuaddr);
 
-   unsigned n = 0;
-   while (n < b->noffsets) {
-      if (offset == b->offsets[n].offset)
-         break;
-      n++;
-   }
+   /* if the table could not grow, just dump it (again): */
+   if (!entry)
+      return false;
 
-   /* if needed, allocate a new offset entry: */
-   if (n == b->noffsets) {
-      b->noffsets++;
-      assert(b->noffsets < ARRAY_SIZE(b->offsets));
-      b->offsets[n].dumped_mask = 0;
-      b->offsets[n].offset = offset;
-   }
+   unsigned dumped_mask = (uintptr_t)entry->data;
 
-   if ((b->offsets[n].dumped_mask & enable_mask) == enable_mask)
+   if ((dumped_mask & enable_mask) == enable_mask)
       return true;
 
-   b->offsets[n].dumped_mask |= enable_mask;
+   entry->data = (void *)(uintptr_t)(dumped_mask | enable_mask);
 
    return false;
 }
@@ -165,12 +169,23 @@ has_dumped(uint64_t gpuaddr, unsigned enable_mask)
 void
 reset_buffers(void)
 {
+   prof_begin(PROF_BUFFERS);
    rb_tree_foreach_safe(struct buffer, buf, &buffers, node)
    {
       rb_tree_remove(&buffers, &buf->node);
       free(buf->hostptr);
       free(buf);
    }
+   u64_map_clear(&dumped);
+   prof_end();
+}
+
+void
+foreach_buffer(void (*fxn)(uint64_t gpuaddr, unsigned len, void *data),
+               void *data)
+{
+   rb_tree_foreach(struct buffer, buf, &buffers, node)
+      fxn(buf->gpuaddr, buf->len, data);
 }
 
 /**
@@ -180,6 +195,8 @@ reset_buffers(void)
 void
 add_buffer(uint64_t gpuaddr, unsigned int len, void *hostptr)
 {
+   prof_begin(PROF_BUFFERS);
+
    struct buffer *buf = get_buffer(gpuaddr);
 
    if (!buf) {
@@ -192,4 +209,6 @@ add_buffer(uint64_t gpuaddr, unsigned int len, void *hostptr)
 
    buf->hostptr = hostptr;
    buf->len = len;
+
+   prof_end();
 }
@@ -35,6 +35,8 @@ bool has_dumped(uint64_t gpuaddr, unsigned enable_mask);
 
 void reset_buffers(void);
 void add_buffer(uint64_t gpuaddr, unsigned int len, void *hostptr);
+void foreach_buffer(void (*fxn)(uint64_t gpuaddr, unsigned len, void *data),
+                    void *data);
 
 #ifndef ARRAY_SIZE
 #define ARRAY_SIZE(arr) (sizeof(arr) / sizeof((arr)[0]))
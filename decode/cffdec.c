@@ -39,14 +39,27 @@
 #include <sys/types.h>
 #include <sys/wait.h>
 
+#include "util/bitscan.h"
+#include "util/hash_table.h"
+#include "util/u_math.h"
+
+#include "adreno_common.xml.h"
+#include "adreno_pm4.xml.h"
+#include "a6xx.xml.h"
+
 #include "freedreno_pm4.h"
 
 #include "buffers.h"
 #include "cffdec.h"
 #include "disasm.h"
+#include "export.h"
+#include "pager.h"
+#include "profile.h"
+#include "qcache.h"
 #include "redump.h"
 #include "rnnutil.h"
 #include "script.h"
+#include "viewer.h"
 
 /* ************************************************************************* */
 /* originally based on kernel recovery dump code: */
@@ -108,16 +121,23 @@ static int current_draw_count;
  * loaded:
  */
 static int *queryvals;
+static int nqueryvals;
 
 static bool
 quiet(int lvl)
 {
+   if (options->silent)
+      return true;
    if ((options->draw_filter != -1) &&
        (options->draw_filter != current_draw_count))
       return true;
-   if ((lvl >= 3) && (summary || options->querystrs || options->script))
+   if ((lvl >= 3) && (summary || options->querystrs || options->script ||
+                      options->descriptors || options->bandwidth ||
+                      options->statecost))
       return true;
-   if ((lvl >= 2) && (options->querystrs || options->script))
+   if ((lvl >= 2) && (options->querystrs || options->script ||
+                      options->descriptors || options->bandwidth ||
+                      options->statecost))
       return true;
    return false;
 }
@@ -161,6 +181,9 @@ enum state_src_t {
 static void load_all_groups(int level);
 static void disable_all_groups(void);
 
+static void reset_render_mode(void);
+static void sc_reset_shader_regs(void);
+
 static void dump_tex_samp(uint32_t *texsamp, enum state_src_t src, int num_unit,
                           int level);
 static void dump_tex_const(uint32_t *texsamp, int num_unit, int level);
@@ -291,7 +314,7 @@ static uint8_t type0_reg_rewritten[sizeof(type0_reg_vals) /
 static uint8_t type0_reg_written[sizeof(type0_reg_vals) / 8];
 static uint32_t lastvals[ARRAY_SIZE(type0_reg_vals)];
 
-static bool
+bool
 reg_rewritten(uint32_t regbase)
 {
    return !!(type0_reg_rewritten[regbase / 8] & (1 << (regbase % 8)));
@@ -328,6 +351,12 @@ clear_lastvals(void)
    memset(lastvals, 0, sizeof(lastvals));
 }
 
+static void
+clear_vals(void)
+{
+   memset(type0_reg_vals, 0, sizeof(type0_reg_vals));
+}
+
 uint32_t
 reg_val(uint32_t regbase)
 {
@@ -341,6 +370,9 @@ reg_set(uint32_t regbase, uint32_t val)
    type0_reg_vals[regbase] = val;
    type0_reg_written[regbase / 8] |= (1 << (regbase % 8));
    type0_reg_rewritten[regbase / 8] |= (1 << (regbase % 8));
+   qcache_reg(regbase, val);
+   export_reg(regbase);
+   viewer_reg(regbase);
 }
 
 static void
@@ -441,7 +473,9 @@ disasm_gpuaddr(const char *name, uint64_t gpuaddr, int level)
       const char *ext;
 
       dump_hex(buf, min(64, sizedwords), level + 1);
+      prof_begin(PROF_DISASM);
       try_disasm_a3xx(buf, sizedwords, level + 2, stdout, options->gpu_id);
+      prof_end();
 
       /* this is a bit ugly way, but oh well.. */
       if (strstr(name, "SP_VS_OBJ")) {
@@ -715,23 +749,47 @@ static struct rnn *rnn;
 static void
 init_rnn(const char *gpuname)
 {
-   rnn = rnn_new(!options->color);
-
-   rnn_load(rnn, gpuname);
+   /* shared with any earlier file decoded for the same gpu: */
+   rnn = rnn_get_gpu(gpuname, !options->color);
 
    if (options->querystrs) {
       int i;
       queryvals = calloc(options->nquery, sizeof(queryvals[0]));
+      nqueryvals = 0;
 
       for (i = 0; i < options->nquery; i++) {
-         int val = strtol(options->querystrs[i], NULL, 0);
+         const char *str = options->querystrs[i];
+         int val = strtol(str, NULL, 0);
+         uint32_t *regs;
+         unsigned n;
 
-         if (val == 0)
-            val = regbase(options->querystrs[i]);
+         /* numeric offsets and plain register names map to a single
+          * register, but prefix and bitfield queries can match many:
+          */
+         if (val || (!strchr(str, '*') && !strchr(str, ':')))
+            n = 0;
+         else
+            n = rnn_findregs(rnn, str, &regs);
+
+         if (!n) {
+            if (val == 0)
+               val = regbase(str);
+            queryvals[nqueryvals++] = val;
+            printf("querystr: %s -> 0x%x\n", str, val);
+            continue;
+         }
 
-         queryvals[i] = val;
-         printf("querystr: %s -> 0x%x\n", options->querystrs[i], queryvals[i]);
+         queryvals = realloc(queryvals, (options->nquery + nqueryvals + n) *
+                                           sizeof(queryvals[0]));
+         for (unsigned j = 0; j < n; j++) {
+            queryvals[nqueryvals++] = regs[j];
+            printf("querystr: %s -> 0x%x (%s)\n", str, regs[j],
+                   rnn_regname(rnn, regs[j], 0));
+         }
+         free(regs);
       }
+
+      export_query_regs(queryvals, nqueryvals);
    }
 
    for (unsigned idx = 0; type0_reg[idx].regname; idx++) {
@@ -757,13 +815,21 @@ cffdec_init(const struct cffdec_options *_options)
    options = _options;
    summary = options->summary;
 
+   /* the resolved query registers are specific to the request, so are
+    * not part of a recording:
+    */
+   qcache_record_init(options->gpu_id);
+   qcache_pause();
+
    /* in case we're decoding multiple files: */
    free(queryvals);
    reset_regs();
+   clear_vals();
+   disable_all_groups();
+   reset_render_mode();
+   sc_reset_shader_regs();
    draw_count = 0;
 
-   /* TODO we need an API to free/cleanup any previous rnn */
-
    switch (options->gpu_id) {
    case 200 ... 299:
       type0_reg = reg_a2xx;
@@ -788,6 +854,8 @@ cffdec_init(const struct cffdec_options *_options)
    default:
       errx(-1, "unsupported gpu");
    }
+
+   qcache_resume();
 }
 
 const char *
@@ -808,6 +876,12 @@ regbase(const char *name)
    return rnn_regbase(rnn, name);
 }
 
+unsigned
+findregs(const char *query, uint32_t **regbases)
+{
+   return rnn_findregs(rnn, query, regbases);
+}
+
 static int
 endswith(uint32_t regbase, const char *suffix)
 {
@@ -818,6 +892,45 @@ endswith(uint32_t regbase, const char *suffix)
    return (s - strlen(name) + strlen(suffix)) == name;
 }
 
+static bool
+is_address_type(struct rnndecaddrinfo *info)
+{
+   return info && info->typeinfo && info->typeinfo->name &&
+          (!strcmp(info->typeinfo->name, "address") ||
+           !strcmp(info->typeinfo->name, "waddress"));
+}
+
+/* is the register (or either half of a 64b register) a gpu address? */
+bool
+reg_is_address(uint32_t regbase)
+{
+   bool ret = false;
+
+   if (options->gpu_id >= 600) {
+      struct rnndecaddrinfo *info = rnn_reginfo(rnn, regbase);
+
+      ret = is_address_type(info);
+      if (info) {
+         free(info->name);
+         free(info);
+      }
+
+      if (!ret && regbase && endswith(regbase, "_HI")) {
+         info = rnn_reginfo(rnn, regbase - 1);
+         ret = is_address_type(info) && (info->width == 64);
+         if (info) {
+            free(info->name);
+            free(info);
+         }
+      }
+   } else if (options->gpu_id >= 500) {
+      ret = (endswith(regbase, "_HI") && endswith(regbase - 1, "_LO")) ||
+            (endswith(regbase, "_LO") && endswith(regbase + 1, "_HI"));
+   }
+
+   return ret;
+}
+
 void
 dump_register_val(uint32_t regbase, uint32_t dword, int level)
 {
@@ -825,7 +938,9 @@ dump_register_val(uint32_t regbase, uint32_t dword, int level)
 
    if (info && info->typeinfo) {
       uint64_t gpuaddr = 0;
+      prof_begin(PROF_RNN);
       char *decoded = rnndec_decodeval(rnn->vc, info->typeinfo, dword);
+      prof_end();
       printf("%s%s: %s", levels[level], info->name, decoded);
 
       /* Try and figure out if we are looking at a gpuaddr.. this
@@ -926,14 +1041,19 @@ dump_domain(uint32_t *dwords, uint32_t sizedwords, int level, const char *name)
    if (!dom)
       return;
 
-   if (script_packet)
+   if (script_packet) {
+      prof_begin(PROF_SCRIPT);
       script_packet(dwords, sizedwords, rnn, dom);
+      prof_end();
+   }
 
    if (quiet(2))
       return;
 
    for (i = 0; i < sizedwords; i++) {
+      prof_begin(PROF_RNN);
       struct rnndecaddrinfo *info = rnndec_decodeaddr(rnn->vc, dom, i, 0);
+      prof_end();
       char *decoded;
       if (!(info && info->typeinfo))
          break;
@@ -942,7 +1062,9 @@ dump_domain(uint32_t *dwords, uint32_t sizedwords, int level, const char *name)
          value |= (uint64_t)dwords[i + 1] << 32;
          i++; /* skip the next dword since we're printing it now */
       }
+      prof_begin(PROF_RNN);
       decoded = rnndec_decodeval(rnn->vc, info->typeinfo, value);
+      prof_end();
       /* Unlike the register printing path, we don't print the name
        * of the register, so if it doesn't contain other named
        * things (i.e. it isn't a bitset) then print the register
@@ -972,6 +1094,15 @@ static enum {
    MODE_BYPASS = 0x4,
    MODE_ALL = MODE_BINNING | MODE_GMEM | MODE_BYPASS,
 } enable_mask = MODE_ALL;
+
+static void
+reset_render_mode(void)
+{
+   bin_x1 = bin_x2 = bin_y1 = bin_y2 = 0;
+   mode = 0;
+   render_mode = NULL;
+   enable_mask = MODE_ALL;
+}
 static bool skip_ib2_enable_global;
 static bool skip_ib2_enable_local;
 
@@ -993,7 +1124,7 @@ skip_query(void)
       /* never skip: */
       return false;
    case QUERY_WRITTEN:
-      for (int i = 0; i < options->nquery; i++) {
+      for (int i = 0; i < nqueryvals; i++) {
          uint32_t regbase = queryvals[i];
          if (!reg_written(regbase)) {
             continue;
@@ -1004,7 +1135,7 @@ skip_query(void)
       }
       return true;
    case QUERY_DELTA:
-      for (int i = 0; i < options->nquery; i++) {
+      for (int i = 0; i < nqueryvals; i++) {
          uint32_t regbase = queryvals[i];
          if (!reg_written(regbase)) {
             continue;
@@ -1019,11 +1150,10 @@ skip_query(void)
    return true;
 }
 
+/* on a5xx+ the bin is the window scissor, rather than set by CP_SET_BIN: */
 static void
-__do_query(const char *primtype, uint32_t num_indices)
+update_bin(void)
 {
-   int n = 0;
-
    if ((500 <= options->gpu_id) && (options->gpu_id < 700)) {
       uint32_t scissor_tl = reg_val(regbase("GRAS_SC_WINDOW_SCISSOR_TL"));
       uint32_t scissor_br = reg_val(regbase("GRAS_SC_WINDOW_SCISSOR_BR"));
@@ -1033,8 +1163,16 @@ __do_query(const char *primtype, uint32_t num_indices)
       bin_x2 = scissor_br & 0xffff;
       bin_y2 = scissor_br >> 16;
    }
+}
+
+static void
+__do_query(const char *primtype, uint32_t num_indices)
+{
+   int n = 0;
 
-   for (int i = 0; i < options->nquery; i++) {
+   update_bin();
+
+   for (int i = 0; i < nqueryvals; i++) {
       uint32_t regbase = queryvals[i];
       if (reg_written(regbase)) {
          uint32_t lastval = reg_val(regbase);
@@ -1111,18 +1249,61 @@ do_query_compare(const char *primtype, uint32_t num_indices)
 static void
 do_query(const char *primtype, uint32_t num_indices)
 {
-   if (script_draw)
+   if (script_draw) {
+      prof_begin(PROF_SCRIPT);
       script_draw(primtype, num_indices);
+      prof_end();
+   }
+
+   if (export_enabled) {
+      update_bin();
+      export_draw(&(struct export_draw){
+         .draw = draw_count,
+         .primtype = primtype,
+         .num_indices = num_indices,
+         .render_mode = render_mode,
+         .bin_x1 = bin_x1,
+         .bin_y1 = bin_y1,
+         .bin_x2 = bin_x2,
+         .bin_y2 = bin_y2,
+      });
+   }
 
    if (options->query_compare) {
       do_query_compare(primtype, num_indices);
       return;
    }
 
+   qcache_record_draw(primtype, num_indices);
+
    if (skip_query())
       return;
 
+   qcache_pause();
    __do_query(primtype, num_indices);
+   qcache_resume();
+}
+
+/* replay the state recorded in a query cache: */
+void
+cffdec_replay_draw(const char *primtype, uint32_t num_indices)
+{
+   do_query(primtype, num_indices);
+}
+
+void
+cffdec_replay_render_mode(const char *mode)
+{
+   render_mode = mode;
+}
+
+void
+cffdec_replay_bin(uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2)
+{
+   bin_x1 = x1;
+   bin_y1 = y1;
+   bin_x2 = x2;
+   bin_y2 = y2;
 }
 
 static void
@@ -1152,7 +1333,9 @@ cp_im_loadi(uint32_t *dwords, uint32_t sizedwords, int level)
 
    printf("%s%s shader, start=%04x, size=%04x\n", levels[level], type, start,
           size);
+   prof_begin(PROF_DISASM);
    disasm_a2xx(dwords + 2, sizedwords - 2, level + 2, disasm_type);
+   prof_end();
 
    /* dump raw shader: */
    if (ext)
@@ -1191,17 +1374,6 @@ enum state_t {
    UNKNOWN_4DWORDS,
 };
 
-enum adreno_state_block {
-   SB_VERT_TEX = 0,
-   SB_VERT_MIPADDR = 1,
-   SB_FRAG_TEX = 2,
-   SB_FRAG_MIPADDR = 3,
-   SB_VERT_SHADER = 4,
-   SB_GEOM_SHADER = 5,
-   SB_FRAG_SHADER = 6,
-   SB_COMPUTE_SHADER = 7,
-};
-
 /* TODO there is probably a clever way to let rnndec parse things so
  * we don't have to care about packet format differences across gens
  */
@@ -1422,159 +1594,966 @@ dump_tex_const(uint32_t *texconst, int num_unit, int level)
    }
 }
 
-static void
-cp_load_state(uint32_t *dwords, uint32_t sizedwords, int level)
+/*
+ * The render mode markers (CP_SET_MARKER) which the per-pass reports of
+ * the descriptor, state cost and bandwidth modes split the cmdstream into
+ * passes on:
+ */
+
+enum pass_marker {
+   PASS_NONE, /* not a pass boundary */
+   PASS_BINNING,
+   PASS_GMEM,
+   PASS_BYPASS,
+   PASS_COMPUTE,
+   PASS_BLIT2DSCALE,
+};
+
+static const struct {
+   const char *mode;
+   enum pass_marker marker;
+} pass_markers[] = {
+   { "RM6_BINNING", PASS_BINNING },
+   { "RM6_GMEM", PASS_GMEM },
+   { "RM6_BYPASS", PASS_BYPASS },
+   { "RM6_COMPUTE", PASS_COMPUTE },
+   { "RM6_BLIT2DSCALE", PASS_BLIT2DSCALE },
+};
+
+static enum pass_marker
+get_pass_marker(const char *mode)
 {
-   gl_shader_stage stage;
-   enum state_t state;
-   enum state_src_t src;
-   uint32_t num_unit = (dwords[0] >> 22) & 0x1ff;
-   uint64_t ext_src_addr;
-   void *contents;
-   int i;
+   if (!mode)
+      return PASS_NONE;
 
-   if (quiet(2) && !options->script)
-      return;
+   for (unsigned i = 0; i < ARRAY_SIZE(pass_markers); i++)
+      if (!strcmp(mode, pass_markers[i].mode))
+         return pass_markers[i].marker;
 
-   if (options->gpu_id >= 600)
-      a6xx_get_state_type(dwords, &stage, &state, &src);
-   else if (options->gpu_id >= 400)
-      a4xx_get_state_type(dwords, &stage, &state, &src);
-   else
-      a3xx_get_state_type(dwords, &stage, &state, &src);
+   return PASS_NONE;
+}
 
-   switch (src) {
-   case STATE_SRC_DIRECT:
-      ext_src_addr = 0;
-      break;
-   case STATE_SRC_INDIRECT:
-      if (is_64b()) {
-         ext_src_addr = dwords[1] & 0xfffffffc;
-         ext_src_addr |= ((uint64_t)dwords[2]) << 32;
-      } else {
-         ext_src_addr = dwords[1] & 0xfffffffc;
-      }
+/* Whether the marker starts a new pass, given the mode of the current
+ * pass (if any), each bin of a GMEM pass being part of the same pass:
+ */
+static bool
+starts_pass(const char *mode, const char *cur_mode)
+{
+   enum pass_marker marker = get_pass_marker(mode);
 
-      break;
-   case STATE_SRC_BINDLESS: {
-      const unsigned base_reg = stage == MESA_SHADER_COMPUTE
-                                   ? regbase("HLSQ_CS_BINDLESS_BASE[0].ADDR")
-                                   : regbase("HLSQ_BINDLESS_BASE[0].ADDR");
+   if (marker == PASS_NONE)
+      return false;
 
-      if (is_64b()) {
-         const unsigned reg = base_reg + (dwords[1] >> 28) * 2;
-         ext_src_addr = reg_val(reg) & 0xfffffffc;
-         ext_src_addr |= ((uint64_t)reg_val(reg + 1)) << 32;
-      } else {
-         const unsigned reg = base_reg + (dwords[1] >> 28);
-         ext_src_addr = reg_val(reg) & 0xfffffffc;
-      }
+   if ((marker == PASS_GMEM) && (get_pass_marker(cur_mode) == PASS_GMEM))
+      return false;
 
-      ext_src_addr += 4 * (dwords[1] & 0xffffff);
-      break;
-   }
-   }
+   return true;
+}
 
-   if (ext_src_addr)
-      contents = hostptr(ext_src_addr);
-   else
-      contents = is_64b() ? dwords + 3 : dwords + 2;
+/*
+ * Descriptor inventory (--descriptors mode):
+ *
+ * Rather than hexdumping each texture/sampler/UBO/IBO descriptor as it is
+ * loaded, decode each unique descriptor (keyed by a hash of its contents)
+ * once, keep track of which descriptor is bound to each stage/slot, and
+ * record the descriptors referenced by each draw.  At the end of each
+ * pass (and submit), print the table of descriptors referenced by the
+ * pass's draws, the total footprint of bound textures/images, and the
+ * format mix.
+ */
 
-   if (!contents)
-      return;
+enum desc_kind {
+   DESC_TEX,
+   DESC_SAMP,
+   DESC_UBO,
+   DESC_IBO,
+   DESC_KINDS,
+};
 
-   switch (state) {
-   case SHADER_PROG: {
-      const char *ext = NULL;
+static const char *desc_kind_names[DESC_KINDS] = {
+   [DESC_TEX] = "tex",
+   [DESC_SAMP] = "samp",
+   [DESC_UBO] = "ubo",
+   [DESC_IBO] = "ibo",
+};
 
-      if (quiet(2))
-         return;
+static const char *desc_src_names[] = {
+   [STATE_SRC_DIRECT] = "direct",
+   [STATE_SRC_INDIRECT] = "indirect",
+   [STATE_SRC_BINDLESS] = "bindless",
+};
 
-      if (options->gpu_id >= 400)
-         num_unit *= 16;
-      else if (options->gpu_id >= 300)
-         num_unit *= 4;
+static const char *desc_stage_names[MESA_SHADER_STAGES] = {
+   [MESA_SHADER_VERTEX] = "VS",    [MESA_SHADER_TESS_CTRL] = "HS",
+   [MESA_SHADER_TESS_EVAL] = "DS", [MESA_SHADER_GEOMETRY] = "GS",
+   [MESA_SHADER_FRAGMENT] = "FS",  [MESA_SHADER_COMPUTE] = "CS",
+};
 
-      /* shaders:
-       *
-       * note: num_unit seems to be # of instruction groups, where
-       * an instruction group has 4 64bit instructions.
-       */
-      if (stage == MESA_SHADER_VERTEX) {
-         ext = "vo3";
-      } else if (stage == MESA_SHADER_GEOMETRY) {
-         ext = "go3";
-      } else if (stage == MESA_SHADER_COMPUTE) {
-         ext = "co3";
-      } else if (stage == MESA_SHADER_FRAGMENT) {
-         ext = "fo3";
-      }
+struct desc {
+   enum desc_kind kind;
+   enum state_src_t src; /* source the descriptor was first seen from */
+   uint32_t hash;
+   unsigned id;
+   unsigned sizedwords;
+   uint32_t dwords[16];
+
+   /* decoded fields, where applicable: */
+   const char *fmt;
+   const char *type;
+   uint32_t width, height, depth, miplvls;
+   uint64_t base;
+   uint64_t size; /* estimated footprint in bytes */
 
-      if (contents)
-         try_disasm_a3xx(contents, num_unit * 2, level + 2, stdout,
-                         options->gpu_id);
+   unsigned nrefs; /* # of draws in the pass referencing the descriptor */
+   int last_draw;
+};
 
-      /* dump raw shader: */
-      if (ext)
-         dump_shader(ext, contents, num_unit * 2 * 4);
+/* max # of tracked binding slots per stage and descriptor kind: */
+#define MAX_DESC_SLOTS 128
 
-      break;
-   }
-   case SHADER_CONST: {
-      if (quiet(2))
-         return;
+static struct {
+   struct hash_table *ht;
+   struct desc **descs;
+   unsigned ndescs, maxdescs;
+   unsigned ndraws;
 
-      /* uniforms/consts:
-       *
-       * note: num_unit seems to be # of pairs of dwords??
-       */
+   /* the current pass, see desc_marker(): */
+   const char *mode;
+   unsigned npasses;
 
-      if (options->gpu_id >= 400)
-         num_unit *= 2;
+   /* currently bound descriptor per stage/kind/slot, as id + 1 (so that
+    * zero means nothing bound):
+    */
+   unsigned bound[MESA_SHADER_STAGES][DESC_KINDS][MAX_DESC_SLOTS];
+} desc_state;
 
-      dump_float(contents, num_unit * 2, level + 1);
-      dump_hex(contents, num_unit * 2, level + 1);
+static uint32_t
+desc_hash(const void *key)
+{
+   const struct desc *d = key;
+   return d->hash;
+}
 
-      break;
+static bool
+desc_equal(const void *a, const void *b)
+{
+   const struct desc *da = a, *db = b;
+   return (da->kind == db->kind) && (da->sizedwords == db->sizedwords) &&
+          !memcmp(da->dwords, db->dwords, 4 * da->sizedwords);
+}
+
+static unsigned
+desc_sizedwords(enum desc_kind kind)
+{
+   switch (kind) {
+   case DESC_TEX:
+      if (options->gpu_id >= 600)
+         return 16;
+      else if (options->gpu_id >= 500)
+         return 12;
+      else if (options->gpu_id >= 400)
+         return 8;
+      return 4;
+   case DESC_SAMP:
+      return (options->gpu_id >= 500) ? 4 : 2;
+   case DESC_UBO:
+      return 2;
+   case DESC_IBO:
+      /* on a4xx/a5xx we track the SSBO_1 part, which has the format and
+       * dimensions:
+       */
+      return (options->gpu_id >= 600) ? 16 : 2;
+   default:
+      return 0;
    }
-   case TEX_MIPADDR: {
-      uint32_t *addrs = contents;
+}
 
-      if (quiet(2))
-         return;
+/* a5xx and a6xx TEX_CONST, and a6xx IBO, share the same layout for the
+ * fields we care about:
+ */
+static void
+desc_decode_a5xx_tex(struct desc *d, const char *fmtenum, const char *typeenum,
+                     uint32_t *pitch, uint32_t *array_pitch)
+{
+   uint32_t *dw = d->dwords;
+
+   d->fmt = rnn_enumname(rnn, fmtenum, (dw[0] >> 22) & 0xff);
+   d->type = rnn_enumname(rnn, typeenum, (dw[2] >> 29) & 0x3);
+   d->width = dw[1] & 0x7fff;
+   d->height = (dw[1] >> 15) & 0x7fff;
+   d->depth = (dw[5] >> 17) & 0x1fff;
+   d->base = (((uint64_t)dw[5] & 0x1ffff) << 32) | (dw[4] & ~0x1f);
+   *pitch = (dw[2] >> 7) & 0x3fffff;
+   *array_pitch = (dw[3] & 0x3fff) << 12;
+}
 
-      /* mipmap consts block just appears to be array of num_unit gpu addr's: */
-      for (i = 0; i < num_unit; i++) {
-         void *ptr = hostptr(addrs[i]);
-         printf("%s%2d: %08x\n", levels[level + 1], i, addrs[i]);
-         if (options->dump_textures) {
-            printf("base=%08x\n", (uint32_t)gpubaseaddr(addrs[i]));
-            dump_hex(ptr, hostlen(addrs[i]) / 4, level + 1);
-         }
+static void
+desc_decode(struct desc *d)
+{
+   uint32_t *dw = d->dwords;
+   uint32_t pitch = 0, array_pitch = 0;
+
+   switch (d->kind) {
+   case DESC_TEX:
+      if ((300 <= options->gpu_id) && (options->gpu_id < 400)) {
+         d->fmt = rnn_enumname(rnn, "a3xx_tex_fmt", (dw[0] >> 22) & 0x7f);
+         d->type = rnn_enumname(rnn, "a3xx_tex_type", (dw[0] >> 30) & 0x3);
+         d->miplvls = (dw[0] >> 16) & 0xf;
+         d->height = dw[1] & 0x3fff;
+         d->width = (dw[1] >> 14) & 0x3fff;
+         d->depth = (dw[3] >> 17) & 0x7ff;
+         pitch = (dw[2] >> 12) & 0x3ffff;
+      } else if ((400 <= options->gpu_id) && (options->gpu_id < 500)) {
+         d->fmt = rnn_enumname(rnn, "a4xx_tex_fmt", (dw[0] >> 22) & 0x7f);
+         d->type = rnn_enumname(rnn, "a4xx_tex_type", (dw[0] >> 29) & 0x3);
+         d->miplvls = (dw[0] >> 16) & 0xf;
+         d->height = dw[1] & 0x7fff;
+         d->width = (dw[1] >> 15) & 0x7fff;
+         d->depth = (dw[3] >> 18) & 0x1fff;
+         d->base = dw[4] & ~0x1f;
+         pitch = (dw[2] >> 9) & 0x1fffff;
+         array_pitch = (dw[3] & 0x3fff) << 12;
+      } else if ((500 <= options->gpu_id) && (options->gpu_id < 600)) {
+         desc_decode_a5xx_tex(d, "a5xx_tex_fmt", "a5xx_tex_type", &pitch,
+                              &array_pitch);
+         d->miplvls = (dw[0] >> 16) & 0xf;
+      } else if ((600 <= options->gpu_id) && (options->gpu_id < 700)) {
+         desc_decode_a5xx_tex(d, "a6xx_format", "a6xx_tex_type", &pitch,
+                              &array_pitch);
+         d->miplvls = (dw[0] >> 16) & 0xf;
       }
       break;
-   }
-   case TEX_SAMP: {
-      dump_tex_samp(contents, src, num_unit, level);
+   case DESC_IBO:
+      if ((400 <= options->gpu_id) && (options->gpu_id < 500)) {
+         d->fmt = rnn_enumname(rnn, "a4xx_color_fmt", (dw[0] >> 8) & 0xff);
+         d->width = dw[0] >> 16;
+         d->height = dw[1] & 0xffff;
+         d->depth = dw[1] >> 16;
+         d->size = (uint64_t)d->width * max(d->height, 1) *
+                   max(d->depth, 1) * (dw[0] & 0x1f);
+      } else if ((500 <= options->gpu_id) && (options->gpu_id < 600)) {
+         d->fmt = rnn_enumname(rnn, "a5xx_tex_fmt", (dw[0] >> 8) & 0xff);
+         d->width = dw[0] >> 16;
+         d->height = dw[1] & 0xffff;
+         d->depth = dw[1] >> 16;
+      } else if ((600 <= options->gpu_id) && (options->gpu_id < 700)) {
+         desc_decode_a5xx_tex(d, "a6xx_format", "a6xx_tex_type", &pitch,
+                              &array_pitch);
+         d->base = (((uint64_t)dw[5] & 0x1ffff) << 32) | dw[4];
+      }
       break;
+   case DESC_UBO:
+      d->base = dw[0];
+      if (options->gpu_id >= 500)
+         d->base |= ((uint64_t)dw[1] & 0x1ffff) << 32;
+      /* SIZE is in vec4 units: */
+      if (options->gpu_id >= 600)
+         d->size = (dw[1] >> 17) * 16;
+      return;
+   default:
+      return;
    }
-   case TEX_CONST: {
-      dump_tex_const(contents, num_unit, level);
-      break;
+
+   /* Rough estimate of the footprint: the layer size (or pitch * height if
+    * the layer size is not known) times the # of layers, plus 1/3 for the
+    * mip chain.  If we can't tell, fall back to the size of the buffer the
+    * descriptor points into.
+    */
+   if (!d->size) {
+      uint64_t layer = array_pitch ? array_pitch : (uint64_t)pitch * d->height;
+      d->size = layer * max(d->depth, 1);
+      if (!array_pitch && d->miplvls)
+         d->size += d->size / 3;
    }
-   case SSBO_0: {
-      uint32_t *ssboconst = (uint32_t *)contents;
+   if (!d->size && d->base)
+      d->size = hostlen(d->base);
+}
 
-      for (i = 0; i < num_unit; i++) {
-         int sz = 4;
-         if (400 <= options->gpu_id && options->gpu_id < 500) {
-            dump_domain(ssboconst, 4, level + 2, "A4XX_SSBO_0");
-         } else if (500 <= options->gpu_id && options->gpu_id < 600) {
-            dump_domain(ssboconst, 4, level + 2, "A5XX_SSBO_0");
-         } else if (600 <= options->gpu_id && options->gpu_id < 700) {
-            sz = 16;
-            dump_domain(ssboconst, 16, level + 2, "A6XX_IBO");
-         }
+static struct desc *
+desc_lookup(enum desc_kind kind, enum state_src_t src, uint32_t *dwords)
+{
+   struct desc key = {
+      .kind = kind,
+      .sizedwords = desc_sizedwords(kind),
+   };
+   struct hash_entry *entry;
+   struct desc *d;
+
+   memcpy(key.dwords, dwords, 4 * key.sizedwords);
+   key.hash = _mesa_hash_data_with_seed(key.dwords, 4 * key.sizedwords, kind);
+
+   if (!desc_state.ht)
+      desc_state.ht = _mesa_hash_table_create(NULL, desc_hash, desc_equal);
+
+   entry = _mesa_hash_table_search_pre_hashed(desc_state.ht, key.hash, &key);
+   if (entry)
+      return entry->data;
+
+   d = malloc(sizeof(*d));
+   *d = key;
+   d->src = src;
+   d->id = desc_state.ndescs;
+   d->last_draw = -1;
+   desc_decode(d);
+
+   if (desc_state.ndescs == desc_state.maxdescs) {
+      desc_state.maxdescs = max(2 * desc_state.maxdescs, 64);
+      desc_state.descs =
+         realloc(desc_state.descs,
+                 desc_state.maxdescs * sizeof(desc_state.descs[0]));
+   }
+   desc_state.descs[desc_state.ndescs++] = d;
+
+   _mesa_hash_table_insert_pre_hashed(desc_state.ht, d->hash, d, d);
+
+   return d;
+}
+
+/* called from cp_load_state() for each descriptor load: */
+static void
+desc_load_state(gl_shader_stage stage, enum state_t state, enum state_src_t src,
+                unsigned dst_off, unsigned num_unit, uint32_t *contents)
+{
+   enum desc_kind kind;
+   unsigned stride;
+
+   switch (state) {
+   case TEX_CONST:
+      kind = DESC_TEX;
+      break;
+   case TEX_SAMP:
+      kind = DESC_SAMP;
+      break;
+   case UBO:
+      kind = DESC_UBO;
+      break;
+   case SSBO_0:
+      if (options->gpu_id < 600)
+         return;
+      kind = DESC_IBO;
+      break;
+   case SSBO_1:
+      if (options->gpu_id >= 600)
+         return;
+      kind = DESC_IBO;
+      break;
+   default:
+      return;
+   }
+
+   if (stage >= MESA_SHADER_STAGES)
+      return;
+
+   stride = desc_sizedwords(kind);
+   if ((src == STATE_SRC_BINDLESS) &&
+       ((kind == DESC_SAMP) || (kind == DESC_UBO)))
+      stride = 16;
+
+   for (unsigned i = 0; i < num_unit; i++, contents += stride) {
+      unsigned slot = dst_off + i;
+      unsigned j;
+
+      if (slot >= MAX_DESC_SLOTS)
+         break;
+
+      /* an all-zero descriptor is treated as unbinding the slot: */
+      for (j = 0; j < desc_sizedwords(kind); j++)
+         if (contents[j])
+            break;
+
+      if (j == desc_sizedwords(kind)) {
+         desc_state.bound[stage][kind][slot] = 0;
+         continue;
+      }
+
+      desc_state.bound[stage][kind][slot] =
+         desc_lookup(kind, src, contents)->id + 1;
+   }
+}
+
+/* called for each draw, to record the descriptors it references: */
+static void
+desc_draw(void)
+{
+   uint64_t footprint = 0;
+
+   printl(0, "draw[%i]", draw_count);
+   if (render_mode)
+      printl(0, " %s", render_mode);
+   printl(0, ":");
+
+   for (unsigned s = 0; s < MESA_SHADER_STAGES; s++) {
+      for (unsigned k = 0; k < DESC_KINDS; k++) {
+         for (unsigned slot = 0; slot < MAX_DESC_SLOTS; slot++) {
+            unsigned idx = desc_state.bound[s][k][slot];
+            struct desc *d;
+
+            if (!idx)
+               continue;
+
+            d = desc_state.descs[idx - 1];
+            printl(0, " %s.%s%u=#%u", desc_stage_names[s], desc_kind_names[k],
+                   slot, d->id);
+
+            if (d->last_draw == draw_count)
+               continue;
+
+            d->last_draw = draw_count;
+            d->nrefs++;
+
+            if ((k == DESC_TEX) || (k == DESC_IBO))
+               footprint += d->size;
+         }
+      }
+   }
+
+   printl(0, " (footprint %" PRIu64 " bytes)\n", footprint);
+
+   desc_state.ndraws++;
+}
+
+static void
+desc_report(void)
+{
+   unsigned counts[DESC_KINDS] = {0};
+   unsigned nrefd = 0;
+   uint64_t footprint[DESC_KINDS] = {0};
+   struct {
+      const char *fmt;
+      unsigned ndescs, nrefs;
+      uint64_t size;
+   } *mix = NULL;
+   unsigned nmix = 0;
+
+   for (unsigned i = 0; i < desc_state.ndescs; i++) {
+      if (!desc_state.descs[i]->nrefs)
+         continue;
+      counts[desc_state.descs[i]->kind]++;
+      nrefd++;
+   }
+
+   if (!nrefd)
+      return;
+
+   printf("descriptors: pass %u", desc_state.npasses);
+   if (desc_state.mode)
+      printf(" (%s)", desc_state.mode);
+   printf(": %u of %u unique referenced (%u tex, %u samp, %u ubo, %u ibo), "
+          "%u draws\n",
+          nrefd, desc_state.ndescs, counts[DESC_TEX], counts[DESC_SAMP],
+          counts[DESC_UBO], counts[DESC_IBO], desc_state.ndraws);
+   printf("\t%-4s %-8s %-4s %-8s %5s %-24s %-16s %-16s %-16s %12s\n", "id",
+          "hash", "kind", "src", "refs", "format", "type", "size", "base",
+          "bytes");
+
+   for (unsigned i = 0; i < desc_state.ndescs; i++) {
+      struct desc *d = desc_state.descs[i];
+      char dims[32] = "";
+
+      if (!d->nrefs)
+         continue;
+
+      if (d->width)
+         snprintf(dims, sizeof(dims), "%ux%ux%u", d->width, d->height,
+                  d->depth);
+
+      printf("\t#%-3u %08x %-4s %-8s %5u %-24s %-16s %-16s %016" PRIx64
+             " %12" PRIu64 "\n",
+             d->id, d->hash, desc_kind_names[d->kind], desc_src_names[d->src],
+             d->nrefs, d->fmt ? d->fmt : "-", d->type ? d->type : "-", dims,
+             d->base, d->size);
+
+      if (d->kind == DESC_SAMP)
+         continue;
+
+      footprint[d->kind] += d->size;
+
+      if ((d->kind != DESC_TEX) && (d->kind != DESC_IBO))
+         continue;
+
+      unsigned j;
+      for (j = 0; j < nmix; j++)
+         if (mix[j].fmt == d->fmt)
+            break;
+      if (j == nmix) {
+         mix = realloc(mix, ++nmix * sizeof(mix[0]));
+         memset(&mix[j], 0, sizeof(mix[j]));
+         mix[j].fmt = d->fmt;
+      }
+      mix[j].ndescs++;
+      mix[j].nrefs += d->nrefs;
+      mix[j].size += d->size;
+   }
+
+   printf("footprint: %" PRIu64 " bytes tex, %" PRIu64 " bytes ibo, %" PRIu64
+          " bytes ubo\n",
+          footprint[DESC_TEX], footprint[DESC_IBO], footprint[DESC_UBO]);
+   printf("format mix:\n");
+   for (unsigned j = 0; j < nmix; j++) {
+      printf("\t%-24s %4u descriptors, %5u refs, %12" PRIu64 " bytes\n",
+             mix[j].fmt ? mix[j].fmt : "-", mix[j].ndescs, mix[j].nrefs,
+             mix[j].size);
+   }
+
+   free(mix);
+}
+
+/* start a new pass, descriptors (and their bindings) carry over from the
+ * previous pass but only the new pass's references are counted:
+ */
+static void
+desc_new_pass(const char *mode)
+{
+   for (unsigned i = 0; i < desc_state.ndescs; i++)
+      desc_state.descs[i]->nrefs = 0;
+   desc_state.ndraws = 0;
+   desc_state.mode = mode;
+   desc_state.npasses++;
+}
+
+/* called from cp_set_marker(): */
+static void
+desc_marker(const char *mode)
+{
+   if (starts_pass(mode, desc_state.mode)) {
+      desc_report();
+      desc_new_pass(mode);
+   }
+}
+
+static void
+desc_reset(void)
+{
+   for (unsigned i = 0; i < desc_state.ndescs; i++)
+      free(desc_state.descs[i]);
+   desc_state.ndescs = 0;
+   desc_state.ndraws = 0;
+   desc_state.mode = NULL;
+   desc_state.npasses = 0;
+   if (desc_state.ht)
+      _mesa_hash_table_clear(desc_state.ht, NULL);
+   memset(desc_state.bound, 0, sizeof(desc_state.bound));
+}
+
+/*
+ * State cost accounting, to see how much state is (re)emitted per draw,
+ * and how much of it comes via CP_SET_DRAW_STATE groups:
+ */
+
+enum sc_metric {
+   SC_REGS_WRITTEN,
+   SC_REGS_CHANGED,
+   SC_DWORDS_DIRECT,
+   SC_DWORDS_GROUP,
+   SC_GROUPS,
+   SC_SHADERS,
+   SC_DESCRIPTORS,
+   SC_METRICS,
+};
+
+static const char *sc_metric_names[SC_METRICS] = {
+   [SC_REGS_WRITTEN] = "regs written",
+   [SC_REGS_CHANGED] = "regs changed",
+   [SC_DWORDS_DIRECT] = "dwords direct",
+   [SC_DWORDS_GROUP] = "dwords in groups",
+   [SC_GROUPS] = "groups loaded",
+   [SC_SHADERS] = "shaders changed",
+   [SC_DESCRIPTORS] = "descriptor loads",
+};
+
+/* histogram buckets are 0, 1, 2-3, 4-7, .., 1024+ */
+#define SC_BUCKETS 12
+
+struct sc_pass {
+   const char *mode;
+   unsigned ndraws;
+   uint64_t total[SC_METRICS];
+   unsigned max[SC_METRICS];
+   unsigned hist[SC_METRICS][SC_BUCKETS];
+};
+
+static struct {
+   struct sc_pass *passes;
+   unsigned npasses, maxpasses;
+   struct sc_pass *cur;
+
+   /* counts accumulated since the last draw: */
+   unsigned draw[SC_METRICS];
+   unsigned shader_mask;
+
+   bool in_group;
+
+   /* shader address registers, to detect shader changes: */
+   struct {
+      uint32_t regbase;
+      gl_shader_stage stage;
+   } shader_regs[3 * MESA_SHADER_STAGES];
+   unsigned nshader_regs;
+   bool shader_regs_init;
+} sc_state;
+
+static struct sc_pass *
+sc_new_pass(const char *mode)
+{
+   struct sc_pass *pass;
+
+   if (sc_state.npasses == sc_state.maxpasses) {
+      sc_state.maxpasses = max(2 * sc_state.maxpasses, 16);
+      sc_state.passes =
+         realloc(sc_state.passes,
+                 sc_state.maxpasses * sizeof(sc_state.passes[0]));
+   }
+
+   pass = &sc_state.passes[sc_state.npasses++];
+   memset(pass, 0, sizeof(*pass));
+   pass->mode = mode;
+
+   sc_state.cur = pass;
+
+   return pass;
+}
+
+/* called from cp_set_marker(), each bin of a GMEM pass is accumulated
+ * into the same pass:
+ */
+static void
+sc_marker(const char *mode)
+{
+   if (starts_pass(mode, sc_state.cur ? sc_state.cur->mode : NULL))
+      sc_new_pass(mode);
+}
+
+/* called for each cmdstream packet (other than draws): */
+static void
+sc_packet(uint32_t sizedwords)
+{
+   if (sc_state.in_group)
+      sc_state.draw[SC_DWORDS_GROUP] += sizedwords;
+   else
+      sc_state.draw[SC_DWORDS_DIRECT] += sizedwords;
+}
+
+static void
+sc_load_state(gl_shader_stage stage, enum state_t state)
+{
+   switch (state) {
+   case SHADER_PROG:
+      sc_state.shader_mask |= 1 << stage;
+      break;
+   case TEX_SAMP:
+   case TEX_CONST:
+   case SSBO_0:
+   case SSBO_1:
+   case SSBO_2:
+   case UBO:
+      sc_state.draw[SC_DESCRIPTORS]++;
+      break;
+   default:
+      break;
+   }
+}
+
+static void
+sc_init_shader_regs(void)
+{
+   static const char *stages[MESA_SHADER_STAGES] = {
+      [MESA_SHADER_VERTEX] = "VS",    [MESA_SHADER_TESS_CTRL] = "HS",
+      [MESA_SHADER_TESS_EVAL] = "DS", [MESA_SHADER_GEOMETRY] = "GS",
+      [MESA_SHADER_FRAGMENT] = "FS",  [MESA_SHADER_COMPUTE] = "CS",
+   };
+   static const char *suffixes[] = {"", "_REG", "_LO"};
+
+   for (unsigned s = 0; s < MESA_SHADER_STAGES; s++) {
+      if (!stages[s])
+         continue;
+      for (unsigned i = 0; i < ARRAY_SIZE(suffixes); i++) {
+         char name[32];
+         uint32_t base;
+
+         snprintf(name, sizeof(name), "SP_%s_OBJ_START%s", stages[s],
+                  suffixes[i]);
+         base = regbase(name);
+         if (!base)
+            continue;
+
+         sc_state.shader_regs[sc_state.nshader_regs].regbase = base;
+         sc_state.shader_regs[sc_state.nshader_regs].stage = s;
+         sc_state.nshader_regs++;
+      }
+   }
+
+   sc_state.shader_regs_init = true;
+}
+
+/* the shader address registers differ between gpus: */
+static void
+sc_reset_shader_regs(void)
+{
+   sc_state.nshader_regs = 0;
+   sc_state.shader_regs_init = false;
+}
+
+/* called from dump_register_summary() for each register written since
+ * the last draw:
+ */
+static void
+sc_reg(uint32_t regbase, bool changed)
+{
+   sc_state.draw[SC_REGS_WRITTEN]++;
+
+   if (!changed)
+      return;
+
+   sc_state.draw[SC_REGS_CHANGED]++;
+
+   if (!sc_state.shader_regs_init)
+      sc_init_shader_regs();
+
+   for (unsigned i = 0; i < sc_state.nshader_regs; i++)
+      if (sc_state.shader_regs[i].regbase == regbase)
+         sc_state.shader_mask |= 1 << sc_state.shader_regs[i].stage;
+}
+
+static void
+sc_draw(void)
+{
+   struct sc_pass *pass = sc_state.cur;
+
+   if (!pass)
+      pass = sc_new_pass("draws");
+
+   /* a shader could be updated both via its address register and
+    * CP_LOAD_STATE, so count stages rather than updates:
+    */
+   sc_state.draw[SC_SHADERS] = util_bitcount(sc_state.shader_mask);
+
+   for (unsigned i = 0; i < SC_METRICS; i++) {
+      unsigned val = sc_state.draw[i];
+      unsigned bucket = MIN2(util_last_bit(val), SC_BUCKETS - 1);
+
+      pass->total[i] += val;
+      pass->max[i] = max(pass->max[i], val);
+      pass->hist[i][bucket]++;
+   }
+
+   pass->ndraws++;
+
+   memset(sc_state.draw, 0, sizeof(sc_state.draw));
+   sc_state.shader_mask = 0;
+}
+
+static void
+sc_report(void)
+{
+   if (!sc_state.npasses)
+      return;
+
+   printf("state cost: %u passes\n", sc_state.npasses);
+
+   for (unsigned i = 0; i < sc_state.npasses; i++) {
+      struct sc_pass *pass = &sc_state.passes[i];
+
+      if (!pass->ndraws)
+         continue;
+
+      printf("\tpass %u: %s, %u draws\n", i, pass->mode, pass->ndraws);
+      printf("\t\t%-16s %8s %8s %6s |", "", "total", "avg", "max");
+      for (unsigned b = 0; b < SC_BUCKETS; b++) {
+         char label[8];
+         if (b < 2)
+            snprintf(label, sizeof(label), "%u", b);
+         else
+            snprintf(label, sizeof(label), "%u+", 1 << (b - 1));
+         printf(" %5s", label);
+      }
+      printf("\n");
+
+      for (unsigned m = 0; m < SC_METRICS; m++) {
+         printf("\t\t%-16s %8" PRIu64 " %8.1f %6u |", sc_metric_names[m],
+                pass->total[m], (double)pass->total[m] / pass->ndraws,
+                pass->max[m]);
+         for (unsigned b = 0; b < SC_BUCKETS; b++)
+            printf(" %5u", pass->hist[m][b]);
+         printf("\n");
+      }
+   }
+}
+
+static void
+sc_reset(void)
+{
+   sc_state.npasses = 0;
+   sc_state.cur = NULL;
+   memset(sc_state.draw, 0, sizeof(sc_state.draw));
+   sc_state.shader_mask = 0;
+}
+
+static void
+cp_load_state(uint32_t *dwords, uint32_t sizedwords, int level)
+{
+   gl_shader_stage stage;
+   enum state_t state;
+   enum state_src_t src;
+   uint32_t num_unit = (dwords[0] >> 22) & 0x1ff;
+   uint64_t ext_src_addr;
+   void *contents;
+   int i;
+
+   if (quiet(2) && !options->script && !options->descriptors &&
+       !options->statecost)
+      return;
+
+   if (options->gpu_id >= 600)
+      a6xx_get_state_type(dwords, &stage, &state, &src);
+   else if (options->gpu_id >= 400)
+      a4xx_get_state_type(dwords, &stage, &state, &src);
+   else
+      a3xx_get_state_type(dwords, &stage, &state, &src);
+
+   switch (src) {
+   case STATE_SRC_DIRECT:
+      ext_src_addr = 0;
+      break;
+   case STATE_SRC_INDIRECT:
+      if (is_64b()) {
+         ext_src_addr = dwords[1] & 0xfffffffc;
+         ext_src_addr |= ((uint64_t)dwords[2]) << 32;
+      } else {
+         ext_src_addr = dwords[1] & 0xfffffffc;
+      }
+
+      break;
+   case STATE_SRC_BINDLESS: {
+      const unsigned base_reg = stage == MESA_SHADER_COMPUTE
+                                   ? regbase("HLSQ_CS_BINDLESS_BASE[0].ADDR")
+                                   : regbase("HLSQ_BINDLESS_BASE[0].ADDR");
+
+      if (is_64b()) {
+         const unsigned reg = base_reg + (dwords[1] >> 28) * 2;
+         ext_src_addr = reg_val(reg) & 0xfffffffc;
+         ext_src_addr |= ((uint64_t)reg_val(reg + 1)) << 32;
+      } else {
+         const unsigned reg = base_reg + (dwords[1] >> 28);
+         ext_src_addr = reg_val(reg) & 0xfffffffc;
+      }
+
+      ext_src_addr += 4 * (dwords[1] & 0xffffff);
+      break;
+   }
+   }
+
+   if (options->statecost)
+      sc_load_state(stage, state);
+
+   if (ext_src_addr)
+      contents = hostptr(ext_src_addr);
+   else
+      contents = is_64b() ? dwords + 3 : dwords + 2;
+
+   if (!contents)
+      return;
+
+   if (options->descriptors) {
+      unsigned dst_off =
+         dwords[0] & ((options->gpu_id >= 400) ? 0x3fff : 0xffff);
+      desc_load_state(stage, state, src, dst_off, num_unit, contents);
+   }
+
+   switch (state) {
+   case SHADER_PROG: {
+      const char *ext = NULL;
+
+      if (quiet(2))
+         return;
+
+      if (options->gpu_id >= 400)
+         num_unit *= 16;
+      else if (options->gpu_id >= 300)
+         num_unit *= 4;
+
+      /* shaders:
+       *
+       * note: num_unit seems to be # of instruction groups, where
+       * an instruction group has 4 64bit instructions.
+       */
+      if (stage == MESA_SHADER_VERTEX) {
+         ext = "vo3";
+      } else if (stage == MESA_SHADER_GEOMETRY) {
+         ext = "go3";
+      } else if (stage == MESA_SHADER_COMPUTE) {
+         ext = "co3";
+      } else if (stage == MESA_SHADER_FRAGMENT) {
+         ext = "fo3";
+      }
+
+      if (contents) {
+         prof_begin(PROF_DISASM);
+         try_disasm_a3xx(contents, num_unit * 2, level + 2, stdout,
+                         options->gpu_id);
+         prof_end();
+      }
+
+      /* dump raw shader: */
+      if (ext)
+         dump_shader(ext, contents, num_unit * 2 * 4);
+
+      break;
+   }
+   case SHADER_CONST: {
+      if (quiet(2))
+         return;
+
+      /* uniforms/consts:
+       *
+       * note: num_unit seems to be # of pairs of dwords??
+       */
+
+      if (options->gpu_id >= 400)
+         num_unit *= 2;
+
+      dump_float(contents, num_unit * 2, level + 1);
+      dump_hex(contents, num_unit * 2, level + 1);
+
+      break;
+   }
+   case TEX_MIPADDR: {
+      uint32_t *addrs = contents;
+
+      if (quiet(2))
+         return;
+
+      /* mipmap consts block just appears to be array of num_unit gpu addr's: */
+      for (i = 0; i < num_unit; i++) {
+         void *ptr = hostptr(addrs[i]);
+         printf("%s%2d: %08x\n", levels[level + 1], i, addrs[i]);
+         if (options->dump_textures) {
+            printf("base=%08x\n", (uint32_t)gpubaseaddr(addrs[i]));
+            dump_hex(ptr, hostlen(addrs[i]) / 4, level + 1);
+         }
+      }
+      break;
+   }
+   case TEX_SAMP: {
+      dump_tex_samp(contents, src, num_unit, level);
+      break;
+   }
+   case TEX_CONST: {
+      dump_tex_const(contents, num_unit, level);
+      break;
+   }
+   case SSBO_0: {
+      uint32_t *ssboconst = (uint32_t *)contents;
+
+      for (i = 0; i < num_unit; i++) {
+         int sz = 4;
+         if (400 <= options->gpu_id && options->gpu_id < 500) {
+            dump_domain(ssboconst, 4, level + 2, "A4XX_SSBO_0");
+         } else if (500 <= options->gpu_id && options->gpu_id < 600) {
+            dump_domain(ssboconst, 4, level + 2, "A5XX_SSBO_0");
+         } else if (600 <= options->gpu_id && options->gpu_id < 700) {
+            sz = 16;
+            dump_domain(ssboconst, 16, level + 2, "A6XX_IBO");
+         }
          dump_hex(ssboconst, sz, level + 1);
          ssboconst += sz;
       }
@@ -1659,6 +2638,8 @@ cp_set_bin(uint32_t *dwords, uint32_t sizedwords, int level)
    bin_y1 = dwords[1] >> 16;
    bin_x2 = dwords[2] & 0xffff;
    bin_y2 = dwords[2] >> 16;
+
+   qcache_record_bin(bin_x1, bin_y1, bin_x2, bin_y2);
 }
 
 static void
@@ -1793,11 +2774,9 @@ cp_set_const(uint32_t *dwords, uint32_t sizedwords, int level)
          assert(sizedwords == 3);
          assert(srcreg < ARRAY_SIZE(type0_reg_vals));
 
-         /* note: rnn_regname uses a static buf so we can't do
-          * two regname() calls for one printf..
-          */
-         printf("%s%s = %08x + ", levels[level], regname(val, 1), dstval);
-         printf("%s (%08x)\n", regname(srcreg, 1), type0_reg_vals[srcreg]);
+         printf("%s%s = %08x + %s (%08x)\n", levels[level],
+                regname(val, 1), dstval, regname(srcreg, 1),
+                type0_reg_vals[srcreg]);
 
          dstval += type0_reg_vals[srcreg];
 
@@ -1809,8 +2788,323 @@ cp_set_const(uint32_t *dwords, uint32_t sizedwords, int level)
    }
 }
 
+/*
+ * Bandwidth estimate (--bandwidth mode, a6xx):
+ *
+ * A cheap first-order model of memory traffic per render pass, based on
+ * register state at the points where traffic happens:
+ *
+ *  + GMEM loads (restores) and stores (resolves), from CP_EVENT_WRITE BLIT,
+ *    using the blit scissor and RB_BLIT_DST_INFO format
+ *  + sysmem color/depth writes in bypass passes, assuming each enabled
+ *    render target is touched once over the window scissor (no overdraw,
+ *    blending, or UBWC compression is taken into account)
+ *  + 2d blits (CP_BLIT), from the 2d src/dst rects and formats
+ *
+ * Passes are delimited by CP_SET_MARKER, so in --once mode (where only the
+ * first tile is decoded) the GMEM numbers will be for a single bin.
+ */
+
+struct bw_pass {
+   const char *type; /* "gmem", "bypass", or "blit" */
+   bool binning;
+   unsigned nbins;
+   unsigned binw, binh;
+   unsigned ndraws;
+
+   uint64_t gmem_load;
+   uint64_t gmem_store;
+   uint64_t blit;
+
+   /* for bypass passes, max bytes written per render target (and
+    * depth/stencil) by any draw in the pass:
+    */
+   uint64_t rt[8];
+   uint64_t depth;
+};
+
+static struct {
+   struct bw_pass *passes;
+   unsigned npasses, maxpasses;
+   struct bw_pass *cur;
+} bw_state;
+
+/* Estimate bytes per pixel from the format enum name, ie. FMT6_8_8_8_8_UNORM
+ * is 32 bits, FMT6_Z24_UNORM_S8_UINT is 32 bits, DEPTH6_24_8 is 32 bits, etc.
+ * Compressed/yuv formats are not handled (but we don't normally render to
+ * them).
+ */
+static unsigned
+fmt_cpp(const char *name)
+{
+   unsigned bits = 0;
+
+   if (!name)
+      return 0;
+
+   /* skip the prefix, and then sum up the component sizes, which look
+    * like "8", "X8", "Z24", etc:
+    */
+   for (const char *tok = strchr(name, '_'); tok; tok = strchr(tok, '_')) {
+      const char *p = ++tok;
+      char *end;
+
+      if (isalpha(*p))
+         p++;
+      if (!isdigit(*p))
+         continue;
+
+      unsigned long n = strtoul(p, &end, 10);
+      if (((*end == '_') || (*end == '\0')) && ((end - p) <= 2))
+         bits += n;
+   }
+
+   return bits / 8;
+}
+
+/* area of a rect given TL/BR a6xx_reg_xy values, optionally clipped to
+ * the current bin:
+ */
+static uint64_t
+bw_rect_area(uint32_t tl, uint32_t br, const struct bw_pass *bin)
+{
+   uint32_t x1 = A6XX_GRAS_SC_WINDOW_SCISSOR_TL_X__unpack(tl);
+   uint32_t y1 = A6XX_GRAS_SC_WINDOW_SCISSOR_TL_Y__unpack(tl);
+   uint32_t x2 = A6XX_GRAS_SC_WINDOW_SCISSOR_BR_X__unpack(br);
+   uint32_t y2 = A6XX_GRAS_SC_WINDOW_SCISSOR_BR_Y__unpack(br);
+
+   if (bin && bin->binw && bin->binh) {
+      uint32_t offset = reg_val(REG_A6XX_RB_WINDOW_OFFSET);
+      uint32_t bx = A6XX_RB_WINDOW_OFFSET_X__unpack(offset);
+      uint32_t by = A6XX_RB_WINDOW_OFFSET_Y__unpack(offset);
+
+      x1 = max(x1, bx);
+      y1 = max(y1, by);
+      x2 = min(x2, bx + bin->binw - 1);
+      y2 = min(y2, by + bin->binh - 1);
+   }
+
+   if ((x2 < x1) || (y2 < y1))
+      return 0;
+
+   return (uint64_t)(x2 - x1 + 1) * (y2 - y1 + 1);
+}
+
+static struct bw_pass *
+bw_new_pass(const char *type)
+{
+   struct bw_pass *pass;
+
+   if (bw_state.npasses == bw_state.maxpasses) {
+      bw_state.maxpasses = max(2 * bw_state.maxpasses, 16);
+      bw_state.passes =
+         realloc(bw_state.passes,
+                 bw_state.maxpasses * sizeof(bw_state.passes[0]));
+   }
+
+   pass = &bw_state.passes[bw_state.npasses++];
+   memset(pass, 0, sizeof(*pass));
+   pass->type = type;
+
+   bw_state.cur = pass;
+
+   return pass;
+}
+
+/* called from cp_set_marker(): */
+static void
+bw_marker(const char *mode)
+{
+   struct bw_pass *pass = bw_state.cur;
+   uint32_t bin_control;
+
+   switch (get_pass_marker(mode)) {
+   case PASS_BINNING:
+      pass = bw_new_pass("gmem");
+      pass->binning = true;
+      break;
+   case PASS_GMEM:
+      bin_control = reg_val(REG_A6XX_RB_BIN_CONTROL);
+
+      if (!pass || strcmp(pass->type, "gmem"))
+         pass = bw_new_pass("gmem");
+
+      pass->nbins++;
+      pass->binw = A6XX_RB_BIN_CONTROL_BINW__unpack(bin_control);
+      pass->binh = A6XX_RB_BIN_CONTROL_BINH__unpack(bin_control);
+      break;
+   case PASS_BYPASS:
+      bw_new_pass("bypass");
+      break;
+   case PASS_COMPUTE:
+   case PASS_BLIT2DSCALE:
+      bw_state.cur = NULL;
+      break;
+   case PASS_NONE:
+      break;
+   }
+}
+
+/* called for CP_EVENT_WRITE BLIT, ie. GMEM clear/restore/resolve: */
+static void
+bw_blit_event(void)
+{
+   struct bw_pass *pass = bw_state.cur;
+
+   if (!pass)
+      pass = bw_new_pass("gmem");
+
+   /* the blit scissor generally covers the whole render target, but the
+    * blit is clipped to the current bin:
+    */
+   uint32_t info = reg_val(REG_A6XX_RB_BLIT_INFO);
+   uint32_t dst_info = reg_val(REG_A6XX_RB_BLIT_DST_INFO);
+   uint64_t area = bw_rect_area(reg_val(REG_A6XX_RB_BLIT_SCISSOR_TL),
+                                reg_val(REG_A6XX_RB_BLIT_SCISSOR_BR), pass);
+   unsigned samples = 1 << A6XX_RB_BLIT_DST_INFO_SAMPLES__unpack(dst_info);
+   unsigned cpp = fmt_cpp(rnn_enumname(rnn, "a6xx_format",
+                  A6XX_RB_BLIT_DST_INFO_COLOR_FORMAT__unpack(dst_info)));
+   uint64_t bytes = area * cpp * samples;
+
+   if (A6XX_RB_BLIT_INFO_GMEM__unpack(info)) {
+      /* GMEM bit set for clears and restores, clears have a CLEAR_MASK
+       * and don't touch sysmem:
+       */
+      if (!A6XX_RB_BLIT_INFO_CLEAR_MASK__unpack(info))
+         pass->gmem_load += bytes;
+   } else {
+      pass->gmem_store += bytes;
+   }
+}
+
+/* called for CP_BLIT: */
+static void
+bw_blit_2d(void)
+{
+   uint32_t blit_cntl = reg_val(REG_A6XX_RB_2D_BLIT_CNTL);
+   uint32_t dst_info = reg_val(REG_A6XX_RB_2D_DST_INFO);
+   uint32_t src_info = reg_val(REG_A6XX_SP_PS_2D_SRC_INFO);
+   uint64_t dst_area = bw_rect_area(reg_val(REG_A6XX_GRAS_2D_DST_TL),
+                                    reg_val(REG_A6XX_GRAS_2D_DST_BR), NULL);
+   struct bw_pass *pass = bw_state.cur;
+
+   if (!pass || strcmp(pass->type, "blit"))
+      pass = bw_new_pass("blit");
+
+   pass->blit += dst_area * fmt_cpp(rnn_enumname(rnn, "a6xx_format",
+                 A6XX_RB_2D_DST_INFO_COLOR_FORMAT__unpack(dst_info)));
+
+   /* no src reads for solid fills: */
+   if (!A6XX_RB_2D_BLIT_CNTL_SOLID_COLOR__unpack(blit_cntl)) {
+      int32_t x1 = A6XX_GRAS_2D_SRC_TL_X__unpack(reg_val(REG_A6XX_GRAS_2D_SRC_TL_X));
+      int32_t x2 = A6XX_GRAS_2D_SRC_BR_X__unpack(reg_val(REG_A6XX_GRAS_2D_SRC_BR_X));
+      int32_t y1 = A6XX_GRAS_2D_SRC_TL_Y__unpack(reg_val(REG_A6XX_GRAS_2D_SRC_TL_Y));
+      int32_t y2 = A6XX_GRAS_2D_SRC_BR_Y__unpack(reg_val(REG_A6XX_GRAS_2D_SRC_BR_Y));
+      unsigned samples = 1 << A6XX_SP_PS_2D_SRC_INFO_SAMPLES__unpack(src_info);
+      unsigned cpp = fmt_cpp(rnn_enumname(rnn, "a6xx_format",
+                     A6XX_SP_PS_2D_SRC_INFO_COLOR_FORMAT__unpack(src_info)));
+
+      if ((x2 >= x1) && (y2 >= y1)) {
+         pass->blit +=
+            (uint64_t)(x2 - x1 + 1) * (y2 - y1 + 1) * samples * cpp;
+      }
+   }
+}
+
+/* called for each draw: */
+static void
+bw_draw(void)
+{
+   struct bw_pass *pass = bw_state.cur;
+
+   if (!pass || strcmp(pass->type, "bypass")) {
+      if (pass)
+         pass->ndraws++;
+      return;
+   }
+
+   pass->ndraws++;
+
+   uint64_t area =
+      bw_rect_area(reg_val(REG_A6XX_GRAS_SC_WINDOW_SCISSOR_TL),
+                   reg_val(REG_A6XX_GRAS_SC_WINDOW_SCISSOR_BR), NULL);
+   uint32_t components = reg_val(REG_A6XX_RB_RENDER_COMPONENTS);
+
+   for (unsigned i = 0; i < ARRAY_SIZE(pass->rt); i++) {
+      if (!(components & (A6XX_RB_RENDER_COMPONENTS_RT0__MASK << (4 * i))))
+         continue;
+
+      uint32_t buf_info = reg_val(REG_A6XX_RB_MRT_BUF_INFO(i));
+      uint64_t bytes = area * fmt_cpp(rnn_enumname(rnn, "a6xx_format",
+                       A6XX_RB_MRT_BUF_INFO_COLOR_FORMAT__unpack(buf_info)));
+
+      pass->rt[i] = max(pass->rt[i], bytes);
+   }
+
+   uint32_t depth_cntl = reg_val(REG_A6XX_RB_DEPTH_CNTL);
+   if (A6XX_RB_DEPTH_CNTL_Z_ENABLE__unpack(depth_cntl)) {
+      uint32_t depth_info = reg_val(REG_A6XX_RB_DEPTH_BUFFER_INFO);
+      uint64_t bytes = area * fmt_cpp(rnn_enumname(rnn, "a6xx_depth_format",
+                       A6XX_RB_DEPTH_BUFFER_INFO_DEPTH_FORMAT__unpack(depth_info)));
+
+      /* depth test reads, and Z_WRITE_ENABLE writes: */
+      if (A6XX_RB_DEPTH_CNTL_Z_WRITE_ENABLE__unpack(depth_cntl))
+         bytes *= 2;
+
+      pass->depth = max(pass->depth, bytes);
+   }
+}
+
+static void
+bw_report(void)
+{
+   uint64_t load = 0, store = 0, sysmem = 0, blit = 0;
+
+   if (!bw_state.npasses)
+      return;
+
+   printf("bandwidth estimate: %u passes\n", bw_state.npasses);
+
+   for (unsigned i = 0; i < bw_state.npasses; i++) {
+      struct bw_pass *pass = &bw_state.passes[i];
+      uint64_t pass_sysmem = pass->depth;
+
+      for (unsigned j = 0; j < ARRAY_SIZE(pass->rt); j++)
+         pass_sysmem += pass->rt[j];
+
+      printf("\tpass %u: %s", i, pass->type);
+      if (pass->binning)
+         printf(" (binning)");
+      if (pass->nbins)
+         printf(", %u bins of %ux%u", pass->nbins, pass->binw, pass->binh);
+      printf(", %u draws: gmem load %" PRIu64 ", gmem store %" PRIu64
+             ", sysmem %" PRIu64 ", 2d blit %" PRIu64 " bytes\n",
+             pass->ndraws, pass->gmem_load, pass->gmem_store, pass_sysmem,
+             pass->blit);
+
+      load += pass->gmem_load;
+      store += pass->gmem_store;
+      sysmem += pass_sysmem;
+      blit += pass->blit;
+   }
+
+   printf("\ttotal: gmem load %" PRIu64 ", gmem store %" PRIu64
+          ", sysmem %" PRIu64 ", 2d blit %" PRIu64 ", %" PRIu64 " bytes\n",
+          load, store, sysmem, blit, load + store + sysmem + blit);
+}
+
+static void
+bw_reset(void)
+{
+   bw_state.npasses = 0;
+   bw_state.cur = NULL;
+}
+
 static void dump_register_summary(int level);
 
+/* set while dumping the summary of a blit, as opposed to a draw: */
+static bool in_blit;
+
 static void
 cp_event_write(uint32_t *dwords, uint32_t sizedwords, int level)
 {
@@ -1821,9 +3115,13 @@ cp_event_write(uint32_t *dwords, uint32_t sizedwords, int level)
       char eventname[64];
       snprintf(eventname, sizeof(eventname), "EVENT:%s", name);
       if (!strcmp(name, "BLIT")) {
+         if (options->bandwidth && (options->gpu_id >= 600))
+            bw_blit_event();
          do_query(eventname, 0);
          print_mode(level);
+         in_blit = true;
          dump_register_summary(level);
+         in_blit = false;
       }
    }
 }
@@ -1835,18 +3133,39 @@ dump_register_summary(int level)
    bool saved_summary = summary;
    summary = false;
 
+   qcache_record_summary();
+
    in_summary = true;
 
+   /* blits don't reference any descriptors: */
+   if (options->descriptors && !in_blit)
+      desc_draw();
+
+   if (options->bandwidth && (options->gpu_id >= 600))
+      bw_draw();
+
    /* dump current state of registers: */
    printl(2, "%sdraw[%i] register values\n", levels[level], draw_count);
    for (i = 0; i < regcnt(); i++) {
       uint32_t regbase = i;
       uint32_t lastval = reg_val(regbase);
-      /* skip registers that haven't been updated since last draw/blit: */
+      /* skip registers that haven't been updated since last draw/blit,
+       * 64 at a time where possible:
+       */
+      if (!options->allregs && !(i % 64)) {
+         uint64_t rewritten;
+         memcpy(&rewritten, &type0_reg_rewritten[i / 8], sizeof(rewritten));
+         if (!rewritten) {
+            i += 63;
+            continue;
+         }
+      }
       if (!(options->allregs || reg_rewritten(regbase)))
          continue;
       if (!reg_written(regbase))
          continue;
+      if (options->statecost && reg_rewritten(regbase))
+         sc_reg(regbase, lastval != lastvals[regbase]);
       if (lastval != lastvals[regbase]) {
          printl(2, "!");
          lastvals[regbase] = lastval;
@@ -1866,8 +3185,13 @@ dump_register_summary(int level)
 
    clear_rewritten();
 
+   if (options->statecost)
+      sc_draw();
+
    in_summary = false;
 
+   viewer_draw(ib, draw_count);
+
    draw_count++;
    summary = saved_summary;
 }
@@ -1875,8 +3199,8 @@ dump_register_summary(int level)
 static uint32_t
 draw_indx_common(uint32_t *dwords, int level)
 {
-   uint32_t prim_type = dwords[1] & 0x1f;
-   uint32_t source_select = (dwords[1] >> 6) & 0x3;
+   uint32_t prim_type = CP_DRAW_INDX_1_PRIM_TYPE__unpack(dwords[1]);
+   uint32_t source_select = CP_DRAW_INDX_1_SOURCE_SELECT__unpack(dwords[1]);
    uint32_t num_indices = dwords[2];
    const char *primtype;
 
@@ -1897,14 +3221,6 @@ draw_indx_common(uint32_t *dwords, int level)
    return num_indices;
 }
 
-enum pc_di_index_size {
-   INDEX_SIZE_IGN = 0,
-   INDEX_SIZE_16_BIT = 0,
-   INDEX_SIZE_32_BIT = 1,
-   INDEX_SIZE_8_BIT = 2,
-   INDEX_SIZE_INVALID = 0,
-};
-
 static void
 cp_draw_indx(uint32_t *dwords, uint32_t sizedwords, int level)
 {
@@ -1993,7 +3309,7 @@ static void
 cp_draw_indx_offset(uint32_t *dwords, uint32_t sizedwords, int level)
 {
    uint32_t num_indices = dwords[2];
-   uint32_t prim_type = dwords[0] & 0x1f;
+   uint32_t prim_type = CP_DRAW_INDX_OFFSET_0_PRIM_TYPE__unpack(dwords[0]);
 
    do_query(rnn_enumname(rnn, "pc_di_primtype", prim_type), num_indices);
    print_mode(level);
@@ -2006,7 +3322,7 @@ cp_draw_indx_offset(uint32_t *dwords, uint32_t sizedwords, int level)
 static void
 cp_draw_indx_indirect(uint32_t *dwords, uint32_t sizedwords, int level)
 {
-   uint32_t prim_type = dwords[0] & 0x1f;
+   uint32_t prim_type = A4XX_CP_DRAW_INDX_INDIRECT_0_PRIM_TYPE__unpack(dwords[0]);
    uint64_t addr;
 
    do_query(rnn_enumname(rnn, "pc_di_primtype", prim_type), 0);
@@ -2030,7 +3346,7 @@ cp_draw_indx_indirect(uint32_t *dwords, uint32_t sizedwords, int level)
 static void
 cp_draw_indirect(uint32_t *dwords, uint32_t sizedwords, int level)
 {
-   uint32_t prim_type = dwords[0] & 0x1f;
+   uint32_t prim_type = A4XX_CP_DRAW_INDIRECT_0_PRIM_TYPE__unpack(dwords[0]);
    uint64_t addr;
 
    do_query(rnn_enumname(rnn, "pc_di_primtype", prim_type), 0);
@@ -2045,7 +3361,7 @@ cp_draw_indirect(uint32_t *dwords, uint32_t sizedwords, int level)
 static void
 cp_draw_indirect_multi(uint32_t *dwords, uint32_t sizedwords, int level)
 {
-   uint32_t prim_type = dwords[0] & 0x1f;
+   uint32_t prim_type = A6XX_CP_DRAW_INDIRECT_MULTI_0_PRIM_TYPE__unpack(dwords[0]);
    uint32_t count = dwords[2];
 
    do_query(rnn_enumname(rnn, "pc_di_primtype", prim_type), 0);
@@ -2266,6 +3582,199 @@ struct draw_state state[32];
 
 static int draw_mode;
 
+/*
+ * Cache of draw state group contents, keyed by contents rather than
+ * address.  When nothing is being dumped, groups which only contain
+ * register writes can be replayed from the cache rather than decoded
+ * again for each draw.
+ */
+
+struct group_cache_entry {
+   uint32_t hash;
+   uint32_t count;
+   uint32_t *dwords;
+
+   /* only plain register writes, to registers without special handling
+    * in type0_reg:
+    */
+   bool replayable;
+};
+
+static struct {
+   struct hash_table *ht;
+
+   /* per group_id stats: */
+   unsigned loads[ARRAY_SIZE(state)];
+   unsigned unique[ARRAY_SIZE(state)];   /* contents not seen before */
+   unsigned replayed[ARRAY_SIZE(state)];
+} group_cache;
+
+static uint32_t
+group_cache_hash(const void *key)
+{
+   const struct group_cache_entry *e = key;
+   return e->hash;
+}
+
+static bool
+group_cache_equal(const void *a, const void *b)
+{
+   const struct group_cache_entry *ea = a, *eb = b;
+   return (ea->count == eb->count) &&
+          !memcmp(ea->dwords, eb->dwords, 4 * ea->count);
+}
+
+static bool
+group_reg_special(uint32_t regbase)
+{
+   for (unsigned idx = 0; type0_reg[idx].regname; idx++) {
+      if (type0_reg[idx].regbase == regbase)
+         return true;
+      if (type0_reg[idx].is_reg64 && (type0_reg[idx].regbase + 1 == regbase))
+         return true;
+   }
+   return false;
+}
+
+static bool
+group_replayable(uint32_t *dwords, uint32_t sizedwords)
+{
+   while (sizedwords > 0) {
+      uint32_t count, regbase;
+
+      if (pkt_is_type0(dwords[0])) {
+         count = type0_pkt_size(dwords[0]) + 1;
+         regbase = type0_pkt_offset(dwords[0]);
+      } else if (pkt_is_type4(dwords[0])) {
+         count = type4_pkt_size(dwords[0]) + 1;
+         regbase = type4_pkt_offset(dwords[0]);
+      } else {
+         return false;
+      }
+
+      if ((count > sizedwords) || (regbase + count - 1 > regcnt()))
+         return false;
+
+      for (unsigned i = 0; i < count - 1; i++)
+         if (group_reg_special(regbase + i))
+            return false;
+
+      dwords += count;
+      sizedwords -= count;
+   }
+
+   return true;
+}
+
+static struct group_cache_entry *
+group_cache_lookup(unsigned group_id, uint32_t *dwords, uint32_t count)
+{
+   struct group_cache_entry key = {
+      .hash = _mesa_hash_data(dwords, 4 * count),
+      .count = count,
+      .dwords = dwords,
+   };
+   struct group_cache_entry *e;
+   struct hash_entry *entry;
+
+   if (!group_cache.ht) {
+      group_cache.ht =
+         _mesa_hash_table_create(NULL, group_cache_hash, group_cache_equal);
+   }
+
+   group_cache.loads[group_id]++;
+
+   entry = _mesa_hash_table_search_pre_hashed(group_cache.ht, key.hash, &key);
+   if (entry)
+      return entry->data;
+
+   group_cache.unique[group_id]++;
+
+   e = malloc(sizeof(*e));
+   *e = key;
+   e->dwords = malloc(4 * count);
+   memcpy(e->dwords, dwords, 4 * count);
+   e->replayable = group_replayable(dwords, count);
+
+   _mesa_hash_table_insert_pre_hashed(group_cache.ht, e->hash, e, e);
+
+   return e;
+}
+
+/* equivalent to dump_commands() for a replayable group, when nothing is
+ * being dumped:
+ */
+static void
+group_cache_replay(unsigned group_id, struct group_cache_entry *e)
+{
+   uint32_t *dwords = e->dwords;
+   uint32_t sizedwords = e->count;
+
+   while (sizedwords > 0) {
+      uint32_t count, regbase;
+
+      if (pkt_is_type0(dwords[0])) {
+         count = type0_pkt_size(dwords[0]) + 1;
+         regbase = type0_pkt_offset(dwords[0]);
+      } else {
+         count = type4_pkt_size(dwords[0]) + 1;
+         regbase = type4_pkt_offset(dwords[0]);
+      }
+
+      for (unsigned i = 1; i < count; i++)
+         reg_set(regbase + i - 1, dwords[i]);
+
+      dwords += count;
+      sizedwords -= count;
+   }
+
+   if (options->statecost)
+      sc_state.draw[SC_DWORDS_GROUP] += e->count;
+
+   group_cache.replayed[group_id]++;
+}
+
+static void
+group_cache_report(void)
+{
+   bool header = false;
+
+   for (unsigned i = 0; i < ARRAY_SIZE(state); i++) {
+      unsigned loads = group_cache.loads[i];
+
+      if (!loads)
+         continue;
+
+      if (!header) {
+         printf("draw state groups:\n");
+         header = true;
+      }
+
+      printf("\tgroup %2u: %6u loads, %6u new, %5.1f%% reused, "
+             "%6u replayed\n",
+             i, loads, group_cache.unique[i],
+             100.0 * (loads - group_cache.unique[i]) / loads,
+             group_cache.replayed[i]);
+   }
+}
+
+static void
+group_cache_reset(void)
+{
+   if (group_cache.ht) {
+      hash_table_foreach (group_cache.ht, entry) {
+         struct group_cache_entry *e = entry->data;
+         free(e->dwords);
+         free(e);
+      }
+      _mesa_hash_table_clear(group_cache.ht, NULL);
+   }
+
+   memset(group_cache.loads, 0, sizeof(group_cache.loads));
+   memset(group_cache.unique, 0, sizeof(group_cache.unique));
+   memset(group_cache.replayed, 0, sizeof(group_cache.replayed));
+}
+
 static void
 disable_group(unsigned group_id)
 {
@@ -2307,9 +3816,28 @@ load_group(unsigned group_id, int level)
       if (!quiet(2))
          dump_hex(ptr, ds->count, level + 1);
 
+      if (options->statecost)
+         sc_state.draw[SC_GROUPS]++;
+
+      /* if nothing is being dumped, avoid decoding the same group
+       * contents over and over:
+       */
+      if (quiet(2)) {
+         struct group_cache_entry *e =
+            group_cache_lookup(group_id, ptr, ds->count);
+         if (e->replayable) {
+            group_cache_replay(group_id, e);
+            return;
+         }
+      }
+
+      sc_state.in_group = true;
+
       ib++;
       dump_commands(ptr, ds->count, level + 1);
       ib--;
+
+      sc_state.in_group = false;
    }
 }
 
@@ -2421,14 +3949,32 @@ cp_exec_cs_indirect(uint32_t *dwords, uint32_t sizedwords, int level)
 static void
 cp_set_marker(uint32_t *dwords, uint32_t sizedwords, int level)
 {
-   render_mode = rnn_enumname(rnn, "a6xx_render_mode", dwords[0] & 0xf);
+   enum a6xx_render_mode mode = A6XX_CP_SET_MARKER_0_MARKER__unpack(dwords[0]);
+
+   render_mode = rnn_enumname(rnn, "a6xx_render_mode", mode);
+   qcache_record_render_mode(render_mode);
+
+   if (options->bandwidth)
+      bw_marker(render_mode);
+
+   if (options->statecost)
+      sc_marker(render_mode);
 
-   if (!strcmp(render_mode, "RM6_BINNING")) {
+   if (options->descriptors)
+      desc_marker(render_mode);
+
+   switch (mode) {
+   case RM6_BINNING:
       enable_mask = MODE_BINNING;
-   } else if (!strcmp(render_mode, "RM6_GMEM")) {
+      break;
+   case RM6_GMEM:
       enable_mask = MODE_GMEM;
-   } else if (!strcmp(render_mode, "RM6_BYPASS")) {
+      break;
+   case RM6_BYPASS:
       enable_mask = MODE_BYPASS;
+      break;
+   default:
+      break;
    }
 }
 
@@ -2464,6 +4010,7 @@ cp_set_render_mode(uint32_t *dwords, uint32_t sizedwords, int level)
    assert(options->gpu_id >= 500);
 
    render_mode = rnn_enumname(rnn, "render_mode_cmd", dwords[0]);
+   qcache_record_render_mode(render_mode);
 
    if (sizedwords == 1)
       return;
@@ -2532,9 +4079,13 @@ cp_compute_checkpoint(uint32_t *dwords, uint32_t sizedwords, int level)
 static void
 cp_blit(uint32_t *dwords, uint32_t sizedwords, int level)
 {
+   if (options->bandwidth && (options->gpu_id >= 600))
+      bw_blit_2d();
    do_query(rnn_enumname(rnn, "cp_blit_cmd", dwords[0]), 0);
    print_mode(level);
+   in_blit = true;
    dump_register_summary(level);
+   in_blit = false;
 }
 
 static void
@@ -2690,8 +4241,14 @@ dump_commands(uint32_t *dwords, uint32_t sizedwords, int level)
    assert(ib < ARRAY_SIZE(draws));
    draws[ib] = 0;
 
+   viewer_ib(ib, sizedwords);
+
    while (dwords_left > 0) {
 
+      /* nobody is looking at the output anymore: */
+      if (pager_done())
+         break;
+
       current_draw_count = draw_count;
 
       /* hack, this looks like a -1 underflow, in some versions
@@ -2701,26 +4258,32 @@ dump_commands(uint32_t *dwords, uint32_t sizedwords, int level)
       //			goto skip;
 
       if (pkt_is_type0(dwords[0])) {
+         prof_begin(PROF_PKT0);
          printl(3, "t0");
          count = type0_pkt_size(dwords[0]) + 1;
          val = type0_pkt_offset(dwords[0]);
+         viewer_packet(ib, VIEWER_REGS, val);
          assert(val < regcnt());
          printl(3, "%swrite %s%s (%04x)\n", levels[level + 1], regname(val, 1),
                 (dwords[0] & 0x8000) ? " (same register)" : "", val);
          dump_registers(val, dwords + 1, count - 1, level + 2);
          if (!quiet(3))
             dump_hex(dwords, count, level + 1);
+         prof_end();
       } else if (pkt_is_type4(dwords[0])) {
          /* basically the same(ish) as type0 prior to a5xx */
+         prof_begin(PROF_PKT4);
          printl(3, "t4");
          count = type4_pkt_size(dwords[0]) + 1;
          val = type4_pkt_offset(dwords[0]);
+         viewer_packet(ib, VIEWER_REGS, val);
          assert(val < regcnt());
          printl(3, "%swrite %s (%04x)\n", levels[level + 1], regname(val, 1),
                 val);
          dump_registers(val, dwords + 1, count - 1, level + 2);
          if (!quiet(3))
             dump_hex(dwords, count, level + 1);
+         prof_end();
 #if 0
       } else if (pkt_is_type1(dwords[0])) {
          printl(3, "t1");
@@ -2741,8 +4304,10 @@ dump_commands(uint32_t *dwords, uint32_t sizedwords, int level)
             dump_hex(dwords, count, level+1);
 #endif
       } else if (pkt_is_type3(dwords[0])) {
+         prof_begin(PROF_PKT3);
          count = type3_pkt_size(dwords[0]) + 1;
          val = cp_type3_opcode(dwords[0]);
+         viewer_packet(ib, VIEWER_PKT, val);
          const struct type3_op *op = get_type3_op(val);
          if (op->options.load_all_groups)
             load_all_groups(level + 1);
@@ -2758,9 +4323,12 @@ dump_commands(uint32_t *dwords, uint32_t sizedwords, int level)
          op->fxn(dwords + 1, count - 1, level + 1);
          if (!quiet(2))
             dump_hex(dwords, count, level + 1);
+         prof_end();
       } else if (pkt_is_type7(dwords[0])) {
+         prof_begin(PROF_PKT7);
          count = type7_pkt_size(dwords[0]) + 1;
          val = cp_type7_opcode(dwords[0]);
+         viewer_packet(ib, VIEWER_PKT, val);
          const struct type3_op *op = get_type3_op(val);
          if (op->options.load_all_groups)
             load_all_groups(level + 1);
@@ -2783,6 +4351,7 @@ dump_commands(uint32_t *dwords, uint32_t sizedwords, int level)
          op->fxn(dwords + 1, count - 1, level + 1);
          if (!quiet(2))
             dump_hex(dwords, count, level + 1);
+         prof_end();
       } else if (pkt_is_type2(dwords[0])) {
          printl(3, "t2");
          printl(3, "%snop\n", levels[level + 1]);
@@ -2803,6 +4372,10 @@ dump_commands(uint32_t *dwords, uint32_t sizedwords, int level)
          }
       }
 
+      /* packets that triggered a draw are not counted as state: */
+      if (options->statecost && (current_draw_count == draw_count))
+         sc_packet(count);
+
       dwords += count;
       dwords_left -= count;
    }
@@ -2810,3 +4383,32 @@ dump_commands(uint32_t *dwords, uint32_t sizedwords, int level)
    if (dwords_left < 0)
       printf("**** this ain't right!! dwords_left=%d\n", dwords_left);
 }
+
+void
+cffdec_replay_summary(void)
+{
+   dump_register_summary(0);
+}
+
+/* called at the end of each submit, to print any per-submit reports: */
+void
+cffdec_end_submit(void)
+{
+   if (options->descriptors) {
+      desc_report();
+      desc_reset();
+   }
+
+   if (options->bandwidth) {
+      bw_report();
+      bw_reset();
+   }
+
+   if (options->statecost) {
+      sc_report();
+      group_cache_report();
+      sc_reset();
+   }
+
+   group_cache_reset();
+}
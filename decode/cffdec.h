@@ -64,6 +64,29 @@ struct cffdec_options {
     */
    int once;
 
+   /* In "descriptors" mode, decode texture/sampler/UBO/IBO descriptors
+    * into a deduplicated per-submit table, and show the descriptors
+    * referenced by each draw, rather than dumping them as raw hex.
+    */
+   int descriptors;
+
+   /* In "bandwidth" mode, estimate GMEM load/store and sysmem traffic
+    * per render pass, and report it per submit (a6xx only).
+    */
+   int bandwidth;
+
+   /* In "state-cost" mode, count the registers written/changed, state
+    * dwords emitted (directly vs via CP_SET_DRAW_STATE groups), groups
+    * loaded, and shader/descriptor updates per draw, and report them as
+    * per-pass histograms per submit.
+    */
+   int statecost;
+
+   /* Don't print any of the decoded cmdstream, for tools which only
+    * care about the register state at each draw (see script_draw()):
+    */
+   int silent;
+
    /* for crashdec, where we know CP_IBx_REM_SIZE, we can use this
     * to highlight the cmdstream not parsed yet, to make it easier
     * to see how far along the CP is.
@@ -77,8 +100,11 @@ struct cffdec_options {
 void printl(int lvl, const char *fmt, ...);
 const char *pktname(unsigned opc);
 uint32_t regbase(const char *name);
+unsigned findregs(const char *query, uint32_t **regbases);
 const char *regname(uint32_t regbase, int color);
 bool reg_written(uint32_t regbase);
+bool reg_rewritten(uint32_t regbase);
+bool reg_is_address(uint32_t regbase);
 uint32_t reg_lastval(uint32_t regbase);
 uint32_t reg_val(uint32_t regbase);
 void reg_set(uint32_t regbase, uint32_t val);
@@ -86,5 +112,11 @@ void reset_regs(void);
 void cffdec_init(const struct cffdec_options *options);
 void dump_register_val(uint32_t regbase, uint32_t dword, int level);
 void dump_commands(uint32_t *dwords, uint32_t sizedwords, int level);
+void cffdec_end_submit(void);
+
+void cffdec_replay_draw(const char *primtype, uint32_t num_indices);
+void cffdec_replay_render_mode(const char *mode);
+void cffdec_replay_bin(uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2);
+void cffdec_replay_summary(void);
 
 #endif /* __CFFDEC_H__ */
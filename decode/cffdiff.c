@@ -0,0 +1,700 @@
+/*
+ * Copyright © 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Compare the per-draw register state of two cmdstream captures (or two
+ * submits of the same capture).  Draws are aligned by sequence, primitive
+ * type and index count, and for each pair of aligned draws the registers
+ * with differing values are reported.  Shaders are compared by a hash of
+ * their contents, rather than by address.
+ */
+
+#include <err.h>
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "util/hash_table.h"
+#include "util/macros.h"
+
+#include "buffers.h"
+#include "cffdec.h"
+#include "io.h"
+#include "redump.h"
+#include "script.h"
+
+#define NREGS 0x10000
+
+/* max # of draws to look ahead when re-aligning the two captures: */
+#define ALIGN_WINDOW 32
+
+enum shader_stage {
+   STAGE_VS,
+   STAGE_HS,
+   STAGE_DS,
+   STAGE_GS,
+   STAGE_FS,
+   STAGE_CS,
+   STAGES,
+};
+
+static const char *stage_names[STAGES] = {
+   "VS", "HS", "DS", "GS", "FS", "CS",
+};
+
+struct reg_write {
+   uint32_t regbase;
+   uint32_t val;
+};
+
+struct draw {
+   const char *primtype;
+   uint32_t nindx;
+   unsigned submit;
+   unsigned idx;
+
+   /* registers written since the previous draw: */
+   struct reg_write *regs;
+   unsigned nregs;
+
+   /* hash of bound shader contents, or zero: */
+   uint32_t shader[STAGES];
+};
+
+struct capture {
+   const char *filename;
+   unsigned gpu_id;
+   int submit; /* submit to compare, or -1 for all */
+
+   struct draw *draws;
+   unsigned ndraws, maxdraws;
+};
+
+/* registers used to locate shaders, per stage: */
+static struct {
+   uint32_t obj_start;
+   uint32_t instrlen;
+} shader_regs[STAGES];
+
+static struct cffdec_options options = {
+   .gpu_id = 220,
+   .silent = 1,
+};
+
+static struct capture *cur_capture;
+static unsigned cur_submit;
+static unsigned cur_shader[STAGES];
+
+static int show_all;
+static int show_addresses;
+
+static void
+init_shader_regs(void)
+{
+   for (unsigned s = 0; s < STAGES; s++) {
+      static const char *suffixes[] = {"", "_REG", "_LO"};
+      char name[32];
+
+      shader_regs[s].obj_start = 0;
+      for (unsigned i = 0; i < ARRAY_SIZE(suffixes); i++) {
+         snprintf(name, sizeof(name), "SP_%s_OBJ_START%s", stage_names[s],
+                  suffixes[i]);
+         shader_regs[s].obj_start = regbase(name);
+         if (shader_regs[s].obj_start)
+            break;
+      }
+
+      snprintf(name, sizeof(name), "SP_%s_INSTRLEN", stage_names[s]);
+      shader_regs[s].instrlen = regbase(name);
+      if (!shader_regs[s].instrlen) {
+         snprintf(name, sizeof(name), "HLSQ_%s_INSTRLEN", stage_names[s]);
+         shader_regs[s].instrlen = regbase(name);
+      }
+   }
+}
+
+static bool
+is_shader_reg(uint32_t regbase)
+{
+   for (unsigned s = 0; s < STAGES; s++) {
+      uint32_t base = shader_regs[s].obj_start;
+
+      if (!base)
+         continue;
+      if ((regbase == base) ||
+          ((options.gpu_id >= 500) && (regbase == base + 1)))
+         return true;
+   }
+   return false;
+}
+
+static uint32_t
+shader_hash(enum shader_stage s)
+{
+   uint32_t base = shader_regs[s].obj_start;
+   uint64_t addr;
+   unsigned len;
+   void *ptr;
+
+   if (!base || !reg_written(base))
+      return 0;
+
+   addr = reg_val(base);
+   if (options.gpu_id >= 500)
+      addr |= ((uint64_t)reg_val(base + 1)) << 32;
+
+   ptr = hostptr(addr);
+   if (!ptr)
+      return 0;
+
+   len = hostlen(addr);
+
+   /* instrlen is in units of 16 instructions: */
+   if (shader_regs[s].instrlen && reg_val(shader_regs[s].instrlen))
+      len = MIN2(len, reg_val(shader_regs[s].instrlen) * 16 * 8);
+
+   return _mesa_hash_data(ptr, len) | 1;
+}
+
+/* called by cffdec at each draw, with the register state at the draw: */
+void
+script_draw(const char *primtype, uint32_t nindx)
+{
+   struct capture *c = cur_capture;
+   struct draw *d;
+   bool shader_dirty = false;
+
+   if (c->ndraws == c->maxdraws) {
+      c->maxdraws = MAX2(2 * c->maxdraws, 256);
+      c->draws = realloc(c->draws, c->maxdraws * sizeof(c->draws[0]));
+   }
+
+   d = &c->draws[c->ndraws];
+   memset(d, 0, sizeof(*d));
+   d->primtype = strdup(primtype ? primtype : "?");
+   d->nindx = nindx;
+   d->submit = cur_submit;
+   d->idx = c->ndraws++;
+
+   for (uint32_t regbase = 0; regbase < NREGS; regbase++) {
+      if (!reg_rewritten(regbase))
+         continue;
+
+      if ((d->nregs & (d->nregs + 1)) == 0) {
+         /* grow in powers of two: */
+         d->regs =
+            realloc(d->regs, 2 * (d->nregs + 1) * sizeof(d->regs[0]));
+      }
+
+      d->regs[d->nregs].regbase = regbase;
+      d->regs[d->nregs].val = reg_val(regbase);
+      d->nregs++;
+
+      shader_dirty |= is_shader_reg(regbase);
+   }
+
+   /* only re-hash shaders when their address changes: */
+   for (unsigned s = 0; s < STAGES; s++) {
+      if (shader_dirty || !cur_shader[s])
+         cur_shader[s] = shader_hash(s);
+      d->shader[s] = cur_shader[s];
+   }
+}
+
+static void
+parse_addr(uint32_t *buf, int sz, unsigned int *len, uint64_t *gpuaddr)
+{
+   *gpuaddr = buf[0];
+   *len = buf[1];
+   if (sz > 8)
+      *gpuaddr |= ((uint64_t)(buf[2])) << 32;
+}
+
+static int
+load_capture(struct capture *c)
+{
+   enum rd_sect_type type = RD_NONE;
+   void *buf = NULL;
+   struct io *io;
+   int submit = 0, got_gpu_id = 0;
+   int sz, ret = 0;
+   bool needs_reset = false;
+
+   cur_capture = c;
+   memset(cur_shader, 0, sizeof(cur_shader));
+
+   options.gpu_id = 220;
+   cffdec_init(&options);
+
+   io = io_open(c->filename);
+   if (!io) {
+      fprintf(stderr, "could not open: %s\n", c->filename);
+      return -1;
+   }
+
+   struct {
+      unsigned int len;
+      uint64_t gpuaddr;
+   } gpuaddr = {0};
+
+   while (true) {
+      uint32_t arr[2];
+
+      ret = io_readn(io, arr, 8);
+      if (ret <= 0)
+         break;
+
+      while ((arr[0] == 0xffffffff) && (arr[1] == 0xffffffff)) {
+         ret = io_readn(io, arr, 8);
+         if (ret <= 0)
+            goto end;
+      }
+
+      type = arr[0];
+      sz = arr[1];
+
+      if (sz < 0) {
+         ret = -1;
+         break;
+      }
+
+      free(buf);
+
+      buf = malloc(sz + 1);
+      ((char *)buf)[sz] = '\0';
+      ret = io_readn(io, buf, sz);
+      if (ret < 0)
+         break;
+
+      switch (type) {
+      case RD_GPUADDR:
+         if (needs_reset) {
+            reset_buffers();
+            needs_reset = false;
+         }
+         parse_addr(buf, sz, &gpuaddr.len, &gpuaddr.gpuaddr);
+         break;
+      case RD_BUFFER_CONTENTS:
+         add_buffer(gpuaddr.gpuaddr, gpuaddr.len, buf);
+         buf = NULL;
+         break;
+      case RD_CMDSTREAM_ADDR:
+         if ((c->submit < 0) || (c->submit == submit)) {
+            unsigned int sizedwords;
+            uint64_t gpuaddr;
+            parse_addr(buf, sz, &sizedwords, &gpuaddr);
+            cur_submit = submit;
+            dump_commands(hostptr(gpuaddr), sizedwords, 0);
+            cffdec_end_submit();
+         }
+         needs_reset = true;
+         submit++;
+         break;
+      case RD_GPU_ID:
+         if (!got_gpu_id) {
+            options.gpu_id = *((unsigned int *)buf);
+            cffdec_init(&options);
+            init_shader_regs();
+            got_gpu_id = 1;
+         }
+         break;
+      default:
+         break;
+      }
+   }
+
+end:
+   free(buf);
+   reset_buffers();
+   io_close(io);
+
+   c->gpu_id = options.gpu_id;
+
+   if (ret < 0) {
+      fprintf(stderr, "corrupt file: %s\n", c->filename);
+      return -1;
+   }
+
+   return 0;
+}
+
+/*
+ * Diffing:
+ */
+
+struct side {
+   struct capture *c;
+   unsigned next; /* next draw to apply */
+   uint32_t vals[NREGS];
+   uint8_t written[NREGS / 8];
+};
+
+static struct side sides[2];
+
+/* registers touched on either side since the last compared draw: */
+static uint32_t dirty_list[NREGS];
+static uint8_t dirty[NREGS / 8];
+static unsigned ndirty;
+
+/* per-register diff state, and # of compared draws with differences: */
+static uint8_t differs[NREGS / 8];
+static unsigned diff_since[NREGS];
+static unsigned diff_count[NREGS];
+static unsigned shader_diff_count[STAGES];
+
+/* 0 - unknown, 1 - compare, 2 - ignore */
+static uint8_t reg_filter[NREGS];
+
+static unsigned npairs, ndiff_pairs, nonly[2];
+
+#define BITSET_TEST(bs, n) (!!((bs)[(n) / 8] & (1 << ((n) % 8))))
+#define BITSET_SET(bs, n)   ((bs)[(n) / 8] |= (1 << ((n) % 8)))
+#define BITSET_CLEAR(bs, n) ((bs)[(n) / 8] &= ~(1 << ((n) % 8)))
+
+static bool
+ignore_reg(uint32_t regbase)
+{
+   if (!reg_filter[regbase]) {
+      bool ignore = is_shader_reg(regbase) ||
+                    (!show_addresses && reg_is_address(regbase));
+      reg_filter[regbase] = ignore ? 2 : 1;
+   }
+   return reg_filter[regbase] == 2;
+}
+
+/* apply the register writes from the next draw on one side: */
+static struct draw *
+apply_draw(struct side *side)
+{
+   struct draw *d = &side->c->draws[side->next++];
+
+   for (unsigned i = 0; i < d->nregs; i++) {
+      uint32_t regbase = d->regs[i].regbase;
+
+      side->vals[regbase] = d->regs[i].val;
+      BITSET_SET(side->written, regbase);
+
+      if (!BITSET_TEST(dirty, regbase)) {
+         BITSET_SET(dirty, regbase);
+         dirty_list[ndirty++] = regbase;
+      }
+   }
+
+   return d;
+}
+
+static bool
+reg_differs(uint32_t regbase)
+{
+   bool wa = BITSET_TEST(sides[0].written, regbase);
+   bool wb = BITSET_TEST(sides[1].written, regbase);
+
+   if (wa != wb)
+      return true;
+
+   return wa && (sides[0].vals[regbase] != sides[1].vals[regbase]);
+}
+
+static void
+print_reg(char sign, struct side *side, uint32_t regbase)
+{
+   printf("%c", sign);
+   if (BITSET_TEST(side->written, regbase)) {
+      dump_register_val(regbase, side->vals[regbase], 0);
+   } else {
+      printf("\t%s: (not written)\n", regname(regbase, 1));
+   }
+}
+
+static void
+print_draw(const char *label, struct draw *d)
+{
+   printf("%s%u (submit %u, %s, %u indices)", label, d->idx, d->submit,
+          d->primtype, d->nindx);
+}
+
+static void
+print_pair_header(struct draw *a, struct draw *b, bool *printed)
+{
+   if (*printed)
+      return;
+   print_draw("draw A:", a);
+   print_draw(" B:", b);
+   printf("\n");
+   *printed = true;
+}
+
+static void
+compare_draws(struct draw *a, struct draw *b)
+{
+   bool printed = false;
+
+   for (unsigned i = 0; i < ndirty; i++) {
+      uint32_t regbase = dirty_list[i];
+      bool d = reg_differs(regbase);
+
+      BITSET_CLEAR(dirty, regbase);
+
+      if (ignore_reg(regbase))
+         continue;
+
+      if (d && !BITSET_TEST(differs, regbase)) {
+         BITSET_SET(differs, regbase);
+         diff_since[regbase] = npairs;
+      } else if (!d && BITSET_TEST(differs, regbase)) {
+         BITSET_CLEAR(differs, regbase);
+         diff_count[regbase] += npairs - diff_since[regbase];
+      }
+
+      if (d && !show_all) {
+         print_pair_header(a, b, &printed);
+         print_reg('-', &sides[0], regbase);
+         print_reg('+', &sides[1], regbase);
+      }
+   }
+   ndirty = 0;
+
+   if (show_all) {
+      for (uint32_t regbase = 0; regbase < NREGS; regbase++) {
+         if (!BITSET_TEST(differs, regbase))
+            continue;
+         print_pair_header(a, b, &printed);
+         print_reg('-', &sides[0], regbase);
+         print_reg('+', &sides[1], regbase);
+      }
+   }
+
+   for (unsigned s = 0; s < STAGES; s++) {
+      if (a->shader[s] == b->shader[s])
+         continue;
+      print_pair_header(a, b, &printed);
+      printf("\t%s shader: %08x -> %08x\n", stage_names[s], a->shader[s],
+             b->shader[s]);
+      shader_diff_count[s]++;
+   }
+
+   if (printed)
+      ndiff_pairs++;
+
+   npairs++;
+}
+
+static bool
+draws_match(struct draw *a, struct draw *b)
+{
+   return (a->nindx == b->nindx) && !strcmp(a->primtype, b->primtype);
+}
+
+/* look ahead for the nearest point where the two sides re-align, and
+ * return the # of draws to skip on side A (positive) or B (negative):
+ */
+static int
+find_realign(void)
+{
+   struct capture *ca = sides[0].c, *cb = sides[1].c;
+   unsigned i = sides[0].next, j = sides[1].next;
+
+   for (unsigned k = 1; k < ALIGN_WINDOW; k++) {
+      if ((i + k < ca->ndraws) &&
+          draws_match(&ca->draws[i + k], &cb->draws[j]))
+         return k;
+      if ((j + k < cb->ndraws) &&
+          draws_match(&ca->draws[i], &cb->draws[j + k]))
+         return -k;
+   }
+
+   return 0;
+}
+
+static void
+skip_draws(unsigned n, unsigned which)
+{
+   static const char *labels[] = {"draw A:", "draw B:"};
+
+   while (n--) {
+      struct draw *d = apply_draw(&sides[which]);
+      print_draw(labels[which], d);
+      printf(": only in %c\n", "AB"[which]);
+      nonly[which]++;
+   }
+}
+
+static int
+cmp_regs(const void *a, const void *b)
+{
+   uint32_t ra = *(const uint32_t *)a, rb = *(const uint32_t *)b;
+   if (diff_count[ra] != diff_count[rb])
+      return diff_count[ra] < diff_count[rb] ? 1 : -1;
+   return ra < rb ? -1 : 1;
+}
+
+static void
+diff_captures(struct capture *a, struct capture *b)
+{
+   uint32_t *regs;
+   unsigned nregs = 0;
+
+   sides[0].c = a;
+   sides[1].c = b;
+
+   while ((sides[0].next < a->ndraws) && (sides[1].next < b->ndraws)) {
+      struct draw *da = &a->draws[sides[0].next];
+      struct draw *db = &b->draws[sides[1].next];
+
+      if (!draws_match(da, db)) {
+         int skip = find_realign();
+         if (skip > 0) {
+            skip_draws(skip, 0);
+            continue;
+         } else if (skip < 0) {
+            skip_draws(-skip, 1);
+            continue;
+         }
+         /* otherwise, no better alignment, so just compare them */
+      }
+
+      compare_draws(apply_draw(&sides[0]), apply_draw(&sides[1]));
+   }
+
+   skip_draws(a->ndraws - sides[0].next, 0);
+   skip_draws(b->ndraws - sides[1].next, 1);
+
+   printf("\nsummary: %u draws compared, %u with differences, "
+          "%u only in A, %u only in B\n",
+          npairs, ndiff_pairs, nonly[0], nonly[1]);
+
+   regs = malloc(NREGS * sizeof(regs[0]));
+   for (uint32_t regbase = 0; regbase < NREGS; regbase++) {
+      if (BITSET_TEST(differs, regbase))
+         diff_count[regbase] += npairs - diff_since[regbase];
+      if (diff_count[regbase])
+         regs[nregs++] = regbase;
+   }
+
+   qsort(regs, nregs, sizeof(regs[0]), cmp_regs);
+
+   if (nregs)
+      printf("differing registers (# of draws):\n");
+   for (unsigned i = 0; i < nregs; i++)
+      printf("\t%6u\t%s\n", diff_count[regs[i]], regname(regs[i], 1));
+
+   for (unsigned s = 0; s < STAGES; s++) {
+      if (shader_diff_count[s])
+         printf("\t%6u\t%s shader\n", shader_diff_count[s], stage_names[s]);
+   }
+
+   free(regs);
+}
+
+static void
+print_usage(const char *name)
+{
+   /* clang-format off */
+   fprintf(stderr, "Usage:\n\n"
+           "\t%s [OPTIONS]... FILE_A [FILE_B]\n\n"
+           "Compares the register state at each draw between two captures,\n"
+           "or two submits of the same capture\n\n"
+           "Options:\n"
+           "\t-a, --submit-a=N - only compare submit N of the first capture\n"
+           "\t-b, --submit-b=N - only compare submit N of the second capture\n"
+           "\t--all            - show all differing registers at each draw,\n"
+           "\t                   rather than only ones written since the\n"
+           "\t                   previous draw\n"
+           "\t--addresses      - also compare registers containing gpu\n"
+           "\t                   addresses (which normally differ between\n"
+           "\t                   captures)\n"
+           "\t--no-color       - disable colorized output (default for\n"
+           "\t                   non-console output)\n"
+           "\t--color          - enable colorized output (default for tty\n"
+           "\t                   output)\n"
+           "\t-h, --help       - show this message\n"
+           , name);
+   /* clang-format on */
+   exit(2);
+}
+
+/* clang-format off */
+static const struct option opts[] = {
+      { "submit-a",  required_argument, 0,               'a' },
+      { "submit-b",  required_argument, 0,               'b' },
+      { "all",       no_argument,       &show_all,       1 },
+      { "addresses", no_argument,       &show_addresses, 1 },
+      { "no-color",  no_argument,       &options.color,  0 },
+      { "color",     no_argument,       &options.color,  1 },
+      { "help",      no_argument,       0,               'h' },
+      {}
+};
+/* clang-format on */
+
+int
+main(int argc, char **argv)
+{
+   struct capture a = { .submit = -1 }, b = { .submit = -1 };
+   int c;
+
+   options.color = isatty(STDOUT_FILENO);
+
+   while ((c = getopt_long(argc, argv, "a:b:h", opts, NULL)) != -1) {
+      switch (c) {
+      case 0:
+         /* option that set a flag, nothing to do */
+         break;
+      case 'a':
+         a.submit = atoi(optarg);
+         break;
+      case 'b':
+         b.submit = atoi(optarg);
+         break;
+      case 'h':
+      default:
+         print_usage(argv[0]);
+      }
+   }
+
+   if ((argc - optind) == 1) {
+      /* comparing two submits of the same capture: */
+      a.filename = b.filename = argv[optind];
+   } else if ((argc - optind) == 2) {
+      a.filename = argv[optind];
+      b.filename = argv[optind + 1];
+   } else {
+      print_usage(argv[0]);
+   }
+
+   if (load_capture(&a) || load_capture(&b))
+      return -1;
+
+   if ((a.gpu_id / 100) != (b.gpu_id / 100))
+      errx(-1, "cannot compare captures from different generations");
+
+   if (a.gpu_id != b.gpu_id)
+      fprintf(stderr, "warning: comparing gpu %u vs %u\n", a.gpu_id, b.gpu_id);
+
+   diff_captures(&a, &b);
+
+   return 0;
+}
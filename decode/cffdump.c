@@ -35,6 +35,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/wait.h>
@@ -42,11 +43,16 @@
 #include "buffers.h"
 #include "cffdec.h"
 #include "disasm.h"
+#include "export.h"
 #include "io.h"
 #include "pager.h"
+#include "profile.h"
+#include "qcache.h"
 #include "redump.h"
 #include "rnnutil.h"
 #include "script.h"
+#include "server.h"
+#include "viewer.h"
 
 static struct cffdec_options options = {
    .gpu_id = 220,
@@ -56,10 +62,17 @@ static bool needs_wfi = false;
 static bool is_blob = false;
 static int show_comp = false;
 static int interactive;
+static int profile;
+static int cache;
+static int view;
 static int vertices;
 static const char *exename;
+static const char *serve_path;
+static const char *export_path;
+static bool serving;
 
 static int handle_file(const char *filename, int start, int end, int draw);
+static int view_file(const char *filename);
 
 static void
 print_usage(const char *name)
@@ -75,6 +88,11 @@ print_usage(const char *name)
            "\t--color          - enable colorized output (default for tty output)\n"
            "\t--no-pager       - disable pager (default for non-console output)\n"
            "\t--pager          - enable pager (default for tty output)\n"
+           "\t--view           - instead of paging all of the output, browse the\n"
+           "\t                   file interactively: submits are decoded as they\n"
+           "\t                   are looked at, and can be navigated by their IBs\n"
+           "\t                   and draws, or searched for where registers are\n"
+           "\t                   written or packets used\n"
            "\t-s, --summary    - don't show individual register writes, but just\n"
            "\t                   register values on draws\n"
            "\t-a, --allregs    - show all registers (including ones not written\n"
@@ -85,11 +103,24 @@ print_usage(const char *name)
            "\t-D, --draw=N     - decode only draw N\n"
            "\t-e, --exe=NAME   - only decode cmdstream from named process\n"
            "\t--textures       - dump texture contents (if possible)\n"
+           "\t--descriptors    - instead of dumping raw descriptors, show the\n"
+           "\t                   texture/sampler/UBO/IBO descriptors referenced by\n"
+           "\t                   each draw, and a deduplicated table of descriptors,\n"
+           "\t                   footprint, and format mix per pass\n"
+           "\t--bandwidth      - estimate GMEM load/store and sysmem traffic per\n"
+           "\t                   render pass, reported per submit (a6xx only);\n"
+           "\t                   should not be combined with --once\n"
+           "\t--state-cost     - count registers written/changed, state dwords\n"
+           "\t                   emitted directly vs via draw state groups, and\n"
+           "\t                   shader/descriptor updates per draw, reported as\n"
+           "\t                   per-pass histograms per submit\n"
            "\t-L, --script=LUA - run specified lua script to analyze state\n"
            "\t-q, --query=REG  - query mode, dump only specified query registers on\n"
            "\t                   each draw; multiple --query/-q args can be given to\n"
            "\t                   dump multiple registers; register can be specified\n"
-           "\t                   either by name or numeric offset\n"
+           "\t                   either by name or numeric offset, by name prefix\n"
+           "\t                   (ie. RB_MRT*), or as FIELD:NAME to dump registers\n"
+           "\t                   with bitfields or enum values starting with NAME\n"
            "\t--query-all      - in query mode, show all queried regs on each draw\n"
            "\t                   (default query mode)\n"
            "\t--query-written  - in query mode, show queried regs on draws if any of\n"
@@ -106,12 +137,39 @@ print_usage(const char *name)
            "\t                   which can be useful when looking at state that does\n"
            "\t                   not change per tile\n"
            "\t--not-once       - decode cmdstream for each IB (default)\n"
+           "\t--profile        - print a breakdown of where the decoding time\n"
+           "\t                   was spent to stderr at exit\n"
+           "\t--cache          - in query mode, save the register state of each\n"
+           "\t                   draw to FILE.fdcache, and answer later queries\n"
+           "\t                   of the same file from it rather than decoding\n"
+           "\t                   the file again (not with --query-compare,\n"
+           "\t                   --script, --draw, --exe or other modes which\n"
+           "\t                   need the buffer contents)\n"
+           "\t--export=FILE    - instead of the decoded cmdstream, write the state\n"
+           "\t                   at each draw to FILE in Parquet format, with a\n"
+           "\t                   row per draw, and columns for the draw, submit,\n"
+           "\t                   primtype, num_indices, render_mode, bin and the\n"
+           "\t                   value of each register (the queried registers in\n"
+           "\t                   query mode, otherwise all written registers,\n"
+           "\t                   which are null until first written)\n"
+           "\t--serve=SOCKET   - run as a server, decoding the requests received on\n"
+           "\t                   the Unix socket; each request is a line with the\n"
+           "\t                   arguments to decode with, and the output is sent\n"
+           "\t                   back over the connection; other options given\n"
+           "\t                   along with --serve apply to every request\n"
            "\t-h, --help       - show this message\n"
            , name);
    /* clang-format on */
    exit(2);
 }
 
+enum {
+   OPT_SERVE = 0x100,
+   OPT_EXPORT,
+};
+
+#define SHORT_OPTS "vsaS:E:F:D:e:L:q:h"
+
 /* clang-format off */
 static const struct option opts[] = {
       /* Long opts that simply set a flag (no corresponding short alias: */
@@ -120,7 +178,11 @@ static const struct option opts[] = {
       { "color",           no_argument, &options.color,         1 },
       { "no-pager",        no_argument, &interactive,           0 },
       { "pager",           no_argument, &interactive,           1 },
+      { "view",            no_argument, &view,                  1 },
       { "textures",        no_argument, &options.dump_textures, 1 },
+      { "descriptors",     no_argument, &options.descriptors,   1 },
+      { "bandwidth",       no_argument, &options.bandwidth,     1 },
+      { "state-cost",      no_argument, &options.statecost,     1 },
       { "show-compositor", no_argument, &show_comp,             1 },
       { "query-all",       no_argument, &options.query_mode,    QUERY_ALL },
       { "query-written",   no_argument, &options.query_mode,    QUERY_WRITTEN },
@@ -128,6 +190,12 @@ static const struct option opts[] = {
       { "query-compare",   no_argument, &options.query_compare, 1 },
       { "once",            no_argument, &options.once,          1 },
       { "not-once",        no_argument, &options.once,          0 },
+      { "profile",         no_argument, &profile,               1 },
+      { "cache",           no_argument, &cache,                 1 },
+
+      /* Long opts with an argument but no short alias: */
+      { "serve",     required_argument, 0, OPT_SERVE },
+      { "export",    required_argument, 0, OPT_EXPORT },
 
       /* Long opts with short alias: */
       { "verbose",   no_argument,       0, 'v' },
@@ -141,11 +209,14 @@ static const struct option opts[] = {
       { "script",    required_argument, 0, 'L' },
       { "query",     required_argument, 0, 'q' },
       { "help",      no_argument,       0, 'h' },
+      {}
 };
 /* clang-format on */
 
-int
-main(int argc, char **argv)
+static int serve(const char *path);
+
+static int
+run(int argc, char **argv)
 {
    enum debug_t debug = PRINT_RAW | PRINT_STATS;
    int ret = -1;
@@ -156,8 +227,7 @@ main(int argc, char **argv)
 
    options.color = interactive;
 
-   while ((c = getopt_long(argc, argv, "vsaS:E:F:D:e:L:q:h", opts, NULL)) !=
-          -1) {
+   while ((c = getopt_long(argc, argv, SHORT_OPTS, opts, NULL)) != -1) {
       switch (c) {
       case 0:
          /* option that set a flag, nothing to do */
@@ -200,20 +270,53 @@ main(int argc, char **argv)
          options.nquery++;
          interactive = 0;
          break;
+      case OPT_SERVE:
+         if (serving)
+            errx(-1, "--serve is not valid in a request");
+         serve_path = optarg;
+         break;
+      case OPT_EXPORT:
+         export_path = optarg;
+         break;
       case 'h':
       default:
          print_usage(argv[0]);
       }
    }
 
+   if (serve_path)
+      return serve(serve_path);
+
+   if (export_path) {
+      if (!export_open(export_path))
+         err(-1, "could not open %s", export_path);
+      /* only the state at each draw is needed, not the decoded output: */
+      options.silent = true;
+   }
+
    disasm_a2xx_set_debug(debug);
    disasm_a3xx_set_debug(debug);
 
+   if (view) {
+      if ((argc - optind) != 1)
+         errx(-1, "--view takes a single file");
+      if (options.querystrs || options.script || export_path || serving)
+         errx(-1, "--view can't be combined with --query, --script, --export "
+                  "or --serve");
+      return view_file(argv[optind]);
+   }
+
    if (interactive) {
       pager_open();
    }
 
-   while (optind < argc) {
+   /* after the pager is set up, so that it is the writes to the pager's
+    * pipe which are timed:
+    */
+   if (profile)
+      prof_init();
+
+   while ((optind < argc) && !pager_done()) {
       ret = handle_file(argv[optind], start, end, draw);
       if (ret) {
          fprintf(stderr, "error reading: %s\n", argv[optind]);
@@ -230,15 +333,282 @@ main(int argc, char **argv)
       print_usage(argv[0]);
    }
 
+   prof_begin(PROF_SCRIPT);
    script_finish();
+   prof_end();
+
+   if (!export_close())
+      ret = -1;
 
    if (interactive) {
       pager_close();
    }
 
+   prof_report(stderr);
+
    return ret;
 }
 
+int
+main(int argc, char **argv)
+{
+   return run(argc, argv);
+}
+
+/*
+ * Server mode, see server.h.  In addition to the register databases, the
+ * (decompressed) contents of the most recently used captures are kept in
+ * memory, so that the children handling later requests for the same
+ * capture don't need to read and decompress it again.
+ */
+
+#define MAX_CAPTURES      4
+#define MAX_CAPTURE_CACHE (1u << 30)
+#define MAX_CAPTURE_SIZE  (MAX_CAPTURE_CACHE / MAX_CAPTURES)
+
+static struct capture {
+   char *path;
+   struct stat st;
+   void *data;
+   unsigned len;
+   unsigned last_used;
+} captures[MAX_CAPTURES];
+static unsigned capture_clock;
+
+/* The captures found to be too large once decompressed, so that they
+ * aren't read again for each request (without the data):
+ */
+static struct capture too_large[MAX_CAPTURES];
+static unsigned ntoo_large;
+
+static bool
+same_capture(const struct capture *c, const char *path,
+             const struct stat *st)
+{
+   /* the file could have been replaced since it was cached: */
+   return c->path && !strcmp(c->path, path) &&
+          (c->st.st_dev == st->st_dev) && (c->st.st_ino == st->st_ino) &&
+          (c->st.st_size == st->st_size) &&
+          (c->st.st_mtim.tv_sec == st->st_mtim.tv_sec) &&
+          (c->st.st_mtim.tv_nsec == st->st_mtim.tv_nsec);
+}
+
+static struct capture *
+find_capture(const char *path, const struct stat *st)
+{
+   for (unsigned i = 0; i < ARRAY_SIZE(captures); i++)
+      if (same_capture(&captures[i], path, st))
+         return &captures[i];
+
+   return NULL;
+}
+
+static bool
+is_too_large(const char *path, const struct stat *st)
+{
+   for (unsigned i = 0; i < ARRAY_SIZE(too_large); i++)
+      if (same_capture(&too_large[i], path, st))
+         return true;
+
+   return false;
+}
+
+static void
+set_too_large(const char *path, const struct stat *st)
+{
+   struct capture *c = &too_large[ntoo_large++ % ARRAY_SIZE(too_large)];
+
+   free(c->path);
+   c->path = strdup(path);
+   c->st = *st;
+}
+
+static void
+evict_capture(void)
+{
+   struct capture *lru = NULL;
+
+   for (unsigned i = 0; i < ARRAY_SIZE(captures); i++) {
+      if (captures[i].path &&
+          (!lru || (captures[i].last_used < lru->last_used)))
+         lru = &captures[i];
+   }
+
+   if (lru) {
+      free(lru->path);
+      free(lru->data);
+      memset(lru, 0, sizeof(*lru));
+   }
+}
+
+/* Returns true if the capture had to be read: */
+static bool
+cache_capture(const char *path)
+{
+   struct capture *c;
+   struct stat st;
+   struct io *io;
+   char *data = NULL;
+   unsigned len = 0, size = 0;
+
+   if (!strcmp(path, "-") || stat(path, &st) || !S_ISREG(st.st_mode))
+      return false;
+
+   c = find_capture(path, &st);
+   if (c) {
+      c->last_used = ++capture_clock;
+      return false;
+   }
+
+   /* too large to keep around (even before decompressing it): */
+   if ((st.st_size >= MAX_CAPTURE_SIZE) || is_too_large(path, &st))
+      return false;
+
+   io = io_open(path);
+   if (!io)
+      return false;
+
+   while (true) {
+      if (len == size) {
+         if (size >= MAX_CAPTURE_SIZE) {
+            set_too_large(path, &st);
+            free(data);
+            io_close(io);
+            return true;
+         }
+         size = size ? size * 2 : 0x100000;
+         char *new_data = realloc(data, size);
+         if (!new_data) {
+            free(data);
+            io_close(io);
+            return true;
+         }
+         data = new_data;
+      }
+
+      int ret = io_readn(io, data + len, size - len);
+      if (ret < 0) {
+         free(data);
+         io_close(io);
+         return true;
+      }
+      if (ret == 0)
+         break;
+      len += ret;
+   }
+
+   io_close(io);
+
+   while (true) {
+      unsigned total = len, nfree = 0;
+
+      for (unsigned i = 0; i < ARRAY_SIZE(captures); i++) {
+         total += captures[i].len;
+         if (!captures[i].path)
+            nfree++;
+      }
+
+      if (nfree && (total <= MAX_CAPTURE_CACHE))
+         break;
+
+      evict_capture();
+   }
+
+   for (unsigned i = 0; i < ARRAY_SIZE(captures); i++) {
+      c = &captures[i];
+      if (!c->path)
+         break;
+   }
+
+   c->path = strdup(path);
+   c->st = st;
+   c->data = realloc(data, len);
+   c->len = len;
+   c->last_used = ++capture_clock;
+
+   return true;
+}
+
+static struct io *
+open_capture(const char *filename)
+{
+   if (serving && strcmp(filename, "-")) {
+      struct stat st;
+
+      if (!stat(filename, &st)) {
+         struct capture *c = find_capture(filename, &st);
+         if (c)
+            return io_openmem(c->data, c->len);
+      }
+   }
+
+   if (!strcmp(filename, "-"))
+      return io_openfd(0);
+
+   return io_open(filename);
+}
+
+static void
+prepare_request(int argc, char **argv)
+{
+   struct option scan_opts[ARRAY_SIZE(opts)];
+
+   /* Find the files to be decoded, without acting on the options, so
+    * without the flags being set:
+    */
+   for (unsigned i = 0; i < ARRAY_SIZE(opts); i++) {
+      scan_opts[i] = opts[i];
+      scan_opts[i].flag = NULL;
+   }
+
+   opterr = 0;
+   optind = 0;
+   while (getopt_long(argc, argv, SHORT_OPTS, scan_opts, NULL) != -1)
+      ;
+   opterr = 1;
+
+   /* The server can't accept the next connection until this returns, so
+    * read at most one capture per request:
+    */
+   for (int i = optind; i < argc; i++)
+      if (cache_capture(argv[i]))
+         break;
+}
+
+static int
+handle_request(int argc, char **argv)
+{
+   serving = true;
+   serve_path = NULL;
+
+   /* start over, after the server's own use of getopt: */
+   optind = 0;
+
+   return run(argc, argv);
+}
+
+static int
+serve(const char *path)
+{
+   static const struct server_ops ops = {
+      .prepare = prepare_request,
+      .handle = handle_request,
+   };
+   static const char *gpus[] = {
+      "a2xx", "a3xx", "a4xx", "a5xx", "a6xx",
+   };
+
+   /* The output is usually not to a terminal, so is without colors, but
+    * a request can ask for them:
+    */
+   for (unsigned i = 0; i < ARRAY_SIZE(gpus); i++) {
+      rnn_warm(rnn_get_gpu(gpus[i], true));
+      rnn_warm(rnn_get_gpu(gpus[i], false));
+   }
+
+   return server_run(path, &ops);
+}
+
 static void
 parse_addr(uint32_t *buf, int sz, unsigned int *len, uint64_t *gpuaddr)
 {
@@ -248,6 +618,34 @@ parse_addr(uint32_t *buf, int sz, unsigned int *len, uint64_t *gpuaddr)
       *gpuaddr |= ((uint64_t)(buf[2])) << 32;
 }
 
+static int
+readn(struct io *io, void *buf, int nbytes)
+{
+   int ret;
+
+   prof_begin(PROF_IO);
+   ret = io_readn(io, buf, nbytes);
+   prof_end();
+
+   return ret;
+}
+
+/* Should the submits following an RD_CMD with the given process name be
+ * skipped:
+ */
+static bool
+skip_cmd(const char *cmd)
+{
+   if (exename)
+      return strstr(cmd, exename) != cmd;
+
+   if (show_comp)
+      return false;
+
+   return (strstr(cmd, "fdperf") == cmd) || (strstr(cmd, "chrome") == cmd) ||
+          (strstr(cmd, "surfaceflinger") == cmd) || (cmd[0] == 'X');
+}
+
 static int
 handle_file(const char *filename, int start, int end, int draw)
 {
@@ -265,18 +663,29 @@ handle_file(const char *filename, int start, int end, int draw)
 
    printf("Reading %s...\n", filename);
 
+   /* which submits are decoded also depends on these: */
+   bool cacheable = cache && !exename && !show_comp;
+
+   if (cacheable && qcache_replay(filename, &options, start, end))
+      return 0;
+
+   prof_begin(PROF_SCRIPT);
    script_start_cmdstream(filename);
+   prof_end();
 
-   if (!strcmp(filename, "-"))
-      io = io_openfd(0);
-   else
-      io = io_open(filename);
+   prof_begin(PROF_IO);
+   io = open_capture(filename);
+   prof_end();
 
    if (!io) {
       fprintf(stderr, "could not open: %s\n", filename);
       return -1;
    }
 
+   /* a recording is only complete if all submits are decoded: */
+   if (cacheable && (start == 0) && (end == 0x7ffffff))
+      qcache_record_begin(filename, &options);
+
    struct {
       unsigned int len;
       uint64_t gpuaddr;
@@ -285,12 +694,16 @@ handle_file(const char *filename, int start, int end, int draw)
    while (true) {
       uint32_t arr[2];
 
-      ret = io_readn(io, arr, 8);
+      /* nobody is looking at the output anymore: */
+      if (pager_done())
+         goto end;
+
+      ret = readn(io, arr, 8);
       if (ret <= 0)
          goto end;
 
       while ((arr[0] == 0xffffffff) && (arr[1] == 0xffffffff)) {
-         ret = io_readn(io, arr, 8);
+         ret = readn(io, arr, 8);
          if (ret <= 0)
             goto end;
       }
@@ -309,7 +722,7 @@ handle_file(const char *filename, int start, int end, int draw)
 
       buf = malloc(sz + 1);
       ((char *)buf)[sz] = '\0';
-      ret = io_readn(io, buf, sz);
+      ret = readn(io, buf, sz);
       if (ret < 0)
          goto end;
 
@@ -320,15 +733,7 @@ handle_file(const char *filename, int start, int end, int draw)
       case RD_CMD:
          is_blob = true;
          printl(2, "cmd: %s\n", (char *)buf);
-         skip = false;
-         if (exename) {
-            skip |= (strstr(buf, exename) != buf);
-         } else if (!show_comp) {
-            skip |= (strstr(buf, "fdperf") == buf);
-            skip |= (strstr(buf, "chrome") == buf);
-            skip |= (strstr(buf, "surfaceflinger") == buf);
-            skip |= ((char *)buf)[0] == 'X';
-         }
+         skip = skip_cmd(buf);
          break;
       case RD_VERT_SHADER:
          printl(2, "vertex shader:\n%s\n", (char *)buf);
@@ -355,9 +760,17 @@ handle_file(const char *filename, int start, int end, int draw)
             printl(2, "############################################################\n");
             printl(2, "cmdstream: %d dwords\n", sizedwords);
             if (!skip) {
+               qcache_record_submit(submit);
+               export_start_submit(submit);
+               prof_begin(PROF_SCRIPT);
                script_start_submit();
+               prof_end();
                dump_commands(hostptr(gpuaddr), sizedwords, 0);
+               prof_begin(PROF_SCRIPT);
                script_end_submit();
+               prof_end();
+               qcache_record_submit_end();
+               cffdec_end_submit();
             }
             printl(2, "############################################################\n");
             printl(2, "vertices: %d\n", vertices);
@@ -379,7 +792,9 @@ handle_file(const char *filename, int start, int end, int draw)
    }
 
 end:
+   prof_begin(PROF_SCRIPT);
    script_end_cmdstream();
+   prof_end();
 
    io_close(io);
    fflush(stdout);
@@ -387,5 +802,95 @@ end:
    if (ret < 0) {
       printf("corrupt file\n");
    }
+
+   /* an early exit leaves the recording incomplete: */
+   qcache_record_end(!pager_done());
+
    return 0;
 }
+
+/* The viewer needs random access to the capture, so it is mapped, after
+ * decompressing it to a temporary file if needed:
+ */
+static void *
+map_capture(const char *filename, size_t *len)
+{
+   struct stat st;
+   void *map;
+   int fd;
+
+   if (check_extension(filename, ".rd")) {
+      fd = open(filename, O_RDONLY);
+   } else {
+      struct io *io = io_open(filename);
+      char buf[0x10000];
+      FILE *f;
+      int ret;
+
+      if (!io)
+         return NULL;
+
+      f = tmpfile();
+      if (!f) {
+         io_close(io);
+         return NULL;
+      }
+
+      while ((ret = io_readn(io, buf, sizeof(buf))) > 0) {
+         if (fwrite(buf, ret, 1, f) != 1) {
+            ret = -1;
+            break;
+         }
+      }
+
+      io_close(io);
+
+      fd = ((ret == 0) && !fflush(f)) ? dup(fileno(f)) : -1;
+      fclose(f);
+   }
+
+   if (fd < 0)
+      return NULL;
+
+   if (fstat(fd, &st) || !st.st_size) {
+      close(fd);
+      return NULL;
+   }
+
+   map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+   close(fd);
+
+   if (map == MAP_FAILED)
+      return NULL;
+
+   *len = st.st_size;
+
+   return map;
+}
+
+static int
+view_file(const char *filename)
+{
+   size_t len;
+   void *capture;
+   int ret;
+
+   /* the commands are read from stdin: */
+   if (!strcmp(filename, "-"))
+      errx(-1, "--view can't read the file from stdin");
+
+   /* the viewer has its own way of picking draws: */
+   options.draw_filter = -1;
+
+   capture = map_capture(filename, &len);
+   if (!capture) {
+      fprintf(stderr, "could not open: %s\n", filename);
+      return -1;
+   }
+
+   ret = viewer_run(filename, capture, len, &options, skip_cmd);
+
+   munmap(capture, len);
+
+   return ret;
+}
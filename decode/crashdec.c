@@ -37,6 +37,7 @@
  */
 
 #include <assert.h>
+#include <err.h>
 #include <getopt.h>
 #include <inttypes.h>
 #include <stdarg.h>
@@ -54,7 +55,9 @@
 #include "cffdec.h"
 #include "disasm.h"
 #include "pager.h"
+#include "profile.h"
 #include "rnnutil.h"
+#include "server.h"
 #include "util.h"
 
 static FILE *in;
@@ -64,6 +67,9 @@ static struct rnn *rnn_gmu;
 static struct rnn *rnn_control;
 static struct rnn *rnn_pipe;
 
+static char **querystrs;
+static int nquery;
+
 static struct cffdec_options options = {
    .draw_filter = -1,
 };
@@ -145,7 +151,10 @@ popline(void)
    free(lastline);
 
    size_t n = 0;
-   if (getline(&r, &n, in) < 0)
+   prof_begin(PROF_IO);
+   ssize_t ret = getline(&r, &n, in);
+   prof_end();
+   if (ret < 0)
       exit(0);
 
    /* Handle section name typo's from earlier kernels: */
@@ -412,12 +421,77 @@ decode_bos(void)
  * Decode registers section:
  */
 
+static int
+cmp_regbase(const void *a, const void *b)
+{
+   uint32_t ra = *(const uint32_t *)a, rb = *(const uint32_t *)b;
+   return (ra > rb) - (ra < rb);
+}
+
+/* With --query, only the queried registers are shown in the register
+ * sections.  The queries are resolved against each of the register
+ * databases the first time a register from it is shown (rnn is NULL
+ * for the main one):
+ */
+static bool
+query_match(struct rnn *rnn, uint32_t regbase)
+{
+   static struct {
+      struct rnn *rnn;
+      uint32_t *regbases;
+      unsigned n;
+   } dbs[4];
+   int d;
+
+   if (!nquery)
+      return true;
+
+   for (d = 0; d < ARRAY_SIZE(dbs) - 1; d++)
+      if (!dbs[d].regbases || dbs[d].rnn == rnn)
+         break;
+
+   if (!dbs[d].regbases || dbs[d].rnn != rnn) {
+      free(dbs[d].regbases);
+      dbs[d].rnn = rnn;
+      dbs[d].regbases = malloc(sizeof(uint32_t));
+      dbs[d].n = 0;
+
+      for (int i = 0; i < nquery; i++) {
+         uint32_t val = strtoul(querystrs[i], NULL, 0);
+         uint32_t *regbases;
+         unsigned n;
+
+         if (val) {
+            regbases = malloc(sizeof(uint32_t));
+            regbases[0] = val;
+            n = 1;
+         } else {
+            n = rnn ? rnn_findregs(rnn, querystrs[i], &regbases)
+                    : findregs(querystrs[i], &regbases);
+         }
+
+         dbs[d].regbases = realloc(dbs[d].regbases,
+                                   (dbs[d].n + n + 1) * sizeof(uint32_t));
+         memcpy(&dbs[d].regbases[dbs[d].n], regbases, n * sizeof(uint32_t));
+         dbs[d].n += n;
+         free(regbases);
+      }
+
+      qsort(dbs[d].regbases, dbs[d].n, sizeof(uint32_t), cmp_regbase);
+   }
+
+   return bsearch(&regbase, dbs[d].regbases, dbs[d].n, sizeof(uint32_t),
+                  cmp_regbase);
+}
+
 static void
 dump_register(struct rnn *rnn, uint32_t offset, uint32_t value)
 {
    struct rnndecaddrinfo *info = rnn_reginfo(rnn, offset);
    if (info && info->typeinfo) {
+      prof_begin(PROF_RNN);
       char *decoded = rnndec_decodeval(rnn->vc, info->typeinfo, value);
+      prof_end();
       printf("%s: %s\n", info->name, decoded);
    } else if (info) {
       printf("%s: %08x\n", info->name, value);
@@ -433,6 +507,9 @@ decode_gmu_registers(void)
       uint32_t offset, value;
       parseline(line, "  - { offset: %x, value: %x }", &offset, &value);
 
+      if (!query_match(rnn_gmu, offset / 4))
+         continue;
+
       printf("\t%08x\t", value);
       dump_register(rnn_gmu, offset / 4, value);
    }
@@ -446,6 +523,10 @@ decode_registers(void)
       parseline(line, "  - { offset: %x, value: %x }", &offset, &value);
 
       reg_set(offset / 4, value);
+
+      if (!query_match(NULL, offset / 4))
+         continue;
+
       printf("\t%08x", value);
       dump_register_val(offset / 4, value, 0);
    }
@@ -465,6 +546,9 @@ decode_clusters(void)
       uint32_t offset, value;
       parseline(line, "      - { offset: %x, value: %x }", &offset, &value);
 
+      if (!query_match(NULL, offset / 4))
+         continue;
+
       printf("\t%08x", value);
       dump_register_val(offset / 4, value, 0);
    }
@@ -510,6 +594,8 @@ dump_control_regs(uint32_t *regs)
     * directly.
     */
    for (uint32_t i = 0; i < 0x80; i++) {
+      if (!query_match(rnn_control, i + 0x100))
+         continue;
       printf("\t%08x\t", regs[i]);
       dump_register(rnn_control, i + 0x100, regs[i]);
    }
@@ -918,7 +1004,9 @@ decode_shader_blocks(void)
              * (or parts of shaders?), so perhaps we should search
              * for ends of shaders and decode each?
              */
+            prof_begin(PROF_DISASM);
             try_disasm_a3xx(buf, sizedwords, 1, stdout, options.gpu_id);
+            prof_end();
          }
 
          if (dump)
@@ -975,35 +1063,45 @@ decode_debugbus(void)
  * Main crashdump decode loop:
  */
 
+static void
+load_rnns(void)
+{
+   int nocolor = !options.color;
+
+   /* The gmu/control/pipe register databases are independent of
+    * the main one, so load them in parallel with it:
+    */
+   if (is_a6xx()) {
+      rnn_gmu = rnn_get("adreno/a6xx_gmu.xml", "A6XX", nocolor, true);
+      rnn_control = rnn_get("adreno/adreno_control_regs.xml",
+                            "A6XX_CONTROL_REG", nocolor, true);
+      rnn_pipe = rnn_get("adreno/adreno_pipe_regs.xml", "A6XX_PIPE_REG",
+                         nocolor, true);
+   } else if (is_a5xx()) {
+      rnn_control = rnn_get("adreno/adreno_control_regs.xml",
+                            "A5XX_CONTROL_REG", nocolor, true);
+   } else {
+      rnn_control = NULL;
+   }
+
+   cffdec_init(&options);
+
+   rnn_load_wait(rnn_gmu);
+   rnn_load_wait(rnn_control);
+   rnn_load_wait(rnn_pipe);
+}
+
 static void
 decode(void)
 {
    const char *line;
 
-   while ((line = popline())) {
+   while ((line = popline()) && !pager_done()) {
       printf("%s", line);
       if (startswith(line, "revision:")) {
          parseline(line, "revision: %u", &options.gpu_id);
          printf("Got gpu_id=%u\n", options.gpu_id);
-
-         cffdec_init(&options);
-
-         if (is_a6xx()) {
-            rnn_gmu = rnn_new(!options.color);
-            rnn_load_file(rnn_gmu, "adreno/a6xx_gmu.xml", "A6XX");
-            rnn_control = rnn_new(!options.color);
-            rnn_load_file(rnn_control, "adreno/adreno_control_regs.xml",
-                          "A6XX_CONTROL_REG");
-            rnn_pipe = rnn_new(!options.color);
-            rnn_load_file(rnn_pipe, "adreno/adreno_pipe_regs.xml",
-                          "A6XX_PIPE_REG");
-         } else if (is_a5xx()) {
-            rnn_control = rnn_new(!options.color);
-            rnn_load_file(rnn_control, "adreno/adreno_control_regs.xml",
-                          "A5XX_CONTROL_REG");
-         } else {
-            rnn_control = NULL;
-         }
+         load_rnns();
       } else if (startswith(line, "bos:")) {
          decode_bos();
       } else if (startswith(line, "ringbuffer:")) {
@@ -1038,7 +1136,7 @@ usage(void)
 {
    /* clang-format off */
    fprintf(stderr, "Usage:\n\n"
-           "\tcrashdec [-achmsv] [-f FILE]\n\n"
+           "\tcrashdec [-achmpsv] [-f FILE] [-q REG]...\n\n"
            "Options:\n"
            "\t-a, --allregs   - show all registers (including ones not written since\n"
            "\t                  previous draw) at each draw\n"
@@ -1046,16 +1144,32 @@ usage(void)
            "\t-f, --file=FILE - read input from specified file (rather than stdin)\n"
            "\t-h, --help      - this usage message\n"
            "\t-m, --markers   - try to decode CP_NOP string markers\n"
+           "\t-p, --profile   - print a breakdown of where the decoding time was\n"
+           "\t                  spent to stderr at exit\n"
+           "\t-q, --query=REG - only show the specified registers in the register\n"
+           "\t                  sections; can be given multiple times, and REG can\n"
+           "\t                  be a name, offset, name prefix (ie. CP_SQE*), or\n"
+           "\t                  FIELD:NAME for registers with bitfields or enum\n"
+           "\t                  values starting with NAME\n"
            "\t-s, --summary   - don't show individual register writes, but just show\n"
            "\t                  register values on draws\n"
            "\t-v, --verbose   - dump more verbose output, including contents of\n"
            "\t                  less interesting buffers\n"
+           "\t--serve=SOCKET  - run as a server, decoding the requests received on\n"
+           "\t                  the Unix socket; each request is a line with the\n"
+           "\t                  arguments to decode with (without -f, the crashdump\n"
+           "\t                  is read from the rest of the connection), and the\n"
+           "\t                  output is sent back over the connection\n"
            "\n"
    );
    /* clang-format on */
    exit(2);
 }
 
+enum {
+   OPT_SERVE = 0x100,
+};
+
 /* clang-format off */
 static const struct option opts[] = {
       { .name = "allregs", .has_arg = 0, NULL, 'a' },
@@ -1063,13 +1177,19 @@ static const struct option opts[] = {
       { .name = "file",    .has_arg = 1, NULL, 'f' },
       { .name = "help",    .has_arg = 0, NULL, 'h' },
       { .name = "markers", .has_arg = 0, NULL, 'm' },
+      { .name = "profile", .has_arg = 0, NULL, 'p' },
+      { .name = "query",   .has_arg = 1, NULL, 'q' },
       { .name = "summary", .has_arg = 0, NULL, 's' },
       { .name = "verbose", .has_arg = 0, NULL, 'v' },
+      { .name = "serve",   .has_arg = 1, NULL, OPT_SERVE },
       {}
 };
 /* clang-format on */
 
 static bool interactive;
+static bool profile;
+static const char *serve_path;
+static bool serving;
 
 static void
 cleanup(void)
@@ -1079,10 +1199,14 @@ cleanup(void)
    if (interactive) {
       pager_close();
    }
+
+   prof_report(stderr);
 }
 
-int
-main(int argc, char **argv)
+static int serve(const char *path);
+
+static int
+run(int argc, char **argv)
 {
    int c;
 
@@ -1092,7 +1216,7 @@ main(int argc, char **argv)
    /* default to read from stdin: */
    in = stdin;
 
-   while ((c = getopt_long(argc, argv, "acf:hmsv", opts, NULL)) != -1) {
+   while ((c = getopt_long(argc, argv, "acf:hmpq:sv", opts, NULL)) != -1) {
       switch (c) {
       case 'a':
          options.allregs = true;
@@ -1106,18 +1230,36 @@ main(int argc, char **argv)
       case 'm':
          options.decode_markers = true;
          break;
+      case 'p':
+         profile = true;
+         break;
+      case 'q':
+         querystrs = realloc(querystrs, (nquery + 1) * sizeof(*querystrs));
+         querystrs[nquery++] = optarg;
+         break;
       case 's':
          options.summary = true;
          break;
       case 'v':
          verbose = true;
          break;
+      case OPT_SERVE:
+         if (serving)
+            errx(-1, "--serve is not valid in a request");
+         serve_path = optarg;
+         break;
       case 'h':
       default:
          usage();
       }
    }
 
+   if (serve_path)
+      return serve(serve_path);
+
+   if (profile)
+      prof_init();
+
    disasm_a3xx_set_debug(PRINT_RAW);
 
    if (interactive) {
@@ -1128,4 +1270,64 @@ main(int argc, char **argv)
 
    decode();
    cleanup();
+
+   return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+   return run(argc, argv);
+}
+
+/*
+ * Server mode, see server.h:
+ */
+
+static int
+handle_request(int argc, char **argv)
+{
+   serving = true;
+   serve_path = NULL;
+
+   /* start over, after the server's own use of getopt: */
+   optind = 0;
+
+   return run(argc, argv);
+}
+
+static int
+serve(const char *path)
+{
+   static const struct server_ops ops = {
+      .handle = handle_request,
+   };
+   static const unsigned gpu_ids[] = {
+      540, 630,
+   };
+
+   /* The output is usually not to a terminal, so is without colors, but
+    * a request can ask for them:
+    */
+   for (int color = 0; color < 2; color++) {
+      options.color = color;
+      for (unsigned i = 0; i < ARRAY_SIZE(gpu_ids); i++) {
+         options.gpu_id = gpu_ids[i];
+         load_rnns();
+         rnn_warm(rnn_get_gpu(is_a6xx() ? "a6xx" : "a5xx", !color));
+         if (rnn_gmu)
+            rnn_warm(rnn_gmu);
+         if (rnn_control)
+            rnn_warm(rnn_control);
+         if (rnn_pipe)
+            rnn_warm(rnn_pipe);
+      }
+   }
+
+   /* the requests start from scratch, with the warmed up databases: */
+   options.gpu_id = 0;
+   options.color = false;
+   rnn_gmu = rnn_control = rnn_pipe = NULL;
+
+   return server_run(path, &ops);
 }
@@ -0,0 +1,651 @@
+/*
+ * Copyright © 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cffdec.h"
+#include "export.h"
+
+/*
+ * Parquet definitions, see parquet.thrift in the parquet-format project:
+ */
+
+enum parquet_type {
+   PARQUET_INT32 = 1,
+   PARQUET_BYTE_ARRAY = 6,
+};
+
+enum parquet_converted_type {
+   PARQUET_UTF8 = 0,
+   PARQUET_UINT_32 = 13,
+};
+
+enum parquet_encoding {
+   PARQUET_PLAIN = 0,
+   PARQUET_RLE = 3,
+   PARQUET_RLE_DICTIONARY = 8,
+};
+
+enum parquet_page_type {
+   PARQUET_DATA_PAGE = 0,
+   PARQUET_DICTIONARY_PAGE = 2,
+};
+
+#define PARQUET_REQUIRED 0
+#define PARQUET_OPTIONAL 1
+#define PARQUET_MAGIC    "PAR1"
+
+/*
+ * Thrift compact protocol encoding, which the Parquet metadata uses:
+ */
+
+enum thrift_type {
+   THRIFT_I32 = 5,
+   THRIFT_I64 = 6,
+   THRIFT_BINARY = 8,
+   THRIFT_LIST = 9,
+   THRIFT_STRUCT = 12,
+};
+
+struct buf {
+   uint8_t *data;
+   size_t size, cap;
+
+   /* the last field id of each nested thrift struct: */
+   int16_t fid[8];
+   unsigned depth;
+};
+
+static void
+buf_add(struct buf *b, const void *data, size_t size)
+{
+   if (b->size + size > b->cap) {
+      b->cap = MAX2(MAX2(b->cap * 2, b->size + size), 0x1000);
+      b->data = realloc(b->data, b->cap);
+   }
+   memcpy(b->data + b->size, data, size);
+   b->size += size;
+}
+
+static void
+buf_byte(struct buf *b, uint8_t v)
+{
+   buf_add(b, &v, 1);
+}
+
+static void
+buf_u32(struct buf *b, uint32_t v)
+{
+   uint8_t bytes[4] = {v, v >> 8, v >> 16, v >> 24};
+   buf_add(b, bytes, 4);
+}
+
+static void
+buf_varint(struct buf *b, uint64_t v)
+{
+   while (v >= 0x80) {
+      buf_byte(b, (v & 0x7f) | 0x80);
+      v >>= 7;
+   }
+   buf_byte(b, v);
+}
+
+static void
+thrift_field(struct buf *b, int16_t fid, enum thrift_type type)
+{
+   int16_t delta = fid - b->fid[b->depth];
+
+   if ((delta > 0) && (delta <= 15)) {
+      buf_byte(b, (delta << 4) | type);
+   } else {
+      buf_byte(b, type);
+      buf_varint(b, (uint16_t)((fid << 1) ^ (fid >> 15)));
+   }
+
+   b->fid[b->depth] = fid;
+}
+
+static void
+thrift_i64(struct buf *b, int16_t fid, int64_t v)
+{
+   thrift_field(b, fid, THRIFT_I64);
+   buf_varint(b, ((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+}
+
+static void
+thrift_i32(struct buf *b, int16_t fid, int32_t v)
+{
+   thrift_field(b, fid, THRIFT_I32);
+   buf_varint(b, (uint32_t)(((uint32_t)v << 1) ^ (uint32_t)(v >> 31)));
+}
+
+static void
+thrift_string(struct buf *b, int16_t fid, const char *str)
+{
+   thrift_field(b, fid, THRIFT_BINARY);
+   buf_varint(b, strlen(str));
+   buf_add(b, str, strlen(str));
+}
+
+static void
+thrift_list(struct buf *b, int16_t fid, enum thrift_type type, unsigned n)
+{
+   thrift_field(b, fid, THRIFT_LIST);
+   if (n < 15) {
+      buf_byte(b, (n << 4) | type);
+   } else {
+      buf_byte(b, 0xf0 | type);
+      buf_varint(b, n);
+   }
+}
+
+/* a struct within a list, or a struct field if fid is non-zero: */
+static void
+thrift_begin(struct buf *b, int16_t fid)
+{
+   if (fid)
+      thrift_field(b, fid, THRIFT_STRUCT);
+   assert(b->depth + 1 < ARRAY_SIZE(b->fid));
+   b->fid[++b->depth] = 0;
+}
+
+static void
+thrift_end(struct buf *b)
+{
+   buf_byte(b, 0);
+   b->depth--;
+}
+
+/*
+ * The columns, with the values stored as runs of repeated values:
+ */
+
+struct run {
+   uint32_t val, count;
+};
+
+struct column {
+   char *name;
+   uint32_t regbase;
+
+   /* for string columns, the values are indices into strs: */
+   bool string;
+   const char **strs;
+   unsigned nstrs;
+
+   struct run *runs;
+   unsigned nruns, cap;
+
+   /* # of leading rows without a value, for registers first written after
+    * some of the draws, which makes the column optional:
+    */
+   unsigned nnulls;
+};
+
+enum {
+   COL_DRAW,
+   COL_SUBMIT,
+   COL_PRIMTYPE,
+   COL_NUM_INDICES,
+   COL_RENDER_MODE,
+   COL_BIN_X1,
+   COL_BIN_Y1,
+   COL_BIN_X2,
+   COL_BIN_Y2,
+   NUM_META_COLS,
+};
+
+static const char *meta_names[NUM_META_COLS] = {
+   [COL_DRAW] = "draw",
+   [COL_SUBMIT] = "submit",
+   [COL_PRIMTYPE] = "primtype",
+   [COL_NUM_INDICES] = "num_indices",
+   [COL_RENDER_MODE] = "render_mode",
+   [COL_BIN_X1] = "bin_x1",
+   [COL_BIN_Y1] = "bin_y1",
+   [COL_BIN_X2] = "bin_x2",
+   [COL_BIN_Y2] = "bin_y2",
+};
+
+bool export_enabled;
+
+static struct {
+   FILE *f;
+   char *path;
+
+   unsigned nrows;
+   int submit;
+
+   struct column meta[NUM_META_COLS];
+
+   /* in query mode, only the queried registers are exported: */
+   bool query;
+
+   /* the register columns, and the column of each register, if any: */
+   struct column **regs;
+   unsigned nregs;
+   int32_t regcol[0x10000];
+} *out;
+
+static void
+column_add(struct column *col, uint32_t val)
+{
+   if (col->nruns && (col->runs[col->nruns - 1].val == val)) {
+      col->runs[col->nruns - 1].count++;
+      return;
+   }
+
+   if (col->nruns == col->cap) {
+      col->cap = MAX2(col->cap * 2, 16);
+      col->runs = realloc(col->runs, col->cap * sizeof(*col->runs));
+   }
+
+   col->runs[col->nruns++] = (struct run){
+      .val = val,
+      .count = 1,
+   };
+}
+
+static uint32_t
+column_str(struct column *col, const char *str)
+{
+   if (!str)
+      str = "";
+
+   for (unsigned i = 0; i < col->nstrs; i++)
+      if (!strcmp(col->strs[i], str))
+         return i;
+
+   col->strs = realloc(col->strs, (col->nstrs + 1) * sizeof(*col->strs));
+   col->strs[col->nstrs] = strdup(str);
+
+   return col->nstrs++;
+}
+
+static void
+free_column(struct column *col)
+{
+   for (unsigned i = 0; i < col->nstrs; i++)
+      free((char *)col->strs[i]);
+   free(col->strs);
+   free(col->runs);
+   free(col->name);
+}
+
+bool
+export_open(const char *path)
+{
+   FILE *f = fopen(path, "w");
+   if (!f)
+      return false;
+
+   out = calloc(1, sizeof(*out));
+   out->f = f;
+   out->path = strdup(path);
+   out->submit = -1;
+
+   for (unsigned i = 0; i < NUM_META_COLS; i++)
+      out->meta[i].name = strdup(meta_names[i]);
+   out->meta[COL_PRIMTYPE].string = true;
+   out->meta[COL_RENDER_MODE].string = true;
+
+   memset(out->regcol, 0xff, sizeof(out->regcol));
+
+   export_enabled = true;
+
+   return true;
+}
+
+void
+export_start_submit(int submit)
+{
+   if (export_enabled)
+      out->submit = submit;
+}
+
+static void
+add_reg(uint32_t regbase)
+{
+   if (out->regcol[regbase] >= 0)
+      return;
+
+   struct column *col = calloc(1, sizeof(*col));
+   col->name = strdup(regname(regbase, 0));
+   col->regbase = regbase;
+
+   /* the register wasn't written by the earlier draws: */
+   col->nnulls = out->nrows;
+
+   out->regs = realloc(out->regs, (out->nregs + 1) * sizeof(*out->regs));
+   out->regcol[regbase] = out->nregs;
+   out->regs[out->nregs++] = col;
+}
+
+void
+export_query_regs(const int *regbases, unsigned n)
+{
+   if (!export_enabled)
+      return;
+
+   /* the queries are resolved again once the gpu is known, drop the
+    * registers they resolved to for the default gpu:
+    */
+   if (!out->nrows) {
+      for (unsigned i = 0; i < out->nregs; i++) {
+         out->regcol[out->regs[i]->regbase] = -1;
+         free_column(out->regs[i]);
+         free(out->regs[i]);
+      }
+      out->nregs = 0;
+   }
+
+   out->query = true;
+   for (unsigned i = 0; i < n; i++)
+      add_reg(regbases[i]);
+}
+
+void
+__export_reg(uint32_t regbase)
+{
+   if (!out->query)
+      add_reg(regbase);
+}
+
+void
+export_draw(const struct export_draw *draw)
+{
+   if (!export_enabled)
+      return;
+
+   struct column *meta = out->meta;
+
+   column_add(&meta[COL_DRAW], draw->draw);
+   column_add(&meta[COL_SUBMIT], out->submit);
+   column_add(&meta[COL_PRIMTYPE],
+              column_str(&meta[COL_PRIMTYPE], draw->primtype));
+   column_add(&meta[COL_NUM_INDICES], draw->num_indices);
+   column_add(&meta[COL_RENDER_MODE],
+              column_str(&meta[COL_RENDER_MODE], draw->render_mode));
+   column_add(&meta[COL_BIN_X1], draw->bin_x1);
+   column_add(&meta[COL_BIN_Y1], draw->bin_y1);
+   column_add(&meta[COL_BIN_X2], draw->bin_x2);
+   column_add(&meta[COL_BIN_Y2], draw->bin_y2);
+
+   for (unsigned i = 0; i < out->nregs; i++)
+      column_add(out->regs[i], reg_val(out->regs[i]->regbase));
+
+   out->nrows++;
+}
+
+/*
+ * Writing the file:
+ */
+
+struct chunk {
+   uint64_t dict_offset, data_offset;
+   uint64_t size;
+};
+
+static void
+page_header(struct buf *b, enum parquet_page_type type, unsigned size,
+            unsigned nvalues, enum parquet_encoding encoding)
+{
+   thrift_begin(b, 0);
+   thrift_i32(b, 1, type);
+   thrift_i32(b, 2, size);
+   thrift_i32(b, 3, size);
+   if (type == PARQUET_DICTIONARY_PAGE) {
+      thrift_begin(b, 7);
+      thrift_i32(b, 1, nvalues);
+      thrift_i32(b, 2, encoding);
+      thrift_end(b);
+   } else {
+      thrift_begin(b, 5);
+      thrift_i32(b, 1, nvalues);
+      thrift_i32(b, 2, encoding);
+      thrift_i32(b, 3, PARQUET_RLE);
+      thrift_i32(b, 4, PARQUET_RLE);
+      thrift_end(b);
+   }
+   thrift_end(b);
+}
+
+static int
+cmp_u32(const void *a, const void *b)
+{
+   uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+   return (x > y) - (x < y);
+}
+
+/* Index of a value in the (sorted) dictionary: */
+static uint32_t
+dict_index(const uint32_t *dict, unsigned n, uint32_t val)
+{
+   const uint32_t *p = bsearch(&val, dict, n, sizeof(*dict), cmp_u32);
+   assert(p);
+   return p - dict;
+}
+
+static bool
+write_column(struct column *col, struct chunk *chunk)
+{
+   struct buf dict = {0}, data = {0}, hdr = {0};
+   uint32_t *vals = NULL;
+   unsigned ndict;
+
+   /* The dictionary, which for string columns is the strings, and for
+    * register values is the distinct values, in order:
+    */
+   if (col->string) {
+      ndict = col->nstrs;
+      for (unsigned i = 0; i < ndict; i++) {
+         buf_u32(&dict, strlen(col->strs[i]));
+         buf_add(&dict, col->strs[i], strlen(col->strs[i]));
+      }
+   } else {
+      vals = malloc(MAX2(col->nruns, 1) * sizeof(*vals));
+      for (unsigned i = 0; i < col->nruns; i++)
+         vals[i] = col->runs[i].val;
+      qsort(vals, col->nruns, sizeof(*vals), cmp_u32);
+      ndict = 0;
+      for (unsigned i = 0; i < col->nruns; i++)
+         if (!ndict || (vals[ndict - 1] != vals[i]))
+            vals[ndict++] = vals[i];
+      for (unsigned i = 0; i < ndict; i++)
+         buf_u32(&dict, vals[i]);
+   }
+
+   /* For optional columns, the definition levels (0 for null, 1 for a
+    * value) come first, RLE encoded with a bit width of 1, and preceded by
+    * their size:
+    */
+   if (col->nnulls) {
+      struct buf levels = {0};
+      buf_varint(&levels, (uint64_t)col->nnulls << 1);
+      buf_byte(&levels, 0);
+      if (out->nrows > col->nnulls) {
+         buf_varint(&levels, (uint64_t)(out->nrows - col->nnulls) << 1);
+         buf_byte(&levels, 1);
+      }
+      buf_u32(&data, levels.size);
+      buf_add(&data, levels.data, levels.size);
+      free(levels.data);
+   }
+
+   /* The indices of the values, as the bit width followed by RLE runs: */
+   unsigned width = 0;
+   while ((1u << width) < ndict)
+      width++;
+   buf_byte(&data, width);
+   for (unsigned i = 0; i < col->nruns; i++) {
+      uint32_t idx = col->string ? col->runs[i].val :
+                     dict_index(vals, ndict, col->runs[i].val);
+      buf_varint(&data, (uint64_t)col->runs[i].count << 1);
+      for (unsigned j = 0; j < width; j += 8)
+         buf_byte(&data, idx >> j);
+   }
+
+   free(vals);
+
+   chunk->dict_offset = ftell(out->f);
+
+   page_header(&hdr, PARQUET_DICTIONARY_PAGE, dict.size, ndict,
+               PARQUET_PLAIN);
+   buf_add(&hdr, dict.data, dict.size);
+   chunk->data_offset = chunk->dict_offset + hdr.size;
+   page_header(&hdr, PARQUET_DATA_PAGE, data.size, out->nrows,
+               PARQUET_RLE_DICTIONARY);
+   buf_add(&hdr, data.data, data.size);
+   chunk->size = hdr.size;
+
+   bool ret = fwrite(hdr.data, hdr.size, 1, out->f) == 1;
+
+   free(hdr.data);
+   free(data.data);
+   free(dict.data);
+
+   return ret;
+}
+
+static void
+schema_element(struct buf *b, struct column *col)
+{
+   thrift_begin(b, 0);
+   thrift_i32(b, 1, col->string ? PARQUET_BYTE_ARRAY : PARQUET_INT32);
+   thrift_i32(b, 3, col->nnulls ? PARQUET_OPTIONAL : PARQUET_REQUIRED);
+   thrift_string(b, 4, col->name);
+   thrift_i32(b, 6, col->string ? PARQUET_UTF8 : PARQUET_UINT_32);
+   thrift_end(b);
+}
+
+static void
+column_chunk(struct buf *b, struct column *col, struct chunk *chunk)
+{
+   thrift_begin(b, 0);
+   thrift_i64(b, 2, chunk->dict_offset);
+   thrift_begin(b, 3);
+   thrift_i32(b, 1, col->string ? PARQUET_BYTE_ARRAY : PARQUET_INT32);
+   thrift_list(b, 2, THRIFT_I32, 3);
+   buf_varint(b, PARQUET_PLAIN << 1);
+   buf_varint(b, PARQUET_RLE << 1);
+   buf_varint(b, PARQUET_RLE_DICTIONARY << 1);
+   thrift_list(b, 3, THRIFT_BINARY, 1);
+   buf_varint(b, strlen(col->name));
+   buf_add(b, col->name, strlen(col->name));
+   thrift_i32(b, 4, 0); /* UNCOMPRESSED */
+   thrift_i64(b, 5, out->nrows);
+   thrift_i64(b, 6, chunk->size);
+   thrift_i64(b, 7, chunk->size);
+   thrift_i64(b, 9, chunk->data_offset);
+   thrift_i64(b, 11, chunk->dict_offset);
+   thrift_end(b);
+   thrift_end(b);
+}
+
+static int
+cmp_regcol(const void *a, const void *b)
+{
+   const struct column *x = *(struct column *const *)a;
+   const struct column *y = *(struct column *const *)b;
+   return (x->regbase > y->regbase) - (x->regbase < y->regbase);
+}
+
+bool
+export_close(void)
+{
+   if (!export_enabled)
+      return true;
+
+   export_enabled = false;
+
+   /* the registers are in order of their offset, in query mode too: */
+   qsort(out->regs, out->nregs, sizeof(*out->regs), cmp_regcol);
+
+   unsigned ncols = NUM_META_COLS + out->nregs;
+   struct column **cols = malloc(ncols * sizeof(*cols));
+   struct chunk *chunks = calloc(ncols, sizeof(*chunks));
+   uint64_t total = 0;
+
+   for (unsigned i = 0; i < NUM_META_COLS; i++)
+      cols[i] = &out->meta[i];
+   for (unsigned i = 0; i < out->nregs; i++)
+      cols[NUM_META_COLS + i] = out->regs[i];
+
+   bool ok = fwrite(PARQUET_MAGIC, 4, 1, out->f) == 1;
+
+   for (unsigned i = 0; ok && (i < ncols); i++) {
+      ok = write_column(cols[i], &chunks[i]);
+      total += chunks[i].size;
+   }
+
+   struct buf meta = {0};
+   thrift_begin(&meta, 0);
+   thrift_i32(&meta, 1, 1);
+   thrift_list(&meta, 2, THRIFT_STRUCT, ncols + 1);
+   thrift_begin(&meta, 0);
+   thrift_string(&meta, 4, "schema");
+   thrift_i32(&meta, 5, ncols);
+   thrift_end(&meta);
+   for (unsigned i = 0; i < ncols; i++)
+      schema_element(&meta, cols[i]);
+   thrift_i64(&meta, 3, out->nrows);
+   thrift_list(&meta, 4, THRIFT_STRUCT, 1);
+   thrift_begin(&meta, 0);
+   thrift_list(&meta, 1, THRIFT_STRUCT, ncols);
+   for (unsigned i = 0; i < ncols; i++)
+      column_chunk(&meta, cols[i], &chunks[i]);
+   thrift_i64(&meta, 2, total);
+   thrift_i64(&meta, 3, out->nrows);
+   thrift_end(&meta);
+   thrift_string(&meta, 6, "cffdump");
+   thrift_end(&meta);
+   buf_u32(&meta, meta.size);
+   buf_add(&meta, PARQUET_MAGIC, 4);
+
+   ok = ok && (fwrite(meta.data, meta.size, 1, out->f) == 1);
+   ok &= (fclose(out->f) == 0);
+
+   if (!ok)
+      fprintf(stderr, "error writing %s\n", out->path);
+
+   free(meta.data);
+   free(chunks);
+   free(cols);
+   for (unsigned i = 0; i < NUM_META_COLS; i++)
+      free_column(&out->meta[i]);
+   for (unsigned i = 0; i < out->nregs; i++) {
+      free_column(out->regs[i]);
+      free(out->regs[i]);
+   }
+   free(out->regs);
+   free(out->path);
+   free(out);
+   out = NULL;
+
+   return ok;
+}
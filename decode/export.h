@@ -0,0 +1,73 @@
+/*
+ * Copyright © 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __EXPORT_H__
+#define __EXPORT_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "util/macros.h"
+
+/*
+ * Per-draw register state export, for cffdump --export.  Each draw is a
+ * row of a Parquet file, with columns for the draw metadata:
+ *
+ *   draw, submit, primtype, num_indices, render_mode,
+ *   bin_x1, bin_y1, bin_x2, bin_y2
+ *
+ * followed by a column per register, named after the register, with its
+ * value at the draw.  The registers are the queried registers in query
+ * mode, otherwise every register written anywhere in the capture, with
+ * the draws before a register is first written having a null value.
+ *
+ * The file has a single row group, with each column stored uncompressed
+ * but dictionary encoded, with the indices run length encoded, which
+ * suits register values that mostly don't change from draw to draw.
+ */
+
+struct export_draw {
+   int draw;
+   const char *primtype;
+   uint32_t num_indices;
+   const char *render_mode;
+   uint32_t bin_x1, bin_y1, bin_x2, bin_y2;
+};
+
+extern bool export_enabled;
+
+bool export_open(const char *path);
+bool export_close(void);
+void export_start_submit(int submit);
+void export_query_regs(const int *regbases, unsigned n);
+void export_draw(const struct export_draw *draw);
+void __export_reg(uint32_t regbase);
+
+static inline void
+export_reg(uint32_t regbase)
+{
+   if (unlikely(export_enabled))
+      __export_reg(regbase);
+}
+
+#endif /* __EXPORT_H__ */
@@ -134,6 +134,31 @@ io_openfd(int fd)
    return io;
 }
 
+/* Read from a buffer in memory, which must remain valid until io_close(): */
+struct io *
+io_openmem(const void *data, unsigned size)
+{
+   struct io *io = io_new();
+   int ret;
+
+   if (!io)
+      return NULL;
+
+   ret = archive_read_open_memory(io->a, data, size);
+   if (ret != ARCHIVE_OK) {
+      io_error(io);
+      return NULL;
+   }
+
+   ret = archive_read_next_header(io->a, &io->entry);
+   if (ret != ARCHIVE_OK) {
+      io_error(io);
+      return NULL;
+   }
+
+   return io;
+}
+
 void
 io_close(struct io *io)
 {
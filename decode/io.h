@@ -37,6 +37,7 @@ struct io;
 
 struct io *io_open(const char *filename);
 struct io *io_openfd(int fd);
+struct io *io_openmem(const void *data, unsigned size);
 void io_close(struct io *io);
 unsigned io_offset(struct io *io);
 int io_readn(struct io *io, void *buf, int nbytes);
@@ -22,6 +22,9 @@
  */
 
 #include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
 #include <signal.h>
 #include <stdbool.h>
 #include <stdio.h>
@@ -33,18 +36,114 @@
 
 #include "pager.h"
 
+/* The decoded output goes to a pipe dup'd onto stdout, which a writer
+ * thread drains into a ring buffer, and from there into the pipe to the
+ * pager, so that decoding can run ahead of the pager (which only reads as
+ * much as it is displaying) rather than every write to stdout blocking on
+ * it.  The decoder only blocks once it is RING_SIZE ahead.  Since it is
+ * the stdout fd itself, this also catches output that bypasses the stdout
+ * FILE (ie. from scripts).
+ */
+#define RING_SIZE (64 * 1024 * 1024)
+
 static pid_t pager_pid;
+static volatile sig_atomic_t pager_exited;
 
 static void
-pager_death(int n)
+pager_death(int n, siginfo_t *info, void *context)
+{
+   if (info->si_pid == pager_pid)
+      pager_exited = true;
+}
+
+static struct {
+   pthread_t thread;
+
+   char *buf;
+   size_t head, tail; /* free running, head - tail bytes are queued */
+
+   int in_fd;  /* read end of the pipe on stdout */
+   int out_fd; /* write end of the pipe to the pager */
+   int saved_stdout;
+
+   bool done; /* the pager has gone away */
+} ring;
+
+static void *
+writer_thread(void *arg)
 {
-   exit(0);
+   sigset_t mask;
+   bool eof = false;
+
+   /* if the pager quits, get EPIPE rather than being killed by SIGPIPE: */
+   sigemptyset(&mask);
+   sigaddset(&mask, SIGPIPE);
+   pthread_sigmask(SIG_BLOCK, &mask, NULL);
+
+   while (!eof || (ring.head != ring.tail)) {
+      struct pollfd pfd[2];
+      struct pollfd *in = NULL, *out = NULL;
+      unsigned n = 0;
+
+      if (!eof && (ring.head - ring.tail < RING_SIZE)) {
+         in = &pfd[n++];
+         *in = (struct pollfd){ .fd = ring.in_fd, .events = POLLIN };
+      }
+      if (ring.head != ring.tail) {
+         out = &pfd[n++];
+         *out = (struct pollfd){ .fd = ring.out_fd, .events = POLLOUT };
+      }
+
+      if (poll(pfd, n, -1) < 0) {
+         if (errno == EINTR)
+            continue;
+         break;
+      }
+
+      if (in && in->revents) {
+         /* read as much as fits, up to the end of the buffer: */
+         size_t offset = ring.head % RING_SIZE;
+         size_t size = RING_SIZE - (ring.head - ring.tail);
+         if (size > RING_SIZE - offset)
+            size = RING_SIZE - offset;
+
+         ssize_t ret = read(ring.in_fd, ring.buf + offset, size);
+         if (ret > 0)
+            ring.head += ret;
+         else if ((ret == 0) || ((errno != EINTR) && (errno != EAGAIN)))
+            eof = true;
+      }
+
+      if (out && out->revents) {
+         /* write out whatever is queued, up to the end of the buffer: */
+         size_t offset = ring.tail % RING_SIZE;
+         size_t size = ring.head - ring.tail;
+         if (size > RING_SIZE - offset)
+            size = RING_SIZE - offset;
+
+         ssize_t ret = write(ring.out_fd, ring.buf + offset, size);
+         if (ret > 0) {
+            ring.tail += ret;
+         } else if ((ret < 0) && (errno != EINTR) && (errno != EAGAIN)) {
+            __atomic_store_n(&ring.done, true, __ATOMIC_RELAXED);
+         }
+      }
+
+      /* once the pager has gone away, the output is just discarded (but
+       * still read, so the decoder doesn't block before it notices
+       * pager_done() and stops):
+       */
+      if (ring.done)
+         ring.tail = ring.head;
+   }
+
+   return NULL;
 }
 
 void
 pager_open(void)
 {
-   int fd[2];
+   int fd[2], out[2];
 
    if (pipe(fd) < 0) {
       fprintf(stderr, "Failed to create pager pipe: %m\n");
@@ -70,29 +169,160 @@ pager_open(void)
       execlp("less", "less", NULL);
 
    } else {
-      /* we want to kill the parent process when pager exits: */
-      signal(SIGCHLD, pager_death);
-      dup2(fd[1], STDOUT_FILENO);
+      /* note when the pager exits, so the decoder can stop early: */
+      struct sigaction sa = {
+         .sa_sigaction = pager_death,
+         .sa_flags = SA_SIGINFO | SA_RESTART | SA_NOCLDSTOP,
+      };
+      sigaction(SIGCHLD, &sa, NULL);
+
       close(fd[0]);
-      close(fd[1]);
+
+      if (pipe(out) < 0) {
+         fprintf(stderr, "Failed to create pager pipe: %m\n");
+         exit(-1);
+      }
+
+#ifdef F_SETPIPE_SZ
+      /* fewer round trips through the writer thread (best effort): */
+      fcntl(out[1], F_SETPIPE_SZ, 1024 * 1024);
+#endif
+
+      ring.buf = malloc(RING_SIZE);
+      ring.head = ring.tail = 0;
+      ring.done = false;
+      ring.in_fd = out[0];
+      ring.out_fd = fd[1];
+
+      /* the writer thread polls both pipes, so neither end it uses may
+       * block (which doesn't affect the other ends):
+       */
+      fcntl(ring.in_fd, F_SETFL, fcntl(ring.in_fd, F_GETFL) | O_NONBLOCK);
+      fcntl(ring.out_fd, F_SETFL, fcntl(ring.out_fd, F_GETFL) | O_NONBLOCK);
+
+      fflush(stdout);
+      ring.saved_stdout = dup(STDOUT_FILENO);
+      dup2(out[1], STDOUT_FILENO);
+      close(out[1]);
+
+      if (!ring.buf || (ring.saved_stdout < 0) ||
+          pthread_create(&ring.thread, NULL, writer_thread, NULL)) {
+         fprintf(stderr, "Failed to start pager writer\n");
+         exit(-1);
+      }
+
+      setvbuf(stdout, NULL, _IOFBF, 0x10000);
    }
 }
 
+bool
+pager_done(void)
+{
+   if (!pager_pid)
+      return false;
+
+   return pager_exited || __atomic_load_n(&ring.done, __ATOMIC_RELAXED);
+}
+
 int
 pager_close(void)
 {
    siginfo_t status;
 
-   close(STDOUT_FILENO);
+   if (!pager_pid)
+      return 0;
+
+   /* restoring stdout closes the last write end of the pipe the writer
+    * reads from, then let it finish writing out what is queued:
+    */
+   fflush(stdout);
+   dup2(ring.saved_stdout, STDOUT_FILENO);
+   close(ring.saved_stdout);
+   pthread_join(ring.thread, NULL);
+
+   free(ring.buf);
+   ring.buf = NULL;
+
+   /* which tells the pager there is no more to come: */
+   close(ring.out_fd);
+   close(ring.in_fd);
 
    while (true) {
       memset(&status, 0, sizeof(status));
       if (waitid(P_PID, pager_pid, &status, WEXITED) < 0) {
          if (errno == EINTR)
             continue;
+         pager_pid = 0;
          return -errno;
       }
 
+      pager_pid = 0;
       return 0;
    }
 }
+
+/* Show a buffer in a new pager, starting at the given (1 based) line, and
+ * wait for the user to quit it.  This is for the interactive viewer, which
+ * runs the pager for each thing looked at rather than once for all of the
+ * output.
+ */
+int
+pager_show(const char *buf, size_t len, unsigned line)
+{
+   struct sigaction sa = { .sa_handler = SIG_IGN }, old_sa;
+   int fd[2], ret = 0;
+   pid_t pid;
+
+   if (pipe(fd) < 0)
+      return -errno;
+
+   pid = fork();
+   if (pid < 0) {
+      ret = -errno;
+      close(fd[0]);
+      close(fd[1]);
+      return ret;
+   }
+
+   if (pid == 0) {
+      char goto_line[16];
+
+      dup2(fd[0], STDIN_FILENO);
+      close(fd[0]);
+      close(fd[1]);
+
+      setenv("LESS", "FRSMKX", 1);
+      snprintf(goto_line, sizeof(goto_line), "+%ug", line ? line : 1);
+
+      execlp("less", "less", goto_line, NULL);
+      _exit(127);
+   }
+
+   close(fd[0]);
+
+   /* the user can quit before the pager has read everything: */
+   sigaction(SIGPIPE, &sa, &old_sa);
+
+   while (len > 0) {
+      ssize_t n = write(fd[1], buf, len);
+      if (n < 0) {
+         if (errno == EINTR)
+            continue;
+         if (errno != EPIPE)
+            ret = -errno;
+         break;
+      }
+      buf += n;
+      len -= n;
+   }
+
+   close(fd[1]);
+   sigaction(SIGPIPE, &old_sa, NULL);
+
+   while (waitpid(pid, NULL, 0) < 0) {
+      if (errno != EINTR)
+         break;
+   }
+
+   return ret;
+}
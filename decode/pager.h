@@ -24,7 +24,12 @@
 #ifndef __PAGER_H__
 #define __PAGER_H__
 
+#include <stdbool.h>
+#include <stddef.h>
+
 void pager_open(void);
+bool pager_done(void);
 int pager_close(void);
+int pager_show(const char *buf, size_t len, unsigned line);
 
 #endif /* __PAGER_H__ */
@@ -0,0 +1,202 @@
+/*
+ * Copyright © 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "profile.h"
+
+bool prof_enabled;
+
+static const char *phase_names[PROF_PHASES] = {
+   [PROF_OTHER] = "other",
+   [PROF_IO] = "io",
+   [PROF_BUFFERS] = "buffers",
+   [PROF_PKT0] = "pkt0",
+   [PROF_PKT3] = "pkt3",
+   [PROF_PKT4] = "pkt4",
+   [PROF_PKT7] = "pkt7",
+   [PROF_RNN] = "rnn",
+   [PROF_DISASM] = "disasm",
+   [PROF_SCRIPT] = "script",
+   [PROF_OUTPUT] = "output",
+};
+
+static struct {
+   uint64_t ticks;
+   uint64_t calls;
+} phases[PROF_PHASES];
+
+/* stack of the phases we are in, the top of which is being charged: */
+static enum prof_phase stack[64];
+static unsigned depth;
+static unsigned overflow;
+
+static uint64_t last;
+static uint64_t start_ticks, start_ns;
+
+static uint64_t
+now_ns(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* Cheap timestamps, from the cycle counter where there is one, which are
+ * converted to time using the clock at the start and end of the run:
+ */
+static inline uint64_t
+now(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+   return __builtin_ia32_rdtsc();
+#elif defined(__aarch64__)
+   uint64_t v;
+   __asm__ volatile("mrs %0, cntvct_el0" : "=r"(v));
+   return v;
+#else
+   return now_ns();
+#endif
+}
+
+static void
+charge(void)
+{
+   uint64_t t = now();
+   phases[stack[depth]].ticks += t - last;
+   last = t;
+}
+
+void
+__prof_begin(enum prof_phase phase)
+{
+   phases[phase].calls++;
+
+   if (depth + 1 >= ARRAY_SIZE(stack)) {
+      overflow++;
+      return;
+   }
+
+   charge();
+   stack[++depth] = phase;
+}
+
+void
+__prof_end(void)
+{
+   if (overflow) {
+      overflow--;
+      return;
+   }
+
+   assert(depth > 0);
+   charge();
+   depth--;
+}
+
+#ifdef __GLIBC__
+/* The output is timed by replacing stdout with a stream which times the
+ * writes.  This only captures the time spent writing, the time spent
+ * formatting is charged to whichever phase the printf() is in:
+ */
+static ssize_t
+timed_write(void *cookie, const char *buf, size_t size)
+{
+   size_t written = 0;
+
+   prof_begin(PROF_OUTPUT);
+   while (written < size) {
+      ssize_t ret = write(STDOUT_FILENO, buf + written, size - written);
+      if (ret < 0) {
+         if (errno == EINTR)
+            continue;
+         break;
+      }
+      written += ret;
+   }
+   prof_end();
+
+   return written ? written : -1;
+}
+#endif
+
+void
+prof_init(void)
+{
+   prof_enabled = true;
+   depth = 0;
+   stack[0] = PROF_OTHER;
+   start_ns = now_ns();
+   start_ticks = last = now();
+
+#ifdef __GLIBC__
+   FILE *f = fopencookie(NULL, "w", (cookie_io_functions_t){
+      .write = timed_write,
+   });
+   if (f) {
+      fflush(stdout);
+      setvbuf(f, NULL, _IOFBF, 0x10000);
+      stdout = f;
+   }
+#endif
+}
+
+void
+prof_report(FILE *out)
+{
+   uint64_t total = 0;
+
+   if (!prof_enabled)
+      return;
+
+   /* flush any output still buffered, so it is accounted for: */
+   fflush(stdout);
+
+   charge();
+
+   double ns_per_tick = (last > start_ticks) ?
+      (double)(now_ns() - start_ns) / (double)(last - start_ticks) : 0.0;
+
+   for (unsigned i = 0; i < PROF_PHASES; i++)
+      total += phases[i].ticks;
+
+   fprintf(out, "profile:\n");
+   fprintf(out, "\t%-8s %12s %12s %7s\n", "phase", "calls", "msecs", "%");
+   for (unsigned i = 0; i < PROF_PHASES; i++) {
+      fprintf(out, "\t%-8s %12" PRIu64 " %12.2f %6.1f%%\n", phase_names[i],
+              phases[i].calls, phases[i].ticks * ns_per_tick / 1000000.0,
+              total ? 100.0 * phases[i].ticks / total : 0.0);
+   }
+   fprintf(out, "\t%-8s %12s %12.2f\n", "total", "",
+           total * ns_per_tick / 1000000.0);
+
+   /* only report once, even if called again from an atexit() handler: */
+   prof_enabled = false;
+}
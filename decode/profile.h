@@ -0,0 +1,78 @@
+/*
+ * Copyright © 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __PROFILE_H__
+#define __PROFILE_H__
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "util/macros.h"
+
+/*
+ * Phase profiler, for --profile.  The time between prof_begin(phase) and
+ * the matching prof_end() is charged to the phase, excluding any nested
+ * phases, so for example the time spent disassembling a shader from
+ * within a CP_LOAD_STATE6 packet is charged to PROF_DISASM rather than to
+ * PROF_PKT7.  Time not in any phase is charged to PROF_OTHER.
+ *
+ * Only the main thread should be instrumented.
+ */
+
+enum prof_phase {
+   PROF_OTHER,
+   PROF_IO,      /* reading (and decompressing) the input */
+   PROF_BUFFERS, /* recording buffer contents, and gpuaddr lookups */
+   PROF_PKT0,    /* decoding each class of packet */
+   PROF_PKT3,
+   PROF_PKT4,
+   PROF_PKT7,
+   PROF_RNN,     /* register database lookups and decoding */
+   PROF_DISASM,  /* shader disassembly */
+   PROF_SCRIPT,  /* lua script hooks */
+   PROF_OUTPUT,  /* writing out the (already formatted) output */
+   PROF_PHASES,
+};
+
+extern bool prof_enabled;
+
+void prof_init(void);
+void prof_report(FILE *out);
+void __prof_begin(enum prof_phase phase);
+void __prof_end(void);
+
+static inline void
+prof_begin(enum prof_phase phase)
+{
+   if (unlikely(prof_enabled))
+      __prof_begin(phase);
+}
+
+static inline void
+prof_end(void)
+{
+   if (unlikely(prof_enabled))
+      __prof_end();
+}
+
+#endif /* __PROFILE_H__ */
@@ -0,0 +1,861 @@
+/*
+ * Copyright © 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "buffers.h"
+#include "export.h"
+#include "qcache.h"
+
+#define QCACHE_MAGIC   "FDQCACHE"
+#define QCACHE_VERSION 1
+#define QCACHE_SUFFIX  ".fdcache"
+
+enum qcache_event {
+   QC_TEXT,
+   QC_INIT,
+   QC_SUBMIT,
+   QC_SUBMIT_END,
+   QC_DRAW,
+   QC_SUMMARY,
+   QC_MODE,
+   QC_BIN,
+};
+
+/* The cache file is a header followed by the columns, each an array of
+ * fixed size elements.  The events are in the first three columns, and
+ * the register writes, draws, submits and text are in separate columns in
+ * the order of the events they belong to:
+ */
+enum qcache_column {
+   COL_EV_KIND,          /* u8, enum qcache_event */
+   COL_EV_ARG,           /* u32, gpu_id for INIT, submit number for SUBMIT,
+                          * index into the strings (or ~0) for MODE
+                          */
+   COL_EV_NDELTAS,       /* u32, register writes since the previous event */
+   COL_DELTA_REG,        /* u16 */
+   COL_DELTA_VAL,        /* u32 */
+   COL_DRAW_PRIMTYPE,    /* u32, index into the strings */
+   COL_DRAW_NUM_INDICES, /* u32 */
+   COL_BIN,              /* u32[4], x1, y1, x2, y2 */
+   COL_SUBMIT_NBUFS,     /* u32, buffers for the submit, or ~0 if unchanged */
+   COL_BUF_ADDR,         /* u64 */
+   COL_BUF_LEN,          /* u32 */
+   COL_TEXT_LEN,         /* u32 */
+   COL_TEXT,             /* char */
+   COL_STR_OFF,          /* u32 */
+   COL_STR,              /* char, nul terminated strings */
+   COL_COUNT,
+};
+
+static const unsigned col_elsize[COL_COUNT] = {
+   [COL_EV_KIND] = 1,
+   [COL_EV_ARG] = 4,
+   [COL_EV_NDELTAS] = 4,
+   [COL_DELTA_REG] = 2,
+   [COL_DELTA_VAL] = 4,
+   [COL_DRAW_PRIMTYPE] = 4,
+   [COL_DRAW_NUM_INDICES] = 4,
+   [COL_BIN] = 16,
+   [COL_SUBMIT_NBUFS] = 4,
+   [COL_BUF_ADDR] = 8,
+   [COL_BUF_LEN] = 4,
+   [COL_TEXT_LEN] = 4,
+   [COL_TEXT] = 1,
+   [COL_STR_OFF] = 4,
+   [COL_STR] = 1,
+};
+
+enum {
+   QC_FLAG_COLOR = 0x1,
+   QC_FLAG_ONCE = 0x2,
+   QC_FLAG_ALLREGS = 0x4,
+   QC_FLAG_SUMMARY = 0x8,
+   QC_FLAG_MARKERS = 0x10,
+};
+
+/* The cache is only valid for the same capture, decoded by the same
+ * decoder (with the built-in register database) with the same options
+ * that affect the recorded state:
+ */
+struct qcache_header {
+   char magic[8];
+   uint32_t version;
+   uint32_t flags;
+   uint32_t gpu_id;
+   uint32_t pad;
+   uint64_t capture_size;
+   int64_t capture_mtime_sec, capture_mtime_nsec;
+   uint64_t decoder_size;
+   int64_t decoder_mtime_sec, decoder_mtime_nsec;
+   struct {
+      uint64_t offset, size;
+   } cols[COL_COUNT];
+};
+
+struct col {
+   void *data;
+   size_t size, cap;
+};
+
+bool qcache_recording;
+
+static struct {
+   struct qcache_header header;
+   char *capture;
+   FILE *out;
+   bool capturing;
+   struct col cols[COL_COUNT];
+
+   /* register writes not yet attached to an event: */
+   uint32_t pending;
+
+   /* the register writes since the previous event are deduplicated, with
+    * the index of each register's write valid if its generation matches:
+    */
+   uint32_t gen;
+   uint32_t reg_gen[0x10000];
+   uint32_t reg_idx[0x10000];
+
+   /* the buffers for the previous submit: */
+   uint32_t bufs, nbufs;
+   bool have_bufs;
+} *rec;
+
+static void
+col_add(struct col *col, const void *data, size_t size)
+{
+   if (!size)
+      return;
+
+   if (col->size + size > col->cap) {
+      col->cap = MAX2(col->cap * 2, col->size + size);
+      col->cap = MAX2(col->cap, 0x1000);
+      col->data = realloc(col->data, col->cap);
+   }
+   memcpy((char *)col->data + col->size, data, size);
+   col->size += size;
+}
+
+static unsigned
+col_count(enum qcache_column c)
+{
+   return rec->cols[c].size / col_elsize[c];
+}
+
+#define col_add_u32(c, v)                                                      \
+   do {                                                                        \
+      uint32_t __v = (v);                                                      \
+      col_add(&rec->cols[c], &__v, sizeof(__v));                               \
+   } while (0)
+
+static char *
+cache_path(const char *capture)
+{
+   char *path;
+   if (asprintf(&path, "%s" QCACHE_SUFFIX, capture) < 0)
+      return NULL;
+   return path;
+}
+
+/* Check that the options are ones where the output is determined by the
+ * recorded state, ie. no scripts or modes which look at buffer contents,
+ * and fill in the identity of the capture and decoder:
+ */
+static bool
+identify(const char *capture, const struct cffdec_options *options,
+         struct qcache_header *header)
+{
+   struct stat st, exe;
+
+   if (!options->querystrs || options->query_compare || options->script ||
+       options->descriptors || options->bandwidth || options->statecost ||
+       options->dump_shaders || options->dump_textures || options->silent ||
+       (options->draw_filter != -1))
+      return false;
+
+   /* the export is only fed by decoding the capture: */
+   if (export_enabled)
+      return false;
+
+   /* an external register database could change without the decoder: */
+   if (getenv("RNN_PATH"))
+      return false;
+
+   if (!strcmp(capture, "-"))
+      return false;
+
+   if (stat(capture, &st) || !S_ISREG(st.st_mode))
+      return false;
+
+   if (stat("/proc/self/exe", &exe))
+      return false;
+
+   memset(header, 0, sizeof(*header));
+   memcpy(header->magic, QCACHE_MAGIC, sizeof(header->magic));
+   header->version = QCACHE_VERSION;
+   header->flags = (options->color ? QC_FLAG_COLOR : 0) |
+                   (options->once ? QC_FLAG_ONCE : 0) |
+                   (options->allregs ? QC_FLAG_ALLREGS : 0) |
+                   (options->summary ? QC_FLAG_SUMMARY : 0) |
+                   (options->decode_markers ? QC_FLAG_MARKERS : 0);
+   header->gpu_id = options->gpu_id;
+   header->capture_size = st.st_size;
+   header->capture_mtime_sec = st.st_mtim.tv_sec;
+   header->capture_mtime_nsec = st.st_mtim.tv_nsec;
+   header->decoder_size = exe.st_size;
+   header->decoder_mtime_sec = exe.st_mtim.tv_sec;
+   header->decoder_mtime_nsec = exe.st_mtim.tv_nsec;
+
+   return true;
+}
+
+static void
+add_text(const char *buf, size_t size)
+{
+   unsigned n = col_count(COL_EV_KIND);
+
+   /* merge with the previous event, if that was text too: */
+   if (n && (((uint8_t *)rec->cols[COL_EV_KIND].data)[n - 1] == QC_TEXT)) {
+      uint32_t *lens = rec->cols[COL_TEXT_LEN].data;
+      lens[col_count(COL_TEXT_LEN) - 1] += size;
+   } else {
+      uint8_t kind = QC_TEXT;
+      col_add(&rec->cols[COL_EV_KIND], &kind, 1);
+      col_add_u32(COL_EV_ARG, 0);
+      col_add_u32(COL_EV_NDELTAS, 0);
+      col_add_u32(COL_TEXT_LEN, size);
+   }
+
+   col_add(&rec->cols[COL_TEXT], buf, size);
+}
+
+#ifdef __GLIBC__
+/* The output is recorded by replacing stdout with a stream which passes
+ * the writes through to the original stdout, recording them unless the
+ * recording is paused:
+ */
+static ssize_t
+capture_write(void *cookie, const char *buf, size_t size)
+{
+   if (rec->capturing)
+      add_text(buf, size);
+
+   size_t written = fwrite(buf, 1, size, rec->out);
+
+   return written ? written : -1;
+}
+#endif
+
+static void
+add_event(enum qcache_event kind, uint32_t arg)
+{
+   uint8_t k = kind;
+
+   /* any output before the event belongs before it: */
+   fflush(stdout);
+
+   col_add(&rec->cols[COL_EV_KIND], &k, 1);
+   col_add_u32(COL_EV_ARG, arg);
+   col_add_u32(COL_EV_NDELTAS, col_count(COL_DELTA_VAL) - rec->pending);
+
+   rec->pending = col_count(COL_DELTA_VAL);
+   if (++rec->gen == 0) {
+      memset(rec->reg_gen, 0, sizeof(rec->reg_gen));
+      rec->gen = 1;
+   }
+}
+
+void
+__qcache_reg(uint32_t regbase, uint32_t val)
+{
+   if (rec->reg_gen[regbase] == rec->gen) {
+      uint32_t *vals = rec->cols[COL_DELTA_VAL].data;
+      vals[rec->reg_idx[regbase]] = val;
+      return;
+   }
+
+   uint16_t reg = regbase;
+   rec->reg_gen[regbase] = rec->gen;
+   rec->reg_idx[regbase] = col_count(COL_DELTA_VAL);
+   col_add(&rec->cols[COL_DELTA_REG], &reg, sizeof(reg));
+   col_add_u32(COL_DELTA_VAL, val);
+}
+
+bool
+qcache_record_begin(const char *capture, const struct cffdec_options *options)
+{
+#ifdef __GLIBC__
+   struct qcache_header header;
+
+   if (qcache_recording || !identify(capture, options, &header))
+      return false;
+
+   FILE *f = fopencookie(NULL, "w", (cookie_io_functions_t){
+      .write = capture_write,
+   });
+   if (!f)
+      return false;
+
+   rec = calloc(1, sizeof(*rec));
+   if (!rec) {
+      fclose(f);
+      return false;
+   }
+
+   rec->header = header;
+   rec->capture = strdup(capture);
+   rec->gen = 1;
+   rec->capturing = true;
+
+   fflush(stdout);
+   setvbuf(f, NULL, _IOFBF, 0x10000);
+   rec->out = stdout;
+   stdout = f;
+
+   qcache_recording = true;
+
+   return true;
+#else
+   return false;
+#endif
+}
+
+static bool
+write_cache(void)
+{
+   struct qcache_header *header = &rec->header;
+   char *path = cache_path(rec->capture);
+   char *tmp = NULL;
+   bool ret = false;
+   int fd = -1;
+   FILE *f;
+
+   if (!path || (asprintf(&tmp, "%s.XXXXXX", path) < 0)) {
+      tmp = NULL;
+      goto out;
+   }
+
+   fd = mkstemp(tmp);
+   if (fd < 0)
+      goto out;
+
+   /* mkstemp() creates it as 0600, give the cache the same permissions as
+    * any other new file, so that others who can read the capture can use
+    * it too:
+    */
+   mode_t mask = umask(0);
+   umask(mask);
+   fchmod(fd, 0666 & ~mask);
+
+   f = fdopen(fd, "w");
+   if (!f)
+      goto out;
+   fd = -1;
+
+   uint64_t offset = sizeof(*header);
+   for (unsigned i = 0; i < COL_COUNT; i++) {
+      header->cols[i].offset = offset;
+      header->cols[i].size = rec->cols[i].size;
+      offset = ALIGN_POT(offset + rec->cols[i].size, 8);
+   }
+
+   static const char zeros[8];
+   bool ok = fwrite(header, sizeof(*header), 1, f) == 1;
+   for (unsigned i = 0; ok && (i < COL_COUNT); i++) {
+      size_t size = rec->cols[i].size;
+      if (size)
+         ok = fwrite(rec->cols[i].data, size, 1, f) == 1;
+      if (ok && (ALIGN_POT(size, 8) != size))
+         ok = fwrite(zeros, ALIGN_POT(size, 8) - size, 1, f) == 1;
+   }
+
+   ok &= (fclose(f) == 0);
+
+   ret = ok && (rename(tmp, path) == 0);
+
+out:
+   if (!ret && tmp)
+      unlink(tmp);
+   if (fd >= 0)
+      close(fd);
+   free(tmp);
+   free(path);
+   return ret;
+}
+
+void
+qcache_record_end(bool ok)
+{
+   if (!qcache_recording)
+      return;
+
+   FILE *f = stdout;
+   fflush(f);
+   stdout = rec->out;
+   fclose(f);
+
+   qcache_recording = false;
+
+   /* don't cache a capture that changed while it was being decoded: */
+   struct stat st;
+   if (ok && !stat(rec->capture, &st) &&
+       (st.st_size == rec->header.capture_size) &&
+       (st.st_mtim.tv_sec == rec->header.capture_mtime_sec) &&
+       (st.st_mtim.tv_nsec == rec->header.capture_mtime_nsec)) {
+      if (!write_cache())
+         fprintf(stderr, "could not write cache for %s: %s\n", rec->capture,
+                 strerror(errno));
+   }
+
+   for (unsigned i = 0; i < COL_COUNT; i++)
+      free(rec->cols[i].data);
+   free(rec->capture);
+   free(rec);
+   rec = NULL;
+}
+
+void
+qcache_pause(void)
+{
+   if (!qcache_recording)
+      return;
+   fflush(stdout);
+   rec->capturing = false;
+}
+
+void
+qcache_resume(void)
+{
+   if (!qcache_recording)
+      return;
+   fflush(stdout);
+   rec->capturing = true;
+}
+
+void
+qcache_record_init(unsigned gpu_id)
+{
+   if (qcache_recording)
+      add_event(QC_INIT, gpu_id);
+}
+
+struct buf_list {
+   uint64_t *addrs;
+   uint32_t *lens;
+   unsigned n, cap;
+};
+
+static void
+collect_buffer(uint64_t gpuaddr, unsigned len, void *data)
+{
+   struct buf_list *l = data;
+
+   if (l->n == l->cap) {
+      l->cap = MAX2(l->cap * 2, 64);
+      l->addrs = realloc(l->addrs, l->cap * sizeof(*l->addrs));
+      l->lens = realloc(l->lens, l->cap * sizeof(*l->lens));
+   }
+
+   l->addrs[l->n] = gpuaddr;
+   l->lens[l->n] = len;
+   l->n++;
+}
+
+void
+qcache_record_submit(int submit)
+{
+   struct buf_list l = {0};
+
+   if (!qcache_recording)
+      return;
+
+   add_event(QC_SUBMIT, submit);
+
+   /* The buffers are needed to show the buffer a queried address points
+    * into, which usually are the same for many submits in a row:
+    */
+   foreach_buffer(collect_buffer, &l);
+
+   if (rec->have_bufs && (l.n == rec->nbufs) &&
+       !memcmp(l.addrs, (uint64_t *)rec->cols[COL_BUF_ADDR].data + rec->bufs,
+               l.n * sizeof(*l.addrs)) &&
+       !memcmp(l.lens, (uint32_t *)rec->cols[COL_BUF_LEN].data + rec->bufs,
+               l.n * sizeof(*l.lens))) {
+      col_add_u32(COL_SUBMIT_NBUFS, ~0);
+   } else {
+      rec->bufs = col_count(COL_BUF_ADDR);
+      rec->nbufs = l.n;
+      rec->have_bufs = true;
+      col_add_u32(COL_SUBMIT_NBUFS, l.n);
+      col_add(&rec->cols[COL_BUF_ADDR], l.addrs, l.n * sizeof(*l.addrs));
+      col_add(&rec->cols[COL_BUF_LEN], l.lens, l.n * sizeof(*l.lens));
+   }
+
+   free(l.addrs);
+   free(l.lens);
+}
+
+void
+qcache_record_submit_end(void)
+{
+   if (qcache_recording)
+      add_event(QC_SUBMIT_END, 0);
+}
+
+static uint32_t
+intern(const char *str)
+{
+   if (!str)
+      return ~0;
+
+   const uint32_t *offs = rec->cols[COL_STR_OFF].data;
+   const char *strs = rec->cols[COL_STR].data;
+   unsigned n = col_count(COL_STR_OFF);
+
+   for (unsigned i = 0; i < n; i++)
+      if (!strcmp(strs + offs[i], str))
+         return i;
+
+   col_add_u32(COL_STR_OFF, rec->cols[COL_STR].size);
+   col_add(&rec->cols[COL_STR], str, strlen(str) + 1);
+
+   return n;
+}
+
+void
+qcache_record_draw(const char *primtype, uint32_t num_indices)
+{
+   if (!qcache_recording)
+      return;
+
+   add_event(QC_DRAW, 0);
+   col_add_u32(COL_DRAW_PRIMTYPE, intern(primtype));
+   col_add_u32(COL_DRAW_NUM_INDICES, num_indices);
+}
+
+void
+qcache_record_render_mode(const char *mode)
+{
+   if (qcache_recording)
+      add_event(QC_MODE, intern(mode));
+}
+
+void
+qcache_record_bin(uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2)
+{
+   if (!qcache_recording)
+      return;
+
+   uint32_t bin[4] = {x1, y1, x2, y2};
+   add_event(QC_BIN, 0);
+   col_add(&rec->cols[COL_BIN], bin, sizeof(bin));
+}
+
+void
+qcache_record_summary(void)
+{
+   if (qcache_recording)
+      add_event(QC_SUMMARY, 0);
+}
+
+/*
+ * Replay:
+ */
+
+struct replay {
+   const struct qcache_header *header;
+   const void *cols[COL_COUNT];
+   unsigned counts[COL_COUNT];
+};
+
+#define COL(r, c, type) ((const type *)(r)->cols[c])
+
+/* Check the file is consistent, so that nothing needs to be checked once
+ * we've started writing out the results:
+ */
+static bool
+validate(struct replay *r, const void *data, size_t size)
+{
+   const struct qcache_header *header = data;
+
+   for (unsigned i = 0; i < COL_COUNT; i++) {
+      uint64_t offset = header->cols[i].offset;
+      uint64_t len = header->cols[i].size;
+      if ((offset > size) || (len > size - offset) || (offset % 8) ||
+          (len % col_elsize[i]))
+         return false;
+      r->cols[i] = (const char *)data + offset;
+      r->counts[i] = len / col_elsize[i];
+   }
+
+   unsigned nevents = r->counts[COL_EV_KIND];
+   if ((r->counts[COL_EV_ARG] != nevents) ||
+       (r->counts[COL_EV_NDELTAS] != nevents) ||
+       (r->counts[COL_DELTA_REG] != r->counts[COL_DELTA_VAL]) ||
+       (r->counts[COL_BUF_ADDR] != r->counts[COL_BUF_LEN]) ||
+       (r->counts[COL_DRAW_NUM_INDICES] != r->counts[COL_DRAW_PRIMTYPE]))
+      return false;
+
+   unsigned nstrs = r->counts[COL_STR_OFF];
+   if (nstrs && (COL(r, COL_STR, char)[r->counts[COL_STR] - 1] != '\0'))
+      return false;
+   for (unsigned i = 0; i < nstrs; i++)
+      if (COL(r, COL_STR_OFF, uint32_t)[i] >= r->counts[COL_STR])
+         return false;
+
+   uint64_t ndeltas = 0, ntext = 0, text = 0, ndraws = 0, nsubmits = 0;
+   uint64_t nbins = 0;
+   for (unsigned i = 0; i < nevents; i++) {
+      uint32_t arg = COL(r, COL_EV_ARG, uint32_t)[i];
+      ndeltas += COL(r, COL_EV_NDELTAS, uint32_t)[i];
+      switch (COL(r, COL_EV_KIND, uint8_t)[i]) {
+      case QC_TEXT:
+         if (ntext >= r->counts[COL_TEXT_LEN])
+            return false;
+         text += COL(r, COL_TEXT_LEN, uint32_t)[ntext++];
+         break;
+      case QC_DRAW:
+         ndraws++;
+         break;
+      case QC_SUBMIT:
+         nsubmits++;
+         break;
+      case QC_MODE:
+         if ((arg != ~0u) && (arg >= nstrs))
+            return false;
+         break;
+      case QC_BIN:
+         nbins++;
+         break;
+      case QC_INIT:
+      case QC_SUBMIT_END:
+      case QC_SUMMARY:
+         break;
+      default:
+         return false;
+      }
+   }
+
+   if ((ndeltas != r->counts[COL_DELTA_REG]) ||
+       (ntext != r->counts[COL_TEXT_LEN]) || (text != r->counts[COL_TEXT]) ||
+       (ndraws != r->counts[COL_DRAW_PRIMTYPE]) ||
+       (nbins != r->counts[COL_BIN]) ||
+       (nsubmits != r->counts[COL_SUBMIT_NBUFS]))
+      return false;
+
+   uint64_t nbufs = 0;
+   for (unsigned i = 0; i < nsubmits; i++) {
+      uint32_t n = COL(r, COL_SUBMIT_NBUFS, uint32_t)[i];
+      if (n != ~0u)
+         nbufs += n;
+   }
+   if (nbufs != r->counts[COL_BUF_ADDR])
+      return false;
+
+   for (unsigned i = 0; i < ndraws; i++)
+      if (COL(r, COL_DRAW_PRIMTYPE, uint32_t)[i] >= nstrs)
+         return false;
+
+   return true;
+}
+
+static const char *
+str(const struct replay *r, uint32_t idx)
+{
+   if (idx == ~0u)
+      return NULL;
+   return COL(r, COL_STR, char) + COL(r, COL_STR_OFF, uint32_t)[idx];
+}
+
+/* The render mode outlives the replay, so needs a copy of the string,
+ * there are only a handful of different ones:
+ */
+static const char *
+persistent_str(const char *s)
+{
+   static char **strs;
+   static unsigned nstrs;
+
+   if (!s)
+      return NULL;
+
+   for (unsigned i = 0; i < nstrs; i++)
+      if (!strcmp(strs[i], s))
+         return strs[i];
+
+   strs = realloc(strs, (nstrs + 1) * sizeof(*strs));
+   strs[nstrs] = strdup(s);
+
+   return strs[nstrs++];
+}
+
+static void
+load_buffers(const struct replay *r, unsigned first, unsigned n)
+{
+   reset_buffers();
+
+   /* only the extents of the buffers are recorded, not their contents: */
+   for (unsigned i = 0; i < n; i++)
+      add_buffer(COL(r, COL_BUF_ADDR, uint64_t)[first + i],
+                 COL(r, COL_BUF_LEN, uint32_t)[first + i], malloc(1));
+}
+
+static void
+replay(const struct replay *r, struct cffdec_options *options, int start,
+       int end)
+{
+   unsigned delta = 0, text = 0, ntext = 0, draw = 0, submit = 0, buf = 0;
+   unsigned bin = 0;
+   unsigned bufs = 0, nbufs = 0;
+   bool bufs_loaded = false;
+   bool in_range = true;
+
+   for (unsigned i = 0; i < r->counts[COL_EV_KIND]; i++) {
+      uint32_t arg = COL(r, COL_EV_ARG, uint32_t)[i];
+      uint32_t ndeltas = COL(r, COL_EV_NDELTAS, uint32_t)[i];
+
+      /* writes within submits that aren't decoded are skipped: */
+      if (in_range) {
+         for (unsigned j = 0; j < ndeltas; j++)
+            reg_set(COL(r, COL_DELTA_REG, uint16_t)[delta + j],
+                    COL(r, COL_DELTA_VAL, uint32_t)[delta + j]);
+      }
+      delta += ndeltas;
+
+      switch (COL(r, COL_EV_KIND, uint8_t)[i]) {
+      case QC_TEXT: {
+         uint32_t len = COL(r, COL_TEXT_LEN, uint32_t)[ntext++];
+         if (in_range)
+            fwrite(COL(r, COL_TEXT, char) + text, 1, len, stdout);
+         text += len;
+         break;
+      }
+      case QC_INIT:
+         options->gpu_id = arg;
+         cffdec_init(options);
+         break;
+      case QC_SUBMIT: {
+         uint32_t n = COL(r, COL_SUBMIT_NBUFS, uint32_t)[submit++];
+         if (n != ~0u) {
+            bufs = buf;
+            nbufs = n;
+            buf += n;
+            bufs_loaded = false;
+         }
+         in_range = (start <= (int)arg) && ((int)arg <= end);
+         if (in_range && !bufs_loaded) {
+            load_buffers(r, bufs, nbufs);
+            bufs_loaded = true;
+         }
+         break;
+      }
+      case QC_SUBMIT_END:
+         if (in_range)
+            cffdec_end_submit();
+         in_range = true;
+         break;
+      case QC_DRAW:
+         if (in_range) {
+            cffdec_replay_draw(
+               str(r, COL(r, COL_DRAW_PRIMTYPE, uint32_t)[draw]),
+               COL(r, COL_DRAW_NUM_INDICES, uint32_t)[draw]);
+         }
+         draw++;
+         break;
+      case QC_MODE:
+         if (in_range)
+            cffdec_replay_render_mode(persistent_str(str(r, arg)));
+         break;
+      case QC_BIN: {
+         const uint32_t *b = &COL(r, COL_BIN, uint32_t)[bin * 4];
+         if (in_range)
+            cffdec_replay_bin(b[0], b[1], b[2], b[3]);
+         bin++;
+         break;
+      }
+      case QC_SUMMARY:
+         if (in_range)
+            cffdec_replay_summary();
+         break;
+      }
+   }
+
+   /* don't leave the placeholder buffers around for the next capture: */
+   reset_buffers();
+}
+
+bool
+qcache_replay(const char *capture, struct cffdec_options *options, int start,
+              int end)
+{
+   struct qcache_header header;
+   struct replay r = {0};
+   struct stat st;
+   bool ret = false;
+   void *data;
+   char *path;
+   int fd;
+
+   if (!identify(capture, options, &header))
+      return false;
+
+   path = cache_path(capture);
+   if (!path)
+      return false;
+
+   fd = open(path, O_RDONLY | O_CLOEXEC);
+   free(path);
+   if (fd < 0)
+      return false;
+
+   if (fstat(fd, &st) || (st.st_size < (off_t)sizeof(header))) {
+      close(fd);
+      return false;
+   }
+
+   data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+   close(fd);
+   if (data == MAP_FAILED)
+      return false;
+
+   /* everything but the column offsets must match: */
+   r.header = data;
+   if (!memcmp(&header, r.header, offsetof(struct qcache_header, cols)) &&
+       validate(&r, data, st.st_size)) {
+      replay(&r, options, start, end);
+      ret = true;
+   }
+
+   munmap(data, st.st_size);
+
+   return ret;
+}
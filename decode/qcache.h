@@ -0,0 +1,86 @@
+/*
+ * Copyright © 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __QCACHE_H__
+#define __QCACHE_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "util/macros.h"
+
+#include "cffdec.h"
+
+/*
+ * Query cache, for cffdump --cache.  While decoding a capture in query
+ * mode, the register writes, draws and everything else which affects the
+ * output of a query are recorded, and written to a cache file next to the
+ * capture.  Later queries of the same capture, with the same decoder, are
+ * answered by replaying the cache through the same query code, rather than
+ * by decoding the capture again.
+ *
+ * The recording is a sequence of events:
+ *
+ *   TEXT       - output other than the query results, ie. "Reading..."
+ *   INIT       - cffdec_init() for a gpu_id, which prints the (request
+ *                specific) resolved query registers
+ *   SUBMIT     - start of a cmdstream submit
+ *   SUBMIT_END - end of a submit
+ *   DRAW       - a do_query() for a draw, blit, etc
+ *   MODE, BIN  - a change to the render mode or bin, which the query
+ *                results are labeled with
+ *   SUMMARY    - the end of a draw, which updates the previous values
+ *                that the "changed" flags are relative to
+ *
+ * each with the register writes (deduplicated) since the previous event.
+ * The cache file stores the events, register writes and draws as separate
+ * columns, see qcache.c.
+ */
+
+extern bool qcache_recording;
+
+bool qcache_record_begin(const char *capture,
+                         const struct cffdec_options *options);
+void qcache_record_end(bool ok);
+void qcache_record_init(unsigned gpu_id);
+void qcache_record_submit(int submit);
+void qcache_record_submit_end(void);
+void qcache_record_draw(const char *primtype, uint32_t num_indices);
+void qcache_record_render_mode(const char *mode);
+void qcache_record_bin(uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2);
+void qcache_record_summary(void);
+void qcache_pause(void);
+void qcache_resume(void);
+void __qcache_reg(uint32_t regbase, uint32_t val);
+
+static inline void
+qcache_reg(uint32_t regbase, uint32_t val)
+{
+   if (unlikely(qcache_recording))
+      __qcache_reg(regbase, val);
+}
+
+bool qcache_replay(const char *capture, struct cffdec_options *options,
+                   int start, int end);
+
+#endif /* __QCACHE_H__ */
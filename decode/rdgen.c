@@ -0,0 +1,658 @@
+/*
+ * Copyright © 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Generate synthetic a6xx cmdstream captures (.rd files), for decoder
+ * benchmarks which don't depend on captures that can't be shared.  The
+ * output is determined entirely by the options and the seed, so the same
+ * cmdline always produces the same file.
+ *
+ * Each submit consists of:
+ *
+ *  - a cmdstream which sets the render mode and jumps through a chain of
+ *    --nesting levels of CP_INDIRECT_BUFFER's to the draws
+ *  - for each draw, --groups CP_SET_DRAW_STATE groups of --group-regs
+ *    register writes each, --regs direct PKT4 register writes, a VS/FS
+ *    program (one of --programs per submit, each --instrs instructions
+ *    long) loaded with CP_LOAD_STATE6, and a CP_DRAW_INDX_OFFSET
+ *  - --bos buffers of --bo-size KiB of random data, standing in for the
+ *    vertex/texture/etc buffers a real capture would contain
+ */
+
+#include <assert.h>
+#include <err.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/compiler.h"
+#include "util/macros.h"
+#include "util/u_math.h"
+
+#include "adreno_common.xml.h"
+#include "adreno_pm4.xml.h"
+#include "a6xx.xml.h"
+
+#include "freedreno_pm4.h"
+
+#include "redump.h"
+
+/* where the buffers of each submit are placed in the address space: */
+#define BO_BASE 0x100000000ull
+
+/* cffdec tracks at most three levels of IB's below the cmdstream, and the
+ * draw state groups are another level below the draws:
+ */
+#define MAX_NESTING 2
+
+static struct {
+   uint64_t seed;
+   unsigned gpu_id;
+   unsigned submits;
+   uint64_t size;
+   unsigned draws;
+   unsigned regs;
+   unsigned groups;
+   unsigned group_regs;
+   unsigned nesting;
+   unsigned programs;
+   unsigned instrs;
+   unsigned bos;
+   unsigned bo_size;
+   int shader;
+} opt = {
+   .seed = 1,
+   .gpu_id = 630,
+   .submits = 16,
+   .draws = 64,
+   .regs = 16,
+   .groups = 4,
+   .group_regs = 8,
+   .nesting = 1,
+   .programs = 4,
+   .instrs = 64,
+   .bos = 4,
+   .bo_size = 64,
+};
+
+static FILE *out;
+static uint64_t written;
+static uint64_t rng;
+static uint64_t next_iova;
+
+struct bo {
+   uint64_t iova;
+   uint32_t *map;
+   unsigned sizedwords, maxdwords;
+};
+
+/*
+ * Deterministic random numbers (xorshift64*), so that the output does
+ * not depend on the libc:
+ */
+
+static uint64_t
+rnd(void)
+{
+   rng ^= rng >> 12;
+   rng ^= rng << 25;
+   rng ^= rng >> 27;
+   return rng * 0x2545f4914f6cdd1dull;
+}
+
+static unsigned
+rnd_range(unsigned n)
+{
+   return n ? rnd() % n : 0;
+}
+
+/*
+ * Writing the .rd sections:
+ */
+
+static void
+write_section(enum rd_sect_type type, const void *buf, uint32_t sz)
+{
+   uint32_t hdr[2] = {type, sz};
+
+   if ((fwrite(hdr, sizeof(hdr), 1, out) != 1) ||
+       (sz && fwrite(buf, sz, 1, out) != 1))
+      err(1, "write failed");
+
+   written += sizeof(hdr) + sz;
+}
+
+static void
+write_bo(struct bo *bo)
+{
+   uint32_t addr[3] = {
+      bo->iova,
+      bo->sizedwords * 4,
+      bo->iova >> 32,
+   };
+
+   write_section(RD_GPUADDR, addr, sizeof(addr));
+   write_section(RD_BUFFER_CONTENTS, bo->map, bo->sizedwords * 4);
+}
+
+static void
+write_cmdstream(struct bo *bo)
+{
+   uint32_t addr[3] = {
+      bo->iova,
+      bo->sizedwords,
+      bo->iova >> 32,
+   };
+
+   write_section(RD_CMDSTREAM_ADDR, addr, sizeof(addr));
+}
+
+/*
+ * Building buffers.. buffers are placed one after the other in the order
+ * they are opened, so a buffer can't be opened until the previous one is
+ * complete:
+ */
+
+static uint64_t
+bo_iova(struct bo *bo)
+{
+   return bo->iova + bo->sizedwords * 4;
+}
+
+static void
+bo_open(struct bo *bo)
+{
+   bo->iova = next_iova;
+   bo->sizedwords = 0;
+}
+
+static void
+bo_close(struct bo *bo)
+{
+   next_iova = ALIGN(bo_iova(bo), 0x1000);
+}
+
+static void
+emit(struct bo *bo, uint32_t dword)
+{
+   if (bo->sizedwords == bo->maxdwords) {
+      bo->maxdwords = bo->maxdwords ? bo->maxdwords * 2 : 0x1000;
+      bo->map = realloc(bo->map, bo->maxdwords * 4);
+      if (!bo->map)
+         err(1, "realloc");
+   }
+   bo->map[bo->sizedwords++] = dword;
+}
+
+static void
+emit_addr(struct bo *bo, uint64_t iova)
+{
+   emit(bo, iova);
+   emit(bo, iova >> 32);
+}
+
+static void
+emit_pkt4(struct bo *bo, uint16_t regindx, uint16_t cnt)
+{
+   emit(bo, pm4_pkt4_hdr(regindx, cnt));
+}
+
+static void
+emit_pkt7(struct bo *bo, uint8_t opcode, uint16_t cnt)
+{
+   emit(bo, pm4_pkt7_hdr(opcode, cnt));
+}
+
+/*
+ * Register state.. a mix of registers which real draws touch, but not
+ * ones which hold gpu addresses, since there is nothing valid for them
+ * to point to:
+ */
+
+static const uint32_t state_regs[] = {
+   REG_A6XX_GRAS_CL_CNTL,
+   REG_A6XX_GRAS_SU_CNTL,
+   REG_A6XX_GRAS_SC_WINDOW_SCISSOR_TL,
+   REG_A6XX_GRAS_SC_WINDOW_SCISSOR_BR,
+   REG_A6XX_RB_RENDER_CNTL,
+   REG_A6XX_RB_ALPHA_CONTROL,
+   REG_A6XX_RB_BLEND_CNTL,
+   REG_A6XX_RB_DEPTH_PLANE_CNTL,
+   REG_A6XX_RB_DEPTH_CNTL,
+   REG_A6XX_RB_STENCIL_CONTROL,
+   REG_A6XX_RB_MRT(0),     /* RB_MRT[0].CONTROL */
+   REG_A6XX_RB_MRT(0) + 1, /* RB_MRT[0].BLEND_CONTROL */
+   REG_A6XX_RB_MRT(1),
+   REG_A6XX_RB_MRT(1) + 1,
+   REG_A6XX_VFD_CONTROL_0,
+   REG_A6XX_PC_PRIMITIVE_CNTL_0,
+   REG_A6XX_VPC_CNTL_0,
+   REG_A6XX_SP_VS_CTRL_REG0,
+   REG_A6XX_SP_FS_CTRL_REG0,
+   REG_A6XX_SP_FS_OUTPUT_CNTL0,
+};
+
+static void
+emit_state(struct bo *bo, unsigned n)
+{
+   /* one register per PKT4, since the registers following these could
+    * be ones which hold addresses:
+    */
+   for (unsigned i = 0; i < n; i++) {
+      emit_pkt4(bo, state_regs[rnd_range(ARRAY_SIZE(state_regs))], 1);
+      emit(bo, rnd());
+   }
+}
+
+/*
+ * Shaders.. built from a handful of instruction encodings, with random
+ * registers/immediates, which disassemble to something sensible:
+ */
+
+static void
+emit_instr(struct bo *bo)
+{
+   unsigned dst = rnd_range(48), src = rnd_range(48);
+
+   switch (rnd_range(6)) {
+   case 0: /* mov.u32u32 rD, rS */
+      emit(bo, src);
+      emit(bo, 0x200cc000 | dst);
+      break;
+   case 1: /* mov.u32u32 rD, imm */
+      emit(bo, rnd());
+      emit(bo, 0x204cc000 | dst);
+      break;
+   case 2: /* mov.f32f32 rD, cS */
+      emit(bo, src);
+      emit(bo, 0x20244000 | dst);
+      break;
+   case 3: /* cov.u32f32 rD, rS */
+      emit(bo, src);
+      emit(bo, 0x200c4000 | dst);
+      break;
+   case 4: /* (ss)mov.u32u32 rD, rS */
+      emit(bo, src);
+      emit(bo, 0x200cd000 | dst);
+      break;
+   case 5: /* (rptN)nop */
+      emit(bo, 0);
+      emit(bo, rnd_range(4) << 8);
+      break;
+   }
+}
+
+struct program {
+   uint64_t iova;
+   unsigned instrlen; /* in units of 16 instructions (128 bytes) */
+};
+
+static void
+emit_shader(struct bo *bo, struct program *prog)
+{
+   unsigned n = 0;
+
+   prog->iova = bo_iova(bo);
+
+   for (; n < opt.instrs; n++)
+      emit_instr(bo);
+
+   /* end: */
+   emit(bo, 0x00000000);
+   emit(bo, 0x03000000);
+   n++;
+
+   /* pad with nop's: */
+   for (; n % 16; n++) {
+      emit(bo, 0);
+      emit(bo, 0);
+   }
+
+   prog->instrlen = n / 16;
+}
+
+static void
+emit_program(struct bo *bo, struct program *vs, struct program *fs)
+{
+   emit_pkt4(bo, REG_A6XX_SP_VS_INSTRLEN, 1);
+   emit(bo, vs->instrlen);
+   emit_pkt4(bo, REG_A6XX_SP_VS_OBJ_START, 2);
+   emit_addr(bo, vs->iova);
+
+   emit_pkt7(bo, CP_LOAD_STATE6_GEOM, 3);
+   emit(bo, CP_LOAD_STATE6_0_DST_OFF(0) |
+            CP_LOAD_STATE6_0_STATE_TYPE(ST6_SHADER) |
+            CP_LOAD_STATE6_0_STATE_SRC(SS6_INDIRECT) |
+            CP_LOAD_STATE6_0_STATE_BLOCK(SB6_VS_SHADER) |
+            CP_LOAD_STATE6_0_NUM_UNIT(vs->instrlen));
+   emit_addr(bo, vs->iova);
+
+   emit_pkt4(bo, REG_A6XX_SP_FS_INSTRLEN, 1);
+   emit(bo, fs->instrlen);
+   emit_pkt4(bo, REG_A6XX_SP_FS_OBJ_START, 2);
+   emit_addr(bo, fs->iova);
+
+   emit_pkt7(bo, CP_LOAD_STATE6_FRAG, 3);
+   emit(bo, CP_LOAD_STATE6_0_DST_OFF(0) |
+            CP_LOAD_STATE6_0_STATE_TYPE(ST6_SHADER) |
+            CP_LOAD_STATE6_0_STATE_SRC(SS6_INDIRECT) |
+            CP_LOAD_STATE6_0_STATE_BLOCK(SB6_FS_SHADER) |
+            CP_LOAD_STATE6_0_NUM_UNIT(fs->instrlen));
+   emit_addr(bo, fs->iova);
+}
+
+/*
+ * Submits:
+ */
+
+static struct bo ibs[MAX_NESTING + 1];
+static struct bo state_bo, shader_bo, data_bo;
+static struct program *vs, *fs;
+
+static void
+emit_draw(struct bo *ib)
+{
+   if (opt.groups) {
+      emit_pkt7(ib, CP_SET_DRAW_STATE, 3 * opt.groups);
+      for (unsigned g = 0; g < opt.groups; g++) {
+         uint64_t iova = bo_iova(&state_bo);
+         unsigned start = state_bo.sizedwords;
+
+         emit_state(&state_bo, opt.group_regs);
+
+         emit(ib, CP_SET_DRAW_STATE__0_COUNT(state_bo.sizedwords - start) |
+                  CP_SET_DRAW_STATE__0_BINNING |
+                  CP_SET_DRAW_STATE__0_GMEM |
+                  CP_SET_DRAW_STATE__0_SYSMEM |
+                  CP_SET_DRAW_STATE__0_GROUP_ID(g + 1));
+         emit_addr(ib, iova);
+      }
+   }
+
+   emit_state(ib, opt.regs);
+
+   if (opt.programs) {
+      unsigned p = rnd_range(opt.programs);
+      emit_program(ib, &vs[p], &fs[p]);
+   }
+
+   emit_pkt7(ib, CP_DRAW_INDX_OFFSET, 3);
+   emit(ib, CP_DRAW_INDX_OFFSET_0_PRIM_TYPE(DI_PT_TRILIST) |
+            CP_DRAW_INDX_OFFSET_0_SOURCE_SELECT(DI_SRC_SEL_AUTO_INDEX) |
+            CP_DRAW_INDX_OFFSET_0_VIS_CULL(IGNORE_VISIBILITY));
+   emit(ib, 1);                      /* NUM_INSTANCES */
+   emit(ib, 3 * (1 + rnd_range(1000))); /* NUM_INDICES */
+}
+
+static void
+gen_submit(void)
+{
+   struct bo *draw_ib = &ibs[opt.nesting];
+
+   next_iova = BO_BASE;
+
+   bo_open(&shader_bo);
+   for (unsigned p = 0; p < opt.programs; p++) {
+      emit_shader(&shader_bo, &vs[p]);
+      emit_shader(&shader_bo, &fs[p]);
+   }
+   bo_close(&shader_bo);
+
+   /* the draws go in the innermost IB, which isn't referenced until they
+    * are done, so it can be placed after the state groups:
+    */
+   bo_open(&state_bo);
+   draw_ib->sizedwords = 0;
+   for (unsigned d = 0; d < opt.draws; d++)
+      emit_draw(draw_ib);
+   bo_close(&state_bo);
+
+   draw_ib->iova = next_iova;
+   bo_close(draw_ib);
+
+   /* and each level above jumps to the next: */
+   for (int l = opt.nesting - 1; l >= 0; l--) {
+      bo_open(&ibs[l]);
+      if (l == 0) {
+         emit_pkt7(&ibs[l], CP_SET_MARKER, 1);
+         emit(&ibs[l], A6XX_CP_SET_MARKER_0_MODE(RM6_BYPASS));
+      }
+      emit_pkt7(&ibs[l], CP_INDIRECT_BUFFER, 3);
+      emit_addr(&ibs[l], ibs[l + 1].iova);
+      emit(&ibs[l], ibs[l + 1].sizedwords);
+      bo_close(&ibs[l]);
+   }
+
+   for (unsigned l = 0; l <= opt.nesting; l++)
+      write_bo(&ibs[l]);
+   if (state_bo.sizedwords)
+      write_bo(&state_bo);
+   if (shader_bo.sizedwords)
+      write_bo(&shader_bo);
+
+   for (unsigned b = 0; b < opt.bos; b++) {
+      bo_open(&data_bo);
+      for (unsigned i = 0; i < opt.bo_size * 256; i++)
+         emit(&data_bo, rnd());
+      bo_close(&data_bo);
+      write_bo(&data_bo);
+   }
+
+   write_cmdstream(&ibs[0]);
+}
+
+static uint64_t
+parse_size(const char *str)
+{
+   char *end;
+   uint64_t size = strtoull(str, &end, 0);
+
+   switch (*end) {
+   case 'g':
+   case 'G':
+      size *= 1024;
+      FALLTHROUGH;
+   case 'm':
+   case 'M':
+      size *= 1024;
+      FALLTHROUGH;
+   case 'k':
+   case 'K':
+      size *= 1024;
+      break;
+   case '\0':
+      break;
+   default:
+      errx(2, "invalid size: %s", str);
+   }
+
+   return size;
+}
+
+static void
+print_usage(const char *name)
+{
+   /* clang-format off */
+   fprintf(stderr, "Usage:\n\n"
+           "\t%s [OPTIONS]... [FILE]\n\n"
+           "Generates a synthetic a6xx cmdstream capture, written to FILE (or\n"
+           "stdout).  The same options and seed always generate the same file.\n\n"
+           "Options:\n"
+           "\t-s, --seed=N       - random seed (default 1)\n"
+           "\t--gpu-id=N         - gpu id to record in the capture (default 630)\n"
+           "\t-S, --submits=N    - number of submits (default 16)\n"
+           "\t-z, --size=SIZE    - instead of a fixed number of submits, generate\n"
+           "\t                     submits until the file is at least SIZE bytes\n"
+           "\t                     (K/M/G suffixes can be used)\n"
+           "\t-d, --draws=N      - draws per submit (default 64)\n"
+           "\t-r, --regs=N       - register writes per draw (default 16)\n"
+           "\t-g, --groups=N     - CP_SET_DRAW_STATE groups per draw (default 4)\n"
+           "\t-G, --group-regs=N - register writes per group (default 8)\n"
+           "\t-n, --nesting=N    - levels of IB's between the cmdstream and the\n"
+           "\t                     draws, up to %u (default 1)\n"
+           "\t-p, --programs=N   - shader programs per submit (default 4)\n"
+           "\t-i, --instrs=N     - instructions per shader (default 64)\n"
+           "\t-b, --bos=N        - other buffers per submit (default 4)\n"
+           "\t-B, --bo-size=N    - size of other buffers, in KiB (default 64)\n"
+           "\t--shader           - rather than a capture, write a single raw shader\n"
+           "\t                     of --instrs instructions (ie. for ir3-disasm)\n"
+           "\t-h, --help         - show this message\n"
+           , name, MAX_NESTING);
+   /* clang-format on */
+   exit(2);
+}
+
+/* clang-format off */
+static const struct option opts[] = {
+      { "seed",       required_argument, 0, 's' },
+      { "gpu-id",     required_argument, 0, 'I' },
+      { "submits",    required_argument, 0, 'S' },
+      { "size",       required_argument, 0, 'z' },
+      { "draws",      required_argument, 0, 'd' },
+      { "regs",       required_argument, 0, 'r' },
+      { "groups",     required_argument, 0, 'g' },
+      { "group-regs", required_argument, 0, 'G' },
+      { "nesting",    required_argument, 0, 'n' },
+      { "programs",   required_argument, 0, 'p' },
+      { "instrs",     required_argument, 0, 'i' },
+      { "bos",        required_argument, 0, 'b' },
+      { "bo-size",    required_argument, 0, 'B' },
+      { "shader",     no_argument,       &opt.shader, 1 },
+      { "help",       no_argument,       0, 'h' },
+      { 0, 0, 0, 0 }
+};
+/* clang-format on */
+
+int
+main(int argc, char **argv)
+{
+   int c;
+
+   while ((c = getopt_long(argc, argv, "s:S:z:d:r:g:G:n:p:i:b:B:h", opts,
+                           NULL)) != -1) {
+      switch (c) {
+      case 0:
+         /* option that set a flag, nothing to do */
+         break;
+      case 's':
+         opt.seed = strtoull(optarg, NULL, 0);
+         break;
+      case 'I':
+         opt.gpu_id = atoi(optarg);
+         break;
+      case 'S':
+         opt.submits = atoi(optarg);
+         break;
+      case 'z':
+         opt.size = parse_size(optarg);
+         break;
+      case 'd':
+         opt.draws = atoi(optarg);
+         break;
+      case 'r':
+         opt.regs = atoi(optarg);
+         break;
+      case 'g':
+         opt.groups = atoi(optarg);
+         break;
+      case 'G':
+         opt.group_regs = atoi(optarg);
+         break;
+      case 'n':
+         opt.nesting = atoi(optarg);
+         break;
+      case 'p':
+         opt.programs = atoi(optarg);
+         break;
+      case 'i':
+         opt.instrs = atoi(optarg);
+         break;
+      case 'b':
+         opt.bos = atoi(optarg);
+         break;
+      case 'B':
+         opt.bo_size = atoi(optarg);
+         break;
+      case 'h':
+      default:
+         print_usage(argv[0]);
+      }
+   }
+
+   if ((opt.gpu_id < 600) || (opt.gpu_id >= 700))
+      errx(2, "only a6xx captures can be generated");
+   if (opt.nesting > MAX_NESTING)
+      errx(2, "nesting can be at most %u", MAX_NESTING);
+   /* CP_SET_DRAW_STATE group id's 1-31: */
+   if (opt.groups > 31)
+      errx(2, "at most 31 groups are supported");
+
+   if ((argc - optind) > 1)
+      print_usage(argv[0]);
+
+   if ((optind < argc) && strcmp(argv[optind], "-")) {
+      out = fopen(argv[optind], "wb");
+      if (!out)
+         err(1, "could not open: %s", argv[optind]);
+   } else {
+      out = stdout;
+   }
+
+   /* the xorshift state must be non-zero: */
+   rng = opt.seed ? opt.seed : 1;
+
+   /* just a single shader, in the raw form ir3-disasm reads: */
+   if (opt.shader) {
+      struct program prog;
+
+      bo_open(&shader_bo);
+      emit_shader(&shader_bo, &prog);
+
+      if (fwrite(shader_bo.map, 4, shader_bo.sizedwords, out) !=
+             shader_bo.sizedwords ||
+          fclose(out))
+         err(1, "write failed");
+
+      return 0;
+   }
+
+   vs = calloc(opt.programs, sizeof(*vs));
+   fs = calloc(opt.programs, sizeof(*fs));
+
+   static const char cmd[] = "rdgen";
+   write_section(RD_CMD, cmd, sizeof(cmd));
+   write_section(RD_GPU_ID, &opt.gpu_id, sizeof(opt.gpu_id));
+
+   for (unsigned s = 0; opt.size ? (written < opt.size) : (s < opt.submits);
+        s++)
+      gen_submit();
+
+   if (fclose(out))
+      err(1, "write failed");
+
+   return 0;
+}
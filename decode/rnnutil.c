@@ -33,6 +33,9 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "util/macros.h"
+
+#include "profile.h"
 #include "rnnutil.h"
 
 static struct rnndomain *
@@ -75,9 +78,25 @@ rnn_new(int nocolor)
 static void
 init(struct rnn *rnn, char *file, char *domain)
 {
-   /* prepare rnn stuff for lookup */
-   rnn_parsefile(rnn->db, file);
-   rnn_prepdb(rnn->db);
+   struct rnndb *builtin = NULL;
+
+   /* Use the database built in to the binary, unless RNN_PATH is set to
+    * override it, in which case fall back to parsing the xml:
+    */
+   if (!getenv("RNN_PATH") && !rnn->db->filesnum)
+      builtin = rnn_builtin_db(file);
+
+   if (builtin) {
+      /* the empty db from _rnn_init() is not needed: */
+      rnn_freedb(rnn->db);
+      rnn->db = builtin;
+      rnn->vc->db = builtin;
+      rnn->vc_nocolor->db = builtin;
+   } else {
+      /* prepare rnn stuff for lookup */
+      rnn_parsefile(rnn->db, file);
+      rnn_prepdb(rnn->db);
+   }
    rnn->dom[0] = rnn_finddomain(rnn->db, domain);
    if ((strcmp(domain, "A2XX") == 0) || (strcmp(domain, "A3XX") == 0)) {
       rnn->dom[1] = rnn_finddomain(rnn->db, "AXXX");
@@ -102,58 +121,257 @@ rnn_load_file(struct rnn *rnn, char *file, char *domain)
    init(rnn, file, domain);
 }
 
+static void *
+load_thread(void *arg)
+{
+   struct rnn *rnn = arg;
+   init(rnn, rnn->loadfile, rnn->loaddomain);
+   return NULL;
+}
+
+/* Load a database in a separate thread, so that independent databases
+ * can be parsed in parallel.  Each rnn has its own db and decode
+ * contexts, so the only requirement is that rnn_load_wait() is called
+ * before the rnn is used.
+ */
+void
+rnn_load_file_async(struct rnn *rnn, char *file, char *domain)
+{
+   rnn->loadfile = file;
+   rnn->loaddomain = domain;
+   if (pthread_create(&rnn->loader, NULL, load_thread, rnn)) {
+      /* fall back to loading synchronously: */
+      init(rnn, file, domain);
+      return;
+   }
+   rnn->loading = true;
+}
+
+void
+rnn_load_wait(struct rnn *rnn)
+{
+   if (!rnn || !rnn->loading)
+      return;
+   pthread_join(rnn->loader, NULL);
+   rnn->loading = false;
+}
+
+static const struct {
+   const char *gpuname;
+   char *file, *domain;
+} gpu_dbs[] = {
+   { "a2", "adreno/a2xx.xml", "A2XX" },
+   { "a3", "adreno/a3xx.xml", "A3XX" },
+   { "a4", "adreno/a4xx.xml", "A4XX" },
+   { "a5", "adreno/a5xx.xml", "A5XX" },
+   { "a6", "adreno/a6xx.xml", "A6XX" },
+};
+
 void
 rnn_load(struct rnn *rnn, const char *gpuname)
 {
-   if (strstr(gpuname, "a2")) {
-      init(rnn, "adreno/a2xx.xml", "A2XX");
-   } else if (strstr(gpuname, "a3")) {
-      init(rnn, "adreno/a3xx.xml", "A3XX");
-   } else if (strstr(gpuname, "a4")) {
-      init(rnn, "adreno/a4xx.xml", "A4XX");
-   } else if (strstr(gpuname, "a5")) {
-      init(rnn, "adreno/a5xx.xml", "A5XX");
-   } else if (strstr(gpuname, "a6")) {
-      init(rnn, "adreno/a6xx.xml", "A6XX");
+   for (unsigned i = 0; i < ARRAY_SIZE(gpu_dbs); i++) {
+      if (strstr(gpuname, gpu_dbs[i].gpuname)) {
+         init(rnn, gpu_dbs[i].file, gpu_dbs[i].domain);
+         return;
+      }
+   }
+}
+
+/* Loaded databases, shared by rnn_get() callers: */
+static struct {
+   struct rnn *rnn;
+   const char *file, *domain;
+   int nocolor;
+} loaded[16];
+static unsigned nloaded;
+
+/* Get a loaded rnn for the database file and domain, which is shared with
+ * any earlier caller which asked for the same one, so that the lookup
+ * tables built by the decode contexts are only built once.  If async, a
+ * newly created rnn is loaded in a separate thread, see rnn_load_file_async().
+ */
+struct rnn *
+rnn_get(char *file, char *domain, int nocolor, bool async)
+{
+   struct rnn *rnn;
+
+   for (unsigned i = 0; i < nloaded; i++) {
+      if (!strcmp(loaded[i].file, file) && !strcmp(loaded[i].domain, domain) &&
+          (loaded[i].nocolor == nocolor))
+         return loaded[i].rnn;
+   }
+
+   rnn = rnn_new(nocolor);
+
+   if (async)
+      rnn_load_file_async(rnn, file, domain);
+   else
+      rnn_load_file(rnn, file, domain);
+
+   if (nloaded < ARRAY_SIZE(loaded)) {
+      loaded[nloaded].rnn = rnn;
+      loaded[nloaded].file = file;
+      loaded[nloaded].domain = domain;
+      loaded[nloaded].nocolor = nocolor;
+      nloaded++;
+   }
+
+   return rnn;
+}
+
+struct rnn *
+rnn_get_gpu(const char *gpuname, int nocolor)
+{
+   for (unsigned i = 0; i < ARRAY_SIZE(gpu_dbs); i++) {
+      if (strstr(gpuname, gpu_dbs[i].gpuname))
+         return rnn_get(gpu_dbs[i].file, gpu_dbs[i].domain, nocolor, false);
+   }
+
+   /* like rnn_load(), leave the db empty for an unknown gpu: */
+   return rnn_new(nocolor);
+}
+
+/* Build the lookup tables which the decode contexts otherwise build on
+ * first use, for a long running process (ie. the decode server) which
+ * forks to handle each request, so that each child doesn't rebuild them:
+ */
+void
+rnn_warm(struct rnn *rnn)
+{
+   rnn_load_wait(rnn);
+
+   for (int d = 0; d < 2; d++) {
+      const struct rnndecname *names;
+      int n;
+
+      if (!rnn->dom[d] || (d == 1 && rnn->dom[1] == rnn->dom[0]))
+         continue;
+
+      n = rnndec_findnames(rnn->vc_nocolor, rnn->dom[d], "", &names);
+      for (int i = 0; i < n; i++) {
+         if (names[i].kind != RNNDEC_NAME_REG)
+            continue;
+         rnndec_regname(rnn->vc_nocolor, rnn->dom[d], names[i].addr, 0);
+         if (rnn->vc != rnn->vc_nocolor)
+            rnndec_regname(rnn->vc, rnn->dom[d], names[i].addr, 0);
+      }
    }
 }
 
 uint32_t
 rnn_regbase(struct rnn *rnn, const char *name)
 {
+   prof_begin(PROF_RNN);
    uint32_t regbase = rnndec_decodereg(rnn->vc_nocolor, rnn->dom[0], name);
    if (!regbase)
       regbase = rnndec_decodereg(rnn->vc_nocolor, rnn->dom[1], name);
+   prof_end();
    return regbase;
 }
 
 const char *
 rnn_regname(struct rnn *rnn, uint32_t regbase, int color)
 {
-   static char buf[128];
-   struct rnndecaddrinfo *info;
-
-   info = rnndec_decodeaddr(color ? rnn->vc : rnn->vc_nocolor,
-                            finddom(rnn, regbase), regbase, 0);
-   if (info) {
-      strcpy(buf, info->name);
-      free(info->name);
-      free(info);
-      return buf;
-   }
-   return NULL;
+   prof_begin(PROF_RNN);
+   const char *name = rnndec_regname(color ? rnn->vc : rnn->vc_nocolor,
+                                     finddom(rnn, regbase), regbase, 0);
+   prof_end();
+   return name;
 }
 
 struct rnndecaddrinfo *
 rnn_reginfo(struct rnn *rnn, uint32_t regbase)
 {
-   return rnndec_decodeaddr(rnn->vc, finddom(rnn, regbase), regbase, 0);
+   prof_begin(PROF_RNN);
+   struct rnndecaddrinfo *info =
+      rnndec_decodeaddr(rnn->vc, finddom(rnn, regbase), regbase, 0);
+   prof_end();
+   return info;
 }
 
 const char *
 rnn_enumname(struct rnn *rnn, const char *name, uint32_t val)
 {
-   return rnndec_decode_enum(rnn->vc, name, val);
+   prof_begin(PROF_RNN);
+   const char *str = rnndec_decode_enum(rnn->vc, name, val);
+   prof_end();
+   return str;
+}
+
+static int
+cmp_regbase(const void *a, const void *b)
+{
+   uint32_t ra = *(const uint32_t *)a, rb = *(const uint32_t *)b;
+   return (ra > rb) - (ra < rb);
+}
+
+/* Find the registers matching a query, which is one of:
+ *
+ *   NAME         - the register NAME
+ *   PREFIX*      - registers with names starting with PREFIX
+ *   FIELD:PREFIX - registers with a bitfield or enum value with a name
+ *                  starting with PREFIX
+ *
+ * Returns the number of matching registers, and a malloc'd array of their
+ * regbases in ascending order.
+ */
+unsigned
+rnn_findregs(struct rnn *rnn, const char *query, uint32_t **regbases)
+{
+   enum rnndecnamekind kind = RNNDEC_NAME_REG;
+   size_t len = strlen(query);
+   bool prefix = false;
+   uint32_t *regs = NULL;
+   unsigned nregs = 0, maxregs = 0;
+
+   if (!strncmp(query, "FIELD:", 6)) {
+      kind = RNNDEC_NAME_BITFIELD;
+      query += 6;
+      len -= 6;
+      prefix = true;
+   } else if (len > 0 && query[len - 1] == '*') {
+      len--;
+      prefix = true;
+   }
+
+   char *str = strndup(query, len);
+
+   for (int d = 0; d < 2; d++) {
+      const struct rnndecname *names;
+      int n;
+
+      if (!rnn->dom[d] || (d == 1 && rnn->dom[1] == rnn->dom[0]))
+         continue;
+
+      n = rnndec_findnames(rnn->vc_nocolor, rnn->dom[d], str, &names);
+      for (int i = 0; i < n; i++) {
+         if ((kind == RNNDEC_NAME_REG) != (names[i].kind == RNNDEC_NAME_REG))
+            continue;
+         if (!prefix && strcmp(names[i].name, str))
+            continue;
+         if (nregs == maxregs) {
+            maxregs = maxregs ? maxregs * 2 : 16;
+            regs = realloc(regs, maxregs * sizeof(regs[0]));
+         }
+         regs[nregs++] = names[i].addr;
+      }
+   }
+
+   free(str);
+
+   if (nregs) {
+      unsigned j = 0;
+
+      qsort(regs, nregs, sizeof(regs[0]), cmp_regbase);
+      for (unsigned i = 0; i < nregs; i++)
+         if (!j || regs[i] != regs[j - 1])
+            regs[j++] = regs[i];
+      nregs = j;
+   }
+
+   *regbases = regs;
+   return nregs;
 }
 
 static struct rnndelem *
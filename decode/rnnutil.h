@@ -30,6 +30,8 @@
 #define RNNUTIL_H_
 
 #include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <string.h>
 
@@ -41,6 +43,11 @@ struct rnn {
    struct rnndeccontext *vc, *vc_nocolor;
    struct rnndomain *dom[2];
    const char *variant;
+
+   /* for rnn_load_file_async(): */
+   pthread_t loader;
+   bool loading;
+   char *loadfile, *loaddomain;
 };
 
 union rnndecval {
@@ -52,11 +59,17 @@ union rnndecval {
 void _rnn_init(struct rnn *rnn, int nocolor);
 struct rnn *rnn_new(int nocolor);
 void rnn_load_file(struct rnn *rnn, char *file, char *domain);
+void rnn_load_file_async(struct rnn *rnn, char *file, char *domain);
+void rnn_load_wait(struct rnn *rnn);
 void rnn_load(struct rnn *rnn, const char *gpuname);
+struct rnn *rnn_get(char *file, char *domain, int nocolor, bool async);
+struct rnn *rnn_get_gpu(const char *gpuname, int nocolor);
+void rnn_warm(struct rnn *rnn);
 uint32_t rnn_regbase(struct rnn *rnn, const char *name);
 const char *rnn_regname(struct rnn *rnn, uint32_t regbase, int color);
 struct rnndecaddrinfo *rnn_reginfo(struct rnn *rnn, uint32_t regbase);
 const char *rnn_enumname(struct rnn *rnn, const char *name, uint32_t val);
+unsigned rnn_findregs(struct rnn *rnn, const char *query, uint32_t **regbases);
 
 struct rnndelem *rnn_regelem(struct rnn *rnn, const char *name);
 struct rnndelem *rnn_regoff(struct rnn *rnn, uint32_t offset);
@@ -523,11 +523,33 @@ l_rnn_regval(lua_State *L)
    return 1;
 }
 
+/* returns an array of the regbases matching a query, in the same form as
+ * cffdump's --query (ie. "RB_MRT*" or "FIELD:SWAP"):
+ */
+static int
+l_rnn_findregs(lua_State *L)
+{
+   struct rnn *rnn = lua_touserdata(L, 1);
+   const char *query = lua_tostring(L, 2);
+   uint32_t *regbases;
+   unsigned n = rnn_findregs(rnn, query, &regbases);
+
+   lua_createtable(L, n, 0);
+   for (unsigned i = 0; i < n; i++) {
+      lua_pushinteger(L, regbases[i]);
+      lua_rawseti(L, -2, i + 1);
+   }
+   free(regbases);
+
+   return 1;
+}
+
 static const struct luaL_Reg l_rnn[] = {
    {"init", l_rnn_init},
    {"enumname", l_rnn_enumname},
    {"regname", l_rnn_regname},
    {"regval", l_rnn_regval},
+   {"findregs", l_rnn_findregs},
    {NULL, NULL} /* sentinel */
 };
 
@@ -0,0 +1,211 @@
+/*
+ * Copyright © 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <err.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+#include "server.h"
+
+#define MAX_REQUEST 0x10000
+
+/* Read the request line, returns false if the client went away or sent
+ * something too large to be a request.  This reads a byte at a time, so
+ * that anything the client sends after the request is left for the child
+ * to read from stdin (ie. for "cffdump -"):
+ */
+static bool
+read_request(int fd, char *buf)
+{
+   size_t len = 0;
+
+   while (len < MAX_REQUEST - 1) {
+      ssize_t ret = read(fd, buf + len, 1);
+      if (ret < 0) {
+         if (errno == EINTR)
+            continue;
+         return false;
+      }
+      if ((ret == 0) || (buf[len] == '\n'))
+         break;
+      len++;
+   }
+
+   if (len == MAX_REQUEST - 1)
+      return false;
+
+   buf[len] = '\0';
+   return true;
+}
+
+/* Split the request into arguments, in place: */
+static int
+split_request(char *buf, char ***argvp)
+{
+   char **argv = malloc(sizeof(*argv));
+   int argc = 0;
+   char *p = buf;
+
+   argv[argc++] = program_invocation_name;
+
+   while (true) {
+      while ((*p == ' ') || (*p == '\t') || (*p == '\r'))
+         p++;
+      if (!*p)
+         break;
+
+      char *arg = p, *out = p;
+      while (*p && (*p != ' ') && (*p != '\t') && (*p != '\r')) {
+         if ((*p == '\\') && p[1])
+            p++;
+         *out++ = *p++;
+      }
+      if (*p)
+         p++;
+      *out = '\0';
+
+      argv = realloc(argv, (argc + 1) * sizeof(*argv));
+      argv[argc++] = arg;
+   }
+
+   argv = realloc(argv, (argc + 1) * sizeof(*argv));
+   argv[argc] = NULL;
+
+   *argvp = argv;
+   return argc;
+}
+
+static void
+handle_connection(int listenfd, int fd, const struct server_ops *ops)
+{
+   char *buf = malloc(MAX_REQUEST);
+   char **argv;
+   int argc;
+
+   if (!buf || !read_request(fd, buf)) {
+      free(buf);
+      return;
+   }
+
+   argc = split_request(buf, &argv);
+
+   /* so that nothing buffered in the server is written by the child: */
+   fflush(NULL);
+
+   pid_t pid = fork();
+   if (pid < 0) {
+      dprintf(fd, "fork failed: %s\n", strerror(errno));
+   } else if (pid == 0) {
+      close(listenfd);
+
+      /* the server ignores SIGCHLD so that children don't need reaping,
+       * restore the default for the child's own children (ie. the pager),
+       * and the child should die if the client goes away:
+       */
+      signal(SIGCHLD, SIG_DFL);
+      signal(SIGPIPE, SIG_DFL);
+
+      /* the socket had a receive timeout for reading the request: */
+      struct timeval timeout = {0};
+      setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+      dup2(fd, STDIN_FILENO);
+      dup2(fd, STDOUT_FILENO);
+      dup2(fd, STDERR_FILENO);
+      close(fd);
+
+      exit(ops->handle(argc, argv));
+   } else if (ops->prepare) {
+      /* after the child is on its way, so the client doesn't wait for it,
+       * and on a copy, since getopt() permutes the arguments:
+       */
+      char **args = malloc((argc + 1) * sizeof(*args));
+      memcpy(args, argv, (argc + 1) * sizeof(*args));
+      ops->prepare(argc, args);
+      free(args);
+   }
+
+   free(argv);
+   free(buf);
+}
+
+int
+server_run(const char *path, const struct server_ops *ops)
+{
+   struct sockaddr_un addr = {
+      .sun_family = AF_UNIX,
+   };
+   int listenfd;
+
+   if (strlen(path) >= sizeof(addr.sun_path))
+      errx(-1, "socket path too long: %s", path);
+   strcpy(addr.sun_path, path);
+
+   listenfd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+   if (listenfd < 0)
+      err(-1, "could not create socket");
+
+   /* replace a stale socket from a previous server: */
+   unlink(path);
+
+   if (bind(listenfd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+      err(-1, "could not bind %s", path);
+
+   if (listen(listenfd, 16) < 0)
+      err(-1, "could not listen on %s", path);
+
+   signal(SIGCHLD, SIG_IGN);
+   signal(SIGPIPE, SIG_IGN);
+
+   fprintf(stderr, "serving requests on %s\n", path);
+
+   while (true) {
+      int fd = accept4(listenfd, NULL, NULL, SOCK_CLOEXEC);
+      if (fd < 0) {
+         if ((errno == EINTR) || (errno == ECONNABORTED))
+            continue;
+         err(-1, "accept failed");
+      }
+
+      /* don't let a client which never sends its request stall the
+       * server:
+       */
+      struct timeval timeout = {
+         .tv_sec = 5,
+      };
+      setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+      handle_connection(listenfd, fd, ops);
+      close(fd);
+   }
+
+   return 0;
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright © 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __SERVER_H__
+#define __SERVER_H__
+
+/*
+ * Decode server, for --serve.  Listens on a Unix socket, and for each
+ * connection reads a request, which is a single line with the command line
+ * arguments for the decoder, separated by whitespace (a '\' escapes the
+ * following character).  A child process is forked to handle each request,
+ * with its stdin, stdout and stderr redirected to the connection, so the
+ * output is streamed back to the client as it is decoded, and the
+ * connection is closed when the child exits.  Anything the client sends
+ * after the request line can be read by the decoder from stdin.  For
+ * example:
+ *
+ *   $ cffdump --serve=/tmp/cffdump.sock &
+ *   $ echo "--summary -F 3 foo.rd.gz" | \
+ *       socat -t 60 - UNIX-CONNECT:/tmp/cffdump.sock
+ *
+ * The children inherit whatever state the server has warmed up before
+ * calling server_run() (or in prepare() after earlier forks), ie. the
+ * register database lookup tables, but anything a child builds is lost
+ * when it exits.
+ */
+
+struct server_ops {
+   /* Called in the server after forking the child for a request, ie. to
+    * cache the files it references for later requests.  The next
+    * connection isn't accepted until it returns, so it should bound the
+    * work it does.  Optional.
+    */
+   void (*prepare)(int argc, char **argv);
+
+   /* Called in the child to handle the request, argv[0] is the name of the
+    * server program.  The return value is the child's exit status.
+    */
+   int (*handle)(int argc, char **argv);
+};
+
+int server_run(const char *path, const struct server_ops *ops);
+
+#endif /* __SERVER_H__ */
@@ -0,0 +1,1020 @@
+/*
+ * Copyright © 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "buffers.h"
+#include "cffdec.h"
+#include "pager.h"
+#include "redump.h"
+#include "viewer.h"
+
+/* Budget for the decoded text of submits kept in memory, the least recently
+ * viewed are dropped (and decoded again if needed) beyond this:
+ */
+#define MAX_TEXT_CACHE (512ull * 1024 * 1024)
+
+#define MAX_REGS 0x10000
+#define MAX_OPC  0x100
+#define MAX_IB   4
+
+/* results of a search which are listed: */
+#define MAX_RESULTS 1000
+
+#define NO_NODE (~0u)
+
+/* A node of the tree of a submit: */
+struct node {
+   uint8_t type;    /* enum viewer_node_type */
+   uint8_t ib;      /* IB level */
+   uint32_t arg;    /* see enum viewer_node_type */
+   uint32_t parent; /* the packet of an IB or draw, the IB of a packet */
+   uint32_t draw;   /* the draws in the submit so far */
+   uint64_t offset; /* in the decoded text */
+};
+
+struct submit {
+   /* the process which submitted it (RD_CMD), in the capture: */
+   size_t cmd, cmdlen;
+
+   /* the sections of the capture with the buffers and cmdstream: */
+   size_t start, end;
+   unsigned sizedwords;
+
+   bool skip;
+   bool indexed;
+
+   struct node *nodes;
+   unsigned nnodes, maxnodes;
+   unsigned ndraws;
+
+   /* the decoded text, while cached: */
+   char *text;
+   size_t len;
+   unsigned last_used;
+};
+
+/* Where a register is written or a packet type used: */
+struct hit {
+   uint32_t submit;
+   uint32_t node;
+   uint64_t offset;
+};
+
+struct hits {
+   struct hit *hits;
+   unsigned nhits, maxhits;
+};
+
+/* A hit found by a search, for the register or packet it matched: */
+struct result {
+   struct hit hit;
+   enum viewer_node_type type;
+   uint32_t arg;
+};
+
+bool viewer_indexing;
+
+static struct {
+   const uint8_t *capture;
+   size_t len;
+   struct cffdec_options *options;
+
+   struct submit *submits;
+   unsigned nsubmits, maxsubmits, nskipped;
+
+   /* the submit the commands apply to by default: */
+   unsigned current;
+
+   /* the submit being indexed, and its current IB and packet at each IB
+    * level:
+    */
+   unsigned indexing;
+   uint32_t ib_node[MAX_IB];
+   uint32_t pkt_node[MAX_IB];
+   uint32_t last_pkt;
+
+   /* the search index, and for each register the packet it was last
+    * written by (+1), so that a packet writing the same register more
+    * than once is only a single hit:
+    */
+   struct hits *reg_hits;
+   struct hits pkt_hits[MAX_OPC];
+   uint32_t *reg_last;
+   unsigned nindexed;
+
+   size_t text_size;
+   unsigned clock;
+
+   /* the results of the last search: */
+   struct result *results;
+   unsigned nresults;
+} view;
+
+static void
+parse_addr(const uint32_t *buf, int sz, unsigned int *len, uint64_t *gpuaddr)
+{
+   *gpuaddr = buf[0];
+   *len = buf[1];
+   if (sz > 8)
+      *gpuaddr |= ((uint64_t)(buf[2])) << 32;
+}
+
+/* Iterate the sections of the capture, returning false at the end: */
+static bool
+next_section(size_t *offset, size_t end, uint32_t *type, const void **data,
+             uint32_t *sz)
+{
+   uint32_t hdr[2];
+
+   while (true) {
+      if (end - *offset < sizeof(hdr))
+         return false;
+
+      memcpy(hdr, view.capture + *offset, sizeof(hdr));
+      *offset += sizeof(hdr);
+
+      if ((hdr[0] != 0xffffffff) || (hdr[1] != 0xffffffff))
+         break;
+   }
+
+   /* a truncated capture: */
+   if (hdr[1] > end - *offset)
+      return false;
+
+   *type = hdr[0];
+   *sz = hdr[1];
+   *data = view.capture + *offset;
+   *offset += hdr[1];
+
+   return true;
+}
+
+/* Find the submits in the capture, and which buffers each one uses, which
+ * are the buffers since the previous submit, as in handle_file():
+ */
+static void
+scan_capture(viewer_skip_fn skip_cmd)
+{
+   size_t offset = 0, start = 0, cmd = 0, cmdlen = 0;
+   bool needs_reset = false, skip = false, got_gpu_id = false;
+   const void *data;
+   uint32_t type, sz;
+
+   while (true) {
+      size_t section = offset;
+
+      if (!next_section(&offset, view.len, &type, &data, &sz))
+         break;
+
+      switch (type) {
+      case RD_CMD: {
+         char *str = strndup(data, sz);
+         cmd = (const uint8_t *)data - view.capture;
+         cmdlen = strlen(str);
+         skip = skip_cmd(str);
+         free(str);
+         break;
+      }
+      case RD_GPUADDR:
+         if (needs_reset) {
+            start = section;
+            needs_reset = false;
+         }
+         break;
+      case RD_CMDSTREAM_ADDR: {
+         unsigned sizedwords;
+         uint64_t gpuaddr;
+
+         parse_addr(data, sz, &sizedwords, &gpuaddr);
+
+         if (view.nsubmits == view.maxsubmits) {
+            view.maxsubmits = MAX2(2 * view.maxsubmits, 64);
+            view.submits = realloc(view.submits, view.maxsubmits *
+                                                    sizeof(view.submits[0]));
+         }
+         view.submits[view.nsubmits++] = (struct submit){
+            .cmd = cmd,
+            .cmdlen = cmdlen,
+            .start = start,
+            .end = offset,
+            .sizedwords = sizedwords,
+            .skip = skip,
+         };
+         view.nskipped += skip;
+         needs_reset = true;
+         break;
+      }
+      case RD_GPU_ID:
+         if (!got_gpu_id && (sz >= 4)) {
+            memcpy(&view.options->gpu_id, data, 4);
+            got_gpu_id = true;
+         }
+         break;
+      default:
+         break;
+      }
+   }
+}
+
+static uint32_t
+add_node(enum viewer_node_type type, int ib, uint32_t arg, uint32_t parent,
+         uint64_t offset)
+{
+   struct submit *s = &view.submits[view.indexing];
+
+   if (s->nnodes == s->maxnodes) {
+      s->maxnodes = MAX2(2 * s->maxnodes, 256);
+      s->nodes = realloc(s->nodes, s->maxnodes * sizeof(s->nodes[0]));
+   }
+
+   s->nodes[s->nnodes] = (struct node){
+      .type = type,
+      .ib = ib,
+      .arg = arg,
+      .parent = parent,
+      .draw = s->ndraws,
+      .offset = offset,
+   };
+
+   return s->nnodes++;
+}
+
+static void
+add_hit(struct hits *hits, uint32_t node, uint64_t offset)
+{
+   if (hits->nhits == hits->maxhits) {
+      hits->maxhits = MAX2(2 * hits->maxhits, 16);
+      hits->hits = realloc(hits->hits, hits->maxhits * sizeof(hits->hits[0]));
+   }
+
+   hits->hits[hits->nhits++] = (struct hit){
+      .submit = view.indexing,
+      .node = node,
+      .offset = offset,
+   };
+}
+
+void
+__viewer_ib(int ib, uint32_t sizedwords)
+{
+   if (ib >= MAX_IB)
+      return;
+
+   /* the submit's own cmdstream is the root of the tree: */
+   if (ib == 0) {
+      view.ib_node[0] = NO_NODE;
+      view.pkt_node[0] = NO_NODE;
+      view.last_pkt = NO_NODE;
+      return;
+   }
+
+   view.ib_node[ib] = add_node(VIEWER_IB, ib, sizedwords,
+                               view.pkt_node[ib - 1], ftell(stdout));
+   view.pkt_node[ib] = NO_NODE;
+}
+
+void
+__viewer_packet(int ib, enum viewer_node_type type, uint32_t arg)
+{
+   uint64_t offset = ftell(stdout);
+   uint32_t node;
+
+   if (ib >= MAX_IB)
+      return;
+
+   node = add_node(type, ib, arg, view.ib_node[ib], offset);
+   view.pkt_node[ib] = node;
+   view.last_pkt = node;
+
+   if (type == VIEWER_PKT)
+      add_hit(&view.pkt_hits[arg % MAX_OPC], node, offset);
+}
+
+void
+__viewer_draw(int ib, int draw)
+{
+   struct submit *s = &view.submits[view.indexing];
+   uint32_t pkt;
+
+   if (ib >= MAX_IB)
+      return;
+
+   /* the draw is shown from the packet which triggered it: */
+   pkt = view.pkt_node[ib];
+   add_node(VIEWER_DRAW, ib, draw, pkt,
+            (pkt != NO_NODE) ? s->nodes[pkt].offset : ftell(stdout));
+
+   s->ndraws++;
+}
+
+void
+__viewer_reg(uint32_t regbase)
+{
+   uint32_t node = view.last_pkt;
+
+   if ((node == NO_NODE) || (regbase >= MAX_REGS) ||
+       (view.reg_last[regbase] == node + 1))
+      return;
+
+   view.reg_last[regbase] = node + 1;
+   add_hit(&view.reg_hits[regbase], node, ftell(stdout));
+}
+
+static void
+evict_text(unsigned keep)
+{
+   while (view.text_size > MAX_TEXT_CACHE) {
+      struct submit *lru = NULL;
+
+      for (unsigned i = 0; i < view.nsubmits; i++) {
+         struct submit *s = &view.submits[i];
+         if (s->text && (i != keep) &&
+             (!lru || (s->last_used < lru->last_used)))
+            lru = s;
+      }
+
+      if (!lru)
+         break;
+
+      view.text_size -= lru->len;
+      free(lru->text);
+      lru->text = NULL;
+      lru->len = 0;
+   }
+}
+
+/* Decode a submit, if it is not already cached, and index it the first
+ * time it is decoded.  Each submit is decoded starting over from the
+ * initial state, so decoding it again gives the same text.
+ */
+static bool
+decode_submit(unsigned n)
+{
+   struct submit *s = &view.submits[n];
+   size_t offset = s->start;
+   const void *data;
+   uint32_t type, sz;
+   unsigned sizedwords = 0, len = 0;
+   uint64_t cmdaddr = 0, addr = 0;
+   FILE *out, *prev_stdout;
+
+   if (s->skip) {
+      printf("submit %u is skipped (see --exe and --show-compositor)\n", n);
+      return false;
+   }
+
+   s->last_used = ++view.clock;
+
+   if (s->text)
+      return true;
+
+   reset_buffers();
+
+   while (next_section(&offset, s->end, &type, &data, &sz)) {
+      switch (type) {
+      case RD_GPUADDR:
+         parse_addr(data, sz, &len, &addr);
+         break;
+      case RD_BUFFER_CONTENTS: {
+         void *buf = malloc(sz);
+         memcpy(buf, data, sz);
+         add_buffer(addr, len, buf);
+         break;
+      }
+      case RD_CMDSTREAM_ADDR:
+         parse_addr(data, sz, &sizedwords, &cmdaddr);
+         break;
+      default:
+         break;
+      }
+   }
+
+   cffdec_init(view.options);
+
+   out = open_memstream(&s->text, &s->len);
+   if (!out) {
+      printf("could not decode submit %u: %s\n", n, strerror(errno));
+      return false;
+   }
+
+   fflush(stdout);
+   prev_stdout = stdout;
+   stdout = out;
+
+   if (!s->indexed) {
+      view.indexing = n;
+      memset(view.reg_last, 0, MAX_REGS * sizeof(view.reg_last[0]));
+      viewer_indexing = true;
+   }
+
+   printl(2, "############################################################\n");
+   printl(2, "cmdstream: %d dwords\n", sizedwords);
+   dump_commands(hostptr(cmdaddr), sizedwords, 0);
+   cffdec_end_submit();
+   printl(2, "############################################################\n");
+
+   if (viewer_indexing) {
+      viewer_indexing = false;
+      s->indexed = true;
+      view.nindexed++;
+   }
+
+   stdout = prev_stdout;
+   fclose(out);
+
+   view.text_size += s->len;
+   evict_text(n);
+
+   return true;
+}
+
+static unsigned
+offset_to_line(const struct submit *s, uint64_t offset)
+{
+   const char *p = s->text, *end = s->text + MIN2(offset, s->len);
+   unsigned line = 1;
+
+   while ((p = memchr(p, '\n', end - p))) {
+      line++;
+      p++;
+   }
+
+   return line;
+}
+
+static void
+show_text(unsigned n, uint64_t offset)
+{
+   struct submit *s = &view.submits[n];
+
+   if (!decode_submit(n))
+      return;
+
+   view.current = n;
+   pager_show(s->text, s->len, offset_to_line(s, offset));
+}
+
+/*
+ * Command output which might be long is paged:
+ */
+
+static FILE *list;
+static char *list_buf;
+static size_t list_len;
+
+static void
+begin_list(void)
+{
+   fflush(stdout);
+   list = open_memstream(&list_buf, &list_len);
+}
+
+static void
+end_list(void)
+{
+   fclose(list);
+   pager_show(list_buf, list_len, 1);
+   free(list_buf);
+   list = NULL;
+}
+
+static const char *
+node_name(const struct submit *s, const struct node *node)
+{
+   static char buf[64];
+
+   switch (node->type) {
+   case VIEWER_IB:
+      snprintf(buf, sizeof(buf), "IB%u", node->ib);
+      return buf;
+   case VIEWER_PKT:
+      return pktname(node->arg) ? pktname(node->arg) : "unknown packet";
+   case VIEWER_REGS:
+      return regname(node->arg, 0) ? regname(node->arg, 0) : "unknown reg";
+   case VIEWER_DRAW:
+      snprintf(buf, sizeof(buf), "draw %u", node->arg);
+      return buf;
+   }
+
+   return NULL;
+}
+
+static const char *
+parent_name(const struct submit *s, const struct node *node)
+{
+   if (node->parent == NO_NODE)
+      return "cmdstream";
+   return node_name(s, &s->nodes[node->parent]);
+}
+
+static void
+list_submit(unsigned n)
+{
+   const struct submit *s = &view.submits[n];
+
+   fprintf(list, "%6u: %.*s, %u dwords", n, (int)s->cmdlen,
+           view.capture + s->cmd, s->sizedwords);
+   if (s->skip)
+      fprintf(list, ", skipped");
+   else if (s->indexed)
+      fprintf(list, ", %u draws", s->ndraws);
+   fprintf(list, "\n");
+}
+
+/* An IB is shown in the outline of a submit if it is called by an
+ * CP_INDIRECT_BUFFER* packet, rather than ie. a draw state group:
+ */
+static bool
+outline_ib(const struct submit *s, const struct node *node)
+{
+   const char *name;
+
+   if (node->parent == NO_NODE)
+      return true;
+
+   name = node_name(s, &s->nodes[node->parent]);
+
+   return !strncmp(name, "CP_INDIRECT_BUFFER", strlen("CP_INDIRECT_BUFFER"));
+}
+
+static void
+list_tree(unsigned n, bool all)
+{
+   const struct submit *s = &view.submits[n];
+
+   list_submit(n);
+
+   for (unsigned i = 0; i < s->nnodes; i++) {
+      const struct node *node = &s->nodes[i];
+      int indent = 2 * node->ib + 2;
+
+      switch (node->type) {
+      case VIEWER_IB:
+         if (!all && !outline_ib(s, node))
+            continue;
+         fprintf(list, "#%-7u %*s%s: %s, %u dwords\n", i, indent - 2, "",
+                 node_name(s, node), parent_name(s, node), node->arg);
+         break;
+      case VIEWER_PKT:
+      case VIEWER_REGS:
+         if (!all)
+            continue;
+         fprintf(list, "#%-7u %*s%s%s\n", i, indent, "",
+                 (node->type == VIEWER_REGS) ? "write " : "",
+                 node_name(s, node));
+         break;
+      case VIEWER_DRAW:
+         fprintf(list, "#%-7u %*s%s: %s\n", i, indent + (all ? 2 : 0), "",
+                 node_name(s, node), parent_name(s, node));
+         break;
+      }
+   }
+}
+
+/*
+ * Commands:
+ */
+
+static bool
+parse_uint(const char *str, unsigned *val)
+{
+   char *end;
+   unsigned long v;
+
+   if (str[0] == '#')
+      str++;
+
+   errno = 0;
+   v = strtoul(str, &end, 0);
+
+   if (errno || (end == str) || *end || (v > UINT32_MAX))
+      return false;
+
+   *val = v;
+
+   return true;
+}
+
+static bool
+parse_submit(const char *str, unsigned *n)
+{
+   if (!parse_uint(str, n) || (*n >= view.nsubmits)) {
+      printf("no submit %s, there are %u submits\n", str, view.nsubmits);
+      return false;
+   }
+
+   return true;
+}
+
+static bool
+parse_range(int argc, char **argv, unsigned *first, unsigned *last)
+{
+   *first = 0;
+   *last = view.nsubmits - 1;
+
+   if (argc > 1) {
+      if (!parse_submit(argv[1], first))
+         return false;
+      *last = *first;
+   }
+
+   if ((argc > 2) && !parse_submit(argv[2], last))
+      return false;
+
+   return true;
+}
+
+static void
+cmd_submits(int argc, char **argv)
+{
+   unsigned first, last;
+
+   if (!parse_range(argc, argv, &first, &last))
+      return;
+
+   begin_list();
+   for (unsigned n = first; n <= last; n++)
+      list_submit(n);
+   end_list();
+}
+
+static void
+cmd_tree(int argc, char **argv)
+{
+   unsigned n = view.current;
+   bool all = false;
+
+   for (int i = 1; i < argc; i++) {
+      if (!strcmp(argv[i], "all"))
+         all = true;
+      else if (!parse_submit(argv[i], &n))
+         return;
+   }
+
+   if (!decode_submit(n))
+      return;
+
+   view.current = n;
+
+   begin_list();
+   list_tree(n, all);
+   end_list();
+}
+
+static void
+cmd_show(int argc, char **argv)
+{
+   unsigned n = view.current, node = NO_NODE;
+
+   if ((argc > 1) && !parse_submit(argv[1], &n))
+      return;
+
+   if (argc > 2) {
+      if (!decode_submit(n))
+         return;
+      if (!parse_uint(argv[2], &node) ||
+          (node >= view.submits[n].nnodes)) {
+         printf("no node %s in submit %u\n", argv[2], n);
+         return;
+      }
+   }
+
+   show_text(n, (node != NO_NODE) ? view.submits[n].nodes[node].offset : 0);
+}
+
+static void
+cmd_draw(int argc, char **argv)
+{
+   unsigned n = view.current, draw;
+   const struct submit *s = &view.submits[n];
+
+   if (argc < 2) {
+      printf("which draw?\n");
+      return;
+   }
+
+   if ((argc > 2) && !parse_submit(argv[1], &n))
+      return;
+
+   if (!parse_uint(argv[argc - 1], &draw)) {
+      printf("bad draw: %s\n", argv[argc - 1]);
+      return;
+   }
+
+   if (!decode_submit(n))
+      return;
+
+   s = &view.submits[n];
+   for (unsigned i = 0; i < s->nnodes; i++) {
+      const struct node *node = &s->nodes[i];
+      if ((node->type == VIEWER_DRAW) && (node->arg == draw)) {
+         show_text(n, node->offset);
+         return;
+      }
+   }
+
+   printf("no draw %u in submit %u, it has %u draws\n", draw, n, s->ndraws);
+}
+
+static void
+cmd_index(int argc, char **argv)
+{
+   unsigned first, last;
+   /* the progress line only makes sense on a terminal: */
+   bool progress = isatty(STDERR_FILENO);
+
+   if (!parse_range(argc, argv, &first, &last))
+      return;
+
+   for (unsigned n = first; n <= last; n++) {
+      if (view.submits[n].indexed || view.submits[n].skip)
+         continue;
+      if (progress)
+         fprintf(stderr, "\rindexing submit %u/%u", n, last);
+      decode_submit(n);
+   }
+   if (progress)
+      fprintf(stderr, "\r\033[K");
+
+   printf("%u of %u submits indexed\n", view.nindexed,
+          view.nsubmits - view.nskipped);
+}
+
+static void
+add_results(const struct hits *hits, enum viewer_node_type type, uint32_t arg)
+{
+   view.results = realloc(view.results, (view.nresults + hits->nhits) *
+                                           sizeof(view.results[0]));
+
+   for (unsigned i = 0; i < hits->nhits; i++) {
+      view.results[view.nresults++] = (struct result){
+         .hit = hits->hits[i],
+         .type = type,
+         .arg = arg,
+      };
+   }
+}
+
+static int
+cmp_result(const void *_a, const void *_b)
+{
+   const struct hit *a = &((const struct result *)_a)->hit;
+   const struct hit *b = &((const struct result *)_b)->hit;
+
+   if (a->submit != b->submit)
+      return (a->submit < b->submit) ? -1 : 1;
+   if (a->offset != b->offset)
+      return (a->offset < b->offset) ? -1 : 1;
+   return 0;
+}
+
+static void
+cmd_find(int argc, char **argv)
+{
+   const char *query;
+   uint32_t *regs = NULL;
+   unsigned nregs, npkts = 0;
+   size_t len;
+   bool prefix;
+
+   if (argc != 2) {
+      printf("find what?\n");
+      return;
+   }
+
+   query = argv[1];
+   len = strlen(query);
+   prefix = len && (query[len - 1] == '*');
+
+   view.nresults = 0;
+
+   /* registers, by name, PREFIX* or FIELD:PREFIX: */
+   nregs = findregs(query, &regs);
+   for (unsigned i = 0; i < nregs; i++) {
+      if (regs[i] < MAX_REGS)
+         add_results(&view.reg_hits[regs[i]], VIEWER_REGS, regs[i]);
+   }
+   free(regs);
+
+   /* and packets, by name or PREFIX*: */
+   for (unsigned opc = 0; opc < MAX_OPC; opc++) {
+      const char *name = pktname(opc);
+
+      if (!name)
+         continue;
+
+      if (prefix ? strncmp(name, query, len - 1) : strcmp(name, query))
+         continue;
+
+      add_results(&view.pkt_hits[opc], VIEWER_PKT, opc);
+      npkts++;
+   }
+
+   if (!nregs && !npkts) {
+      printf("no register or packet matches %s\n", query);
+      return;
+   }
+
+   qsort(view.results, view.nresults, sizeof(view.results[0]), cmp_result);
+
+   begin_list();
+
+   unsigned nsubmits = view.nsubmits - view.nskipped;
+   fprintf(list, "%u hits for %s (%u registers, %u packets) in the %u of %u "
+           "submits indexed%s:\n",
+           view.nresults, query, nregs, npkts, view.nindexed, nsubmits,
+           (view.nindexed < nsubmits) ? " (see 'index')" : "");
+
+   for (unsigned i = 0; i < MIN2(view.nresults, MAX_RESULTS); i++) {
+      const struct result *r = &view.results[i];
+      const struct submit *s = &view.submits[r->hit.submit];
+      const struct node *node = &s->nodes[r->hit.node];
+      const struct node match = { .type = r->type, .arg = r->arg };
+
+      fprintf(list, "[%u] submit %u, ", i, r->hit.submit);
+      if (node->draw < s->ndraws)
+         fprintf(list, "draw %u, ", node->draw);
+      else
+         fprintf(list, "after the last draw, ");
+      if (node->ib)
+         fprintf(list, "IB%u, ", node->ib);
+      fprintf(list, "%s", node_name(s, &match));
+
+      /* and what wrote the register, if not a packet for just it: */
+      if ((node->type != r->type) || (node->arg != r->arg)) {
+         fprintf(list, " (%s%s)", (node->type == VIEWER_REGS) ? "write " : "",
+                 node_name(s, node));
+      }
+      fprintf(list, "\n");
+   }
+
+   if (view.nresults > MAX_RESULTS)
+      fprintf(list, "... and %u more\n", view.nresults - MAX_RESULTS);
+
+   end_list();
+}
+
+static void
+cmd_goto(int argc, char **argv)
+{
+   unsigned i;
+
+   if ((argc != 2) || !parse_uint(argv[1], &i) || (i >= view.nresults)) {
+      printf("no such result, see 'find'\n");
+      return;
+   }
+
+   show_text(view.results[i].hit.submit, view.results[i].hit.offset);
+}
+
+static void cmd_help(int argc, char **argv);
+
+static bool quit;
+
+static void
+cmd_quit(int argc, char **argv)
+{
+   quit = true;
+}
+
+static const struct {
+   const char *name, *alias, *args, *help;
+   void (*fxn)(int argc, char **argv);
+} commands[] = {
+   /* clang-format off */
+   { "submits", "ls", "[FIRST [LAST]]", "list the submits (frames)", cmd_submits },
+   { "tree",    "t",  "[SUBMIT] [all]", "show the IBs and draws of a submit, or all packets", cmd_tree },
+   { "show",    "s",  "[SUBMIT [NODE]]", "show the decoded submit, from a node of its tree", cmd_show },
+   { "draw",    "d",  "[SUBMIT] DRAW", "show the decoded submit, from a draw", cmd_draw },
+   { "find",    "f",  "NAME", "find where a register (NAME, PREFIX*, FIELD:PREFIX) is written\n"
+                              "\t\t\tor a packet (NAME, PREFIX*) is used, in the indexed submits", cmd_find },
+   { "goto",    "g",  "N", "show the Nth result of the last find", cmd_goto },
+   { "index",   "i",  "[FIRST [LAST]]", "decode and index submits, so find sees them", cmd_index },
+   { "help",    "?",  "", "show this message", cmd_help },
+   { "quit",    "q",  "", "exit", cmd_quit },
+   /* clang-format on */
+};
+
+static void
+cmd_help(int argc, char **argv)
+{
+   printf("Commands (the SUBMIT defaults to the last one looked at):\n");
+   for (unsigned i = 0; i < ARRAY_SIZE(commands); i++) {
+      char usage[64];
+
+      snprintf(usage, sizeof(usage), "%s %s", commands[i].name,
+               commands[i].args);
+      printf("  %-20s - %s\n", usage, commands[i].help);
+   }
+}
+
+static void
+run_command(char *line)
+{
+   char *argv[8];
+   int argc = 0;
+
+   for (char *tok = strtok(line, " \t\n"); tok && (argc < ARRAY_SIZE(argv));
+        tok = strtok(NULL, " \t\n"))
+      argv[argc++] = tok;
+
+   if (!argc)
+      return;
+
+   for (unsigned i = 0; i < ARRAY_SIZE(commands); i++) {
+      if (!strcmp(argv[0], commands[i].name) ||
+          !strcmp(argv[0], commands[i].alias)) {
+         commands[i].fxn(argc, argv);
+         return;
+      }
+   }
+
+   printf("unknown command: %s, see 'help'\n", argv[0]);
+}
+
+int
+viewer_run(const char *filename, const void *capture, size_t len,
+           struct cffdec_options *options, viewer_skip_fn skip)
+{
+   bool prompt = isatty(STDIN_FILENO);
+   char line[256];
+
+   view.capture = capture;
+   view.len = len;
+   view.options = options;
+
+   scan_capture(skip);
+
+   if (!view.nsubmits) {
+      printf("no submits in %s\n", filename);
+      return -1;
+   }
+
+   /* for the register and packet names, before anything is decoded: */
+   cffdec_init(options);
+
+   view.reg_hits = calloc(MAX_REGS, sizeof(view.reg_hits[0]));
+   view.reg_last = calloc(MAX_REGS, sizeof(view.reg_last[0]));
+
+   while ((view.current < view.nsubmits - 1) &&
+          view.submits[view.current].skip)
+      view.current++;
+
+   printf("%s: %u submits, gpu %u, see 'help' for the commands\n", filename,
+          view.nsubmits, options->gpu_id);
+
+   while (!quit) {
+      if (prompt) {
+         printf("[%u]> ", view.current);
+         fflush(stdout);
+      }
+
+      if (!fgets(line, sizeof(line), stdin))
+         break;
+
+      run_command(line);
+   }
+
+   for (unsigned i = 0; i < view.nsubmits; i++) {
+      free(view.submits[i].nodes);
+      free(view.submits[i].text);
+   }
+   free(view.submits);
+
+   for (unsigned i = 0; i < MAX_REGS; i++)
+      free(view.reg_hits[i].hits);
+   for (unsigned i = 0; i < MAX_OPC; i++)
+      free(view.pkt_hits[i].hits);
+   free(view.reg_hits);
+   free(view.reg_last);
+   free(view.results);
+
+   return 0;
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright © 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __VIEWER_H__
+#define __VIEWER_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "util/macros.h"
+
+#include "cffdec.h"
+
+/*
+ * Interactive capture viewer, for cffdump --view.  Rather than decoding the
+ * whole capture into the pager, the capture is first scanned for its
+ * submits, and then each submit is decoded on demand, when it is looked at,
+ * the same way as with --frame (so the register state starts over for each
+ * submit).  The decoded text of recently viewed submits is kept in memory.
+ *
+ * While a submit is decoded, the hooks below build a tree of its IBs,
+ * packets and draws, with their position in the decoded text, and an index
+ * of where each register is written and each packet type is used, which is
+ * searched by the "find" command.  The index grows as more submits are
+ * decoded (or all of them with the "index" command).
+ */
+
+enum viewer_node_type {
+   VIEWER_IB,   /* arg is the size in dwords */
+   VIEWER_PKT,  /* arg is the type3/type7 opcode */
+   VIEWER_REGS, /* arg is the first register of a type0/type4 packet */
+   VIEWER_DRAW, /* arg is the draw number within the submit */
+};
+
+/* Returns true if the submits following an RD_CMD section with the given
+ * process name should not be decoded:
+ */
+typedef bool (*viewer_skip_fn)(const char *cmd);
+
+int viewer_run(const char *filename, const void *capture, size_t len,
+               struct cffdec_options *options, viewer_skip_fn skip);
+
+extern bool viewer_indexing;
+
+void __viewer_ib(int ib, uint32_t sizedwords);
+void __viewer_packet(int ib, enum viewer_node_type type, uint32_t arg);
+void __viewer_draw(int ib, int draw);
+void __viewer_reg(uint32_t regbase);
+
+static inline void
+viewer_ib(int ib, uint32_t sizedwords)
+{
+   if (unlikely(viewer_indexing))
+      __viewer_ib(ib, sizedwords);
+}
+
+static inline void
+viewer_packet(int ib, enum viewer_node_type type, uint32_t arg)
+{
+   if (unlikely(viewer_indexing))
+      __viewer_packet(ib, type, arg);
+}
+
+static inline void
+viewer_draw(int ib, int draw)
+{
+   if (unlikely(viewer_indexing))
+      __viewer_draw(ib, draw);
+}
+
+static inline void
+viewer_reg(uint32_t regbase)
+{
+   if (unlikely(viewer_indexing))
+      __viewer_reg(regbase);
+}
+
+#endif /* __VIEWER_H__ */
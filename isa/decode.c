@@ -148,6 +148,13 @@ struct decode_state {
 	 */
 	struct decode_scope *scope;
 
+	/**
+	 * Linear ralloc context for the current instruction, which the scopes
+	 * and their expression caches are allocated from, so that they can be
+	 * thrown away all at once when the instruction is decoded.
+	 */
+	void *instr_ctx;
+
 	/**
 	 * A small fixed upper limit on # of decode errors to capture per-
 	 * instruction seems reasonable.
@@ -214,7 +221,7 @@ pop_expr(struct decode_state *state)
 static struct decode_scope *
 push_scope(struct decode_state *state, const struct isa_bitset *bitset, uint64_t val)
 {
-	struct decode_scope *scope = rzalloc_size(state, sizeof(*scope));
+	struct decode_scope *scope = rzalloc_size(state->instr_ctx, sizeof(*scope));
 
 	scope->val = val;
 	scope->bitset = bitset;
@@ -646,6 +653,8 @@ decode(struct decode_state *state, void *bin, int sz)
 			continue;
 		}
 
+		state->instr_ctx = ralloc_linear_context(state);
+
 		struct decode_scope *scope = push_scope(state, b, instr);
 
 		display(scope);
@@ -658,6 +667,9 @@ decode(struct decode_state *state, void *bin, int sz)
 
 		pop_scope(scope);
 
+		ralloc_free(state->instr_ctx);
+		state->instr_ctx = NULL;
+
 		if (state->options->stop) {
 			break;
 		}
@@ -91,6 +91,32 @@ class Field(object):
 
 		return (type, val)
 
+	# the inverse of ctype(), the field value given the register value:
+	def unpack(self, name, reg_name):
+		width = self.high + 1 - self.low
+		uval = "((%s & %s__MASK) >> %s__SHIFT)" % (reg_name, name, name)
+		ival = "(((int32_t)(%s << %d)) >> %d)" % (reg_name, 31 - self.high, 32 - width)
+		if self.shr > 0:
+			uval = "(%s << %d)" % (uval, self.shr)
+			ival = "(int32_t)((uint32_t)%s << %d)" % (ival, self.shr)
+
+		if self.type == None or self.type in [ "uint", "hex", "a3xx_regid" ]:
+			return ("uint32_t", uval)
+		elif self.type == "int":
+			return ("int32_t", ival)
+		elif self.type == "fixed":
+			return ("float", "(%s / %d.0)" % (ival, 1 << self.radix))
+		elif self.type == "ufixed":
+			return ("float", "(%s / %d.0)" % (uval, 1 << self.radix))
+		elif self.type == "float" and width == 32:
+			return ("float", "uif(%s)" % reg_name)
+		elif self.type == "float" and width == 16:
+			return ("float", "_mesa_half_to_float(%s)" % uval)
+		elif self.type in [ "address", "waddress" ]:
+			return ("uint64_t", uval)
+		else:
+			return ("enum %s" % self.type, "(enum %s)%s" % (self.type, uval))
+
 def tab_to(name, value):
 	tab_count = (68 - (len(name) & ~7)) // 8
 	if tab_count <= 0:
@@ -221,6 +247,9 @@ class Bitset(object):
 				pass
 			elif f.type == "boolean" or (f.type == None and f.low == f.high):
 				tab_to("#define %s" % name, "0x%08x" % (1 << f.low))
+				type = "bool" if f.type == "boolean" else "uint32_t"
+				print("static inline %s %s__unpack(uint32_t reg)\n{" % (type, name))
+				print("\treturn !!(reg & %s);\n}" % name)
 			else:
 				tab_to("#define %s__MASK" % name, "0x%08x" % mask(f.low, f.high))
 				tab_to("#define %s__SHIFT" % name, "%d" % f.low)
@@ -230,6 +259,10 @@ class Bitset(object):
 				if f.shr > 0:
 					print("\tassert(!(val & 0x%x));" % mask(0, f.shr - 1))
 				print("\treturn ((%s) << %s__SHIFT) & %s__MASK;\n}" % (val, name, name))
+
+				type, val = f.unpack(name, "reg")
+				print("static inline %s %s__unpack(uint32_t reg)\n{" % (type, name))
+				print("\treturn %s;\n}" % val)
 		print()
 
 class Array(object):
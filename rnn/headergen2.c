@@ -437,6 +437,7 @@ int main(int argc, char **argv) {
 
 	rnn_init();
 	db = rnn_newdb();
+	db->validate = 1;
 	rnn_parsefile (db, file);
 	rnn_prepdb (db);
 	for(i = 0; i < db->filesnum; ++i) {
@@ -33,6 +33,7 @@
 #include <libxml/parser.h>
 #include <libxml/xpath.h>
 #include <libxml/xmlreader.h>
+#include <assert.h>
 #include <stdint.h>
 #include <string.h>
 #include <limits.h>
@@ -42,11 +43,31 @@
 #include "util.h"
 
 #include "util/u_debug.h"
+#include "util/hash_table.h"
+#include "util/ralloc.h"
+#include "util/set.h"
 
-static char *catstr (char *a, char *b) {
+/* Everything hanging off the db is allocated out of its linear allocator,
+ * and lives as long as the db does.  Strings from the xml are interned,
+ * since the same names, types and variants show up over and over again:
+ */
+static void *rnn_alloc (struct rnndb *db, size_t size) {
+	return linear_zalloc_child(db->mem, size);
+}
+
+static char *rnn_strdup (struct rnndb *db, const char *str) {
+	struct set_entry *entry = _mesa_set_search(db->strings, str);
+	if (entry)
+		return (char *)entry->key;
+	char *res = linear_strdup(db->mem, str);
+	_mesa_set_add(db->strings, res);
+	return res;
+}
+
+static char *catstr (struct rnndb *db, char *a, char *b) {
 	if (!a)
 		return b;
-	return aprintf("%s_%s", a, b);
+	return linear_asprintf(db->mem, "%s_%s", a, b);
 }
 
 static int strdiff (const char *a, const char *b) {
@@ -75,9 +96,22 @@ void rnn_init(void) {
 
 struct rnndb *rnn_newdb(void) {
 	struct rnndb *db = calloc(sizeof *db, 1);
+	void *mem_ctx = ralloc_context(NULL);
+	db->mem = linear_alloc_parent(mem_ctx, 0);
+	db->strings = _mesa_set_create(mem_ctx, _mesa_hash_string,
+				       _mesa_key_string_equal);
 	return db;
 }
 
+/* free a db that nothing has been loaded into (the arrays of a loaded
+ * db are not allocated from its linear allocator):
+ */
+void rnn_freedb(struct rnndb *db) {
+	assert(!db->filesnum);
+	ralloc_free(ralloc_parent_of_linear_parent(db->mem));
+	free(db);
+}
+
 static char *getcontent (xmlNode *attr) {
 	xmlNode *chain = attr->children;
 	size_t size = 0;
@@ -195,7 +229,7 @@ static int trytypeattr (struct rnndb *db, char *file, xmlNode *node, xmlAttr *at
 		ti->alignvalid = 1;
 		return 1;
 	} else if (!strcmp(attr->name, "type")) {
-		ti->name = strdup(getattrib(db, file, node->line, attr));;
+		ti->name = rnn_strdup(db, getattrib(db, file, node->line, attr));;
 		return 1;
 	} else if (!strcmp(attr->name, "radix")) {
 		ti->radix = getnumattrib(db, file, node->line, attr);
@@ -218,19 +252,19 @@ static int trytypeattr (struct rnndb *db, char *file, xmlNode *node, xmlAttr *at
 }
 
 static struct rnnvalue *parsevalue(struct rnndb *db, char *file, xmlNode *node) {
-	struct rnnvalue *val = calloc(sizeof *val, 1);
+	struct rnnvalue *val = rnn_alloc(db, sizeof *val);
 	val->file = file;
 	xmlAttr *attr = node->properties;
 	while (attr) {
 		if (!strcmp(attr->name, "name")) {
-			val->name = strdup(getattrib(db, file, node->line, attr));
+			val->name = rnn_strdup(db, getattrib(db, file, node->line, attr));
 		} else if (!strcmp(attr->name, "value")) {
 			val->value = getnumattrib(db, file, node->line, attr);
 			val->valvalid = 1;
 		} else if (!strcmp(attr->name, "varset")) {
-			val->varinfo.varsetstr = strdup(getattrib(db, file, node->line, attr));
+			val->varinfo.varsetstr = rnn_strdup(db, getattrib(db, file, node->line, attr));
 		} else if (!strcmp(attr->name, "variants")) {
-			val->varinfo.variantsstr = strdup(getattrib(db, file, node->line, attr));
+			val->varinfo.variantsstr = rnn_strdup(db, getattrib(db, file, node->line, attr));
 		} else {
 			rnn_err(db, "%s:%d: wrong attribute \"%s\" for value\n", file, node->line, attr->name);
 		}
@@ -253,13 +287,13 @@ static struct rnnvalue *parsevalue(struct rnndb *db, char *file, xmlNode *node)
 }
 
 static void parsespectype(struct rnndb *db, char *file, xmlNode *node) {
-	struct rnnspectype *res = calloc (sizeof *res, 1);
+	struct rnnspectype *res = rnn_alloc(db, sizeof *res);
 	res->file = file;
 	xmlAttr *attr = node->properties;
 	int i;
 	while (attr) {
 		if (!strcmp(attr->name, "name")) {
-			res->name = strdup(getattrib(db, file, node->line, attr));
+			res->name = rnn_strdup(db, getattrib(db, file, node->line, attr));
 		} else if (!trytypeattr(db, file, node, attr, &res->typeinfo)) {
 			rnn_err(db, "%s:%d: wrong attribute \"%s\" for spectype\n", file, node->line, attr->name);
 		}
@@ -302,11 +336,11 @@ static void parseenum(struct rnndb *db, char *file, xmlNode *node) {
 		} else if (!strcmp(attr->name, "inline")) {
 			isinline = getboolattrib(db, file, node->line, attr);
 		} else if (!strcmp(attr->name, "prefix")) {
-			prefixstr = strdup(getattrib(db, file, node->line, attr));
+			prefixstr = rnn_strdup(db, getattrib(db, file, node->line, attr));
 		} else if (!strcmp(attr->name, "varset")) {
-			varsetstr = strdup(getattrib(db, file, node->line, attr));
+			varsetstr = rnn_strdup(db, getattrib(db, file, node->line, attr));
 		} else if (!strcmp(attr->name, "variants")) {
-			variantsstr = strdup(getattrib(db, file, node->line, attr));
+			variantsstr = rnn_strdup(db, getattrib(db, file, node->line, attr));
 		} else {
 			rnn_err(db, "%s:%d: wrong attribute \"%s\" for enum\n", file, node->line, attr->name);
 		}
@@ -330,8 +364,8 @@ static void parseenum(struct rnndb *db, char *file, xmlNode *node) {
 			rnn_err(db, "%s:%d: merge fail for enum %s\n", file, node->line, node->name);
 		}
 	} else {
-		cur = calloc(sizeof *cur, 1);
-		cur->name = strdup(name);
+		cur = rnn_alloc(db, sizeof *cur);
+		cur->name = rnn_strdup(db, name);
 		cur->isinline = isinline;
 		cur->bare = bare;
 		cur->varinfo.prefixstr = prefixstr;
@@ -355,17 +389,17 @@ static void parseenum(struct rnndb *db, char *file, xmlNode *node) {
 }
 
 static struct rnnbitfield *parsebitfield(struct rnndb *db, char *file, xmlNode *node) {
-	struct rnnbitfield *bf = calloc(sizeof *bf, 1);
+	struct rnnbitfield *bf = rnn_alloc(db, sizeof *bf);
 	bf->file = file;
 	xmlAttr *attr = node->properties;
 	bf->typeinfo.low = bf->typeinfo.high = -1;
 	while (attr) {
 		if (!strcmp(attr->name, "name")) {
-			bf->name = strdup(getattrib(db, file, node->line, attr));
+			bf->name = rnn_strdup(db, getattrib(db, file, node->line, attr));
 		} else if (!strcmp(attr->name, "varset")) {
-			bf->varinfo.varsetstr = strdup(getattrib(db, file, node->line, attr));
+			bf->varinfo.varsetstr = rnn_strdup(db, getattrib(db, file, node->line, attr));
 		} else if (!strcmp(attr->name, "variants")) {
-			bf->varinfo.variantsstr = strdup(getattrib(db, file, node->line, attr));
+			bf->varinfo.variantsstr = rnn_strdup(db, getattrib(db, file, node->line, attr));
 		} else if (!trytypeattr(db, file, node, attr, &bf->typeinfo)) {
 			rnn_err(db, "%s:%d: wrong attribute \"%s\" for bitfield\n", file, node->line, attr->name);
 		}
@@ -407,11 +441,11 @@ static void parsebitset(struct rnndb *db, char *file, xmlNode *node) {
 		} else if (!strcmp(attr->name, "inline")) {
 			isinline = getboolattrib(db, file, node->line, attr);
 		} else if (!strcmp(attr->name, "prefix")) {
-			prefixstr = strdup(getattrib(db, file, node->line, attr));
+			prefixstr = rnn_strdup(db, getattrib(db, file, node->line, attr));
 		} else if (!strcmp(attr->name, "varset")) {
-			varsetstr = strdup(getattrib(db, file, node->line, attr));
+			varsetstr = rnn_strdup(db, getattrib(db, file, node->line, attr));
 		} else if (!strcmp(attr->name, "variants")) {
-			variantsstr = strdup(getattrib(db, file, node->line, attr));
+			variantsstr = rnn_strdup(db, getattrib(db, file, node->line, attr));
 		} else {
 			rnn_err(db, "%s:%d: wrong attribute \"%s\" for bitset\n", file, node->line, attr->name);
 		}
@@ -435,8 +469,8 @@ static void parsebitset(struct rnndb *db, char *file, xmlNode *node) {
 			rnn_err(db, "%s:%d: merge fail for bitset %s\n", file, node->line, node->name);
 		}
 	} else {
-		cur = calloc(sizeof *cur, 1);
-		cur->name = strdup(name);
+		cur = rnn_alloc(db, sizeof *cur);
+		cur->name = rnn_strdup(db, name);
 		cur->isinline = isinline;
 		cur->bare = bare;
 		cur->varinfo.prefixstr = prefixstr;
@@ -461,13 +495,13 @@ static void parsebitset(struct rnndb *db, char *file, xmlNode *node) {
 
 static struct rnndelem *trydelem(struct rnndb *db, char *file, xmlNode *node) {
 	if (!strcmp(node->name, "use-group")) {
-		struct rnndelem *res = calloc(sizeof *res, 1);
+		struct rnndelem *res = rnn_alloc(db, sizeof *res);
 		res->file = file;
 		res->type = RNN_ETYPE_USE_GROUP;
 		xmlAttr *attr = node->properties;
 		while (attr) {
 			if (!strcmp(attr->name, "ref")) {
-				res->name = strdup(getattrib(db, file, node->line, attr));
+				res->name = rnn_strdup(db, getattrib(db, file, node->line, attr));
 			} else {
 				rnn_err(db, "%s:%d: wrong attribute \"%s\" for %s\n", file, node->line, attr->name, node->name);
 			}
@@ -479,7 +513,7 @@ static struct rnndelem *trydelem(struct rnndb *db, char *file, xmlNode *node) {
 		}
 		return res;
 	} else if (!strcmp(node->name, "stripe") || !strcmp(node->name, "array")) {
-		struct rnndelem *res = calloc(sizeof *res, 1);
+		struct rnndelem *res = rnn_alloc(db, sizeof *res);
 		if (!strcmp(node->name, "array"))
 			res->name = "";
 		res->type = (strcmp(node->name, "stripe")?RNN_ETYPE_ARRAY:RNN_ETYPE_STRIPE);
@@ -488,7 +522,7 @@ static struct rnndelem *trydelem(struct rnndb *db, char *file, xmlNode *node) {
 		xmlAttr *attr = node->properties;
 		while (attr) {
 			if (!strcmp(attr->name, "name")) {
-				res->name = strdup(getattrib(db, file, node->line, attr));
+				res->name = rnn_strdup(db, getattrib(db, file, node->line, attr));
 			} else if (!strcmp(attr->name, "offset")) {
 				res->offset = getnumattrib(db, file, node->line, attr);
 			} else if (!strcmp(attr->name, "offsets")) {
@@ -504,13 +538,13 @@ static struct rnndelem *trydelem(struct rnndb *db, char *file, xmlNode *node) {
 				free(tmp);
 			} else if (!strcmp(attr->name, "doffset")) {
 				/* dynamic runtime determined offset: */
-				res->doffset = strdup(getattrib(db, file, node->line, attr));
+				res->doffset = rnn_strdup(db, getattrib(db, file, node->line, attr));
 			} else if (!strcmp(attr->name, "doffsets")) {
 				/* dynamic runtime determined offsets: */
 				char *str = strdup(getattrib(db, file, node->line, attr));
 				char *tok, *save, *tmp = str;
 				while ((tok = strtok_r(str, ",", &save))) {
-					char *doffset = strdup(tok);
+					char *doffset = rnn_strdup(db, tok);
 					ADDARRAY(res->doffsets, doffset);
 					str = NULL;
 				}
@@ -522,11 +556,11 @@ static struct rnndelem *trydelem(struct rnndb *db, char *file, xmlNode *node) {
 			} else if (!strcmp(attr->name, "stride")) {
 				res->stride = getnumattrib(db, file, node->line, attr);
 			} else if (!strcmp(attr->name, "prefix")) {
-				res->varinfo.prefixstr = strdup(getattrib(db, file, node->line, attr));
+				res->varinfo.prefixstr = rnn_strdup(db, getattrib(db, file, node->line, attr));
 			} else if (!strcmp(attr->name, "varset")) {
-				res->varinfo.varsetstr = strdup(getattrib(db, file, node->line, attr));
+				res->varinfo.varsetstr = rnn_strdup(db, getattrib(db, file, node->line, attr));
 			} else if (!strcmp(attr->name, "variants")) {
-				res->varinfo.variantsstr = strdup(getattrib(db, file, node->line, attr));
+				res->varinfo.variantsstr = rnn_strdup(db, getattrib(db, file, node->line, attr));
 			} else if (!strcmp(attr->name, "index")) {
 				const char *enumname = getattrib(db, file, node->line, attr);
 				res->index = rnn_findenum(db, enumname);
@@ -569,7 +603,7 @@ static struct rnndelem *trydelem(struct rnndb *db, char *file, xmlNode *node) {
 		width = 64;
 	else
 		return 0;
-	struct rnndelem *res = calloc(sizeof *res, 1);
+	struct rnndelem *res = rnn_alloc(db, sizeof *res);
 	res->file = file;
 	res->type = RNN_ETYPE_REG;
 	res->width = width;
@@ -580,7 +614,7 @@ static struct rnndelem *trydelem(struct rnndb *db, char *file, xmlNode *node) {
 	res->typeinfo.high = width - 1;
 	while (attr) {
 		if (!strcmp(attr->name, "name")) {
-			res->name = strdup(getattrib(db, file, node->line, attr));
+			res->name = rnn_strdup(db, getattrib(db, file, node->line, attr));
 		} else if (!strcmp(attr->name, "offset")) {
 			res->offset = getnumattrib(db, file, node->line, attr);
 		} else if (!strcmp(attr->name, "length")) {
@@ -588,9 +622,9 @@ static struct rnndelem *trydelem(struct rnndb *db, char *file, xmlNode *node) {
 		} else if (!strcmp(attr->name, "stride")) {
 			res->stride = getnumattrib(db, file, node->line, attr);
 		} else if (!strcmp(attr->name, "varset")) {
-			res->varinfo.varsetstr = strdup(getattrib(db, file, node->line, attr));
+			res->varinfo.varsetstr = rnn_strdup(db, getattrib(db, file, node->line, attr));
 		} else if (!strcmp(attr->name, "variants")) {
-			res->varinfo.variantsstr = strdup(getattrib(db, file, node->line, attr));
+			res->varinfo.variantsstr = rnn_strdup(db, getattrib(db, file, node->line, attr));
 		} else if (!strcmp(attr->name, "access")) {
 			char *str = getattrib(db, file, node->line, attr);
 			if (!strcmp(str, "r"))
@@ -645,8 +679,8 @@ static void parsegroup(struct rnndb *db, char *file, xmlNode *node) {
 			break;
 		}
 	if (!cur) {
-		cur = calloc(sizeof *cur, 1);
-		cur->name = strdup(name);
+		cur = rnn_alloc(db, sizeof *cur);
+		cur->name = rnn_strdup(db, name);
 		ADDARRAY(db->groups, cur);
 	}
 	xmlNode *chain = node->children;
@@ -662,7 +696,10 @@ static void parsegroup(struct rnndb *db, char *file, xmlNode *node) {
 	}
 }
 
-static void parsedomain(struct rnndb *db, char *file, xmlNode *node) {
+/* the domain itself, without its contents, which are added with
+ * parsedomainchild():
+ */
+static struct rnndomain *parsedomainhead(struct rnndb *db, char *file, xmlNode *node) {
 	xmlAttr *attr = node->properties;
 	char *name = 0;
 	uint64_t size = 0; int width = 8;
@@ -681,11 +718,11 @@ static void parsedomain(struct rnndb *db, char *file, xmlNode *node) {
 		} else if (!strcmp(attr->name, "width")) {
 			width = getnumattrib(db, file, node->line, attr);
 		} else if (!strcmp(attr->name, "prefix")) {
-			prefixstr = strdup(getattrib(db, file, node->line, attr));
+			prefixstr = rnn_strdup(db, getattrib(db, file, node->line, attr));
 		} else if (!strcmp(attr->name, "varset")) {
-			varsetstr = strdup(getattrib(db, file, node->line, attr));
+			varsetstr = rnn_strdup(db, getattrib(db, file, node->line, attr));
 		} else if (!strcmp(attr->name, "variants")) {
-			variantsstr = strdup(getattrib(db, file, node->line, attr));
+			variantsstr = rnn_strdup(db, getattrib(db, file, node->line, attr));
 		} else {
 			rnn_err(db, "%s:%d: wrong attribute \"%s\" for domain\n", file, node->line, attr->name);
 		}
@@ -693,7 +730,7 @@ static void parsedomain(struct rnndb *db, char *file, xmlNode *node) {
 	}
 	if (!name) {
 		rnn_err(db, "%s:%d: nameless domain\n", file, node->line);
-		return;
+		return NULL;
 	}
 	struct rnndomain *cur = 0;
 	for (i = 0; i < db->domainsnum; i++)
@@ -714,8 +751,8 @@ static void parsedomain(struct rnndb *db, char *file, xmlNode *node) {
 				cur->size = size;
 		}
 	} else {
-		cur = calloc(sizeof *cur, 1);
-		cur->name = strdup(name);
+		cur = rnn_alloc(db, sizeof *cur);
+		cur->name = rnn_strdup(db, name);
 		cur->bare = bare;
 		cur->width = width;
 		cur->size = size;
@@ -725,19 +762,62 @@ static void parsedomain(struct rnndb *db, char *file, xmlNode *node) {
 		cur->file = file;
 		ADDARRAY(db->domains, cur);
 	}
+	return cur;
+}
+
+static void parsedomainchild(struct rnndb *db, char *file, struct rnndomain *cur, xmlNode *chain) {
+	struct rnndelem *delem;
+	if (chain->type != XML_ELEMENT_NODE) {
+	} else if ((delem = trydelem(db, file, chain))) {
+		ADDARRAY(cur->subelems, delem);
+	} else if (!trytop(db, file, chain) && !trydoc(db, file, chain)) {
+		rnn_err(db, "%s:%d: wrong tag in domain: <%s>\n", file, chain->line, chain->name);
+	}
+}
+
+static void parsedomain(struct rnndb *db, char *file, xmlNode *node) {
+	struct rnndomain *cur = parsedomainhead(db, file, node);
+	if (!cur)
+		return;
 	xmlNode *chain = node->children;
 	while (chain) {
-		struct rnndelem *delem;
-		if (chain->type != XML_ELEMENT_NODE) {
-		} else if ((delem = trydelem(db, file, chain))) {
-			ADDARRAY(cur->subelems, delem);
-		} else if (!trytop(db, file, chain) && !trydoc(db, file, chain)) {
-			rnn_err(db, "%s:%d: wrong tag in domain: <%s>\n", file, chain->line, chain->name);
-		}
+		parsedomainchild(db, file, cur, chain);
 		chain = chain->next;
 	}
 }
 
+/* A top-level domain can be most of the file (ie. A6XX in a6xx.xml), so
+ * rather than expanding all of it, stream through its contents and only
+ * expand one element of it at a time.  Called with the reader on the
+ * domain's start tag, and returns with it past the domain's end tag:
+ */
+static int streamdomain(struct rnndb *db, char *file, xmlTextReaderPtr reader) {
+	/* the node, with its attributes but no children yet: */
+	xmlNode *node = xmlTextReaderCurrentNode(reader);
+	struct rnndomain *cur = parsedomainhead(db, file, node);
+	if (!cur || xmlTextReaderIsEmptyElement(reader))
+		return xmlTextReaderNext(reader);
+
+	int depth = xmlTextReaderDepth(reader);
+	int ret = xmlTextReaderRead(reader);
+	while ((ret == 1) && (xmlTextReaderDepth(reader) > depth)) {
+		if (xmlTextReaderNodeType(reader) != XML_READER_TYPE_ELEMENT) {
+			ret = xmlTextReaderRead(reader);
+			continue;
+		}
+		xmlNode *chain = xmlTextReaderExpand(reader);
+		if (!chain)
+			return -1;
+		parsedomainchild(db, file, cur, chain);
+		ret = xmlTextReaderNext(reader);
+	}
+
+	/* skip the end tag: */
+	if (ret == 1)
+		ret = xmlTextReaderRead(reader);
+	return ret;
+}
+
 static void parsecopyright(struct rnndb *db, char *file, xmlNode *node) {
 	struct rnncopyright* copyright = &db->copyright;
 	xmlAttr *attr = node->properties;
@@ -763,15 +843,15 @@ static void parsecopyright(struct rnndb *db, char *file, xmlNode *node) {
 			} else
 				copyright->license = getcontent(chain);
 		else if (!strcmp(chain->name, "author")) {
-			struct rnnauthor* author = calloc(sizeof *author, 1);
+			struct rnnauthor* author = rnn_alloc(db, sizeof *author);
 			xmlAttr* authorattr = chain->properties;
 			xmlNode *authorchild = chain->children;
 			author->contributions = getcontent(chain);
 			while (authorattr) {
 				if (!strcmp(authorattr->name, "name"))
-					author->name = strdup(getattrib(db, file, chain->line, authorattr));
+					author->name = rnn_strdup(db, getattrib(db, file, chain->line, authorattr));
 				else if (!strcmp(authorattr->name, "email"))
-					author->email = strdup(getattrib(db, file, chain->line, authorattr));
+					author->email = rnn_strdup(db, getattrib(db, file, chain->line, authorattr));
 				else {
 					rnn_err(db, "%s:%d: wrong attribute \"%s\" for author\n", file, chain->line, authorattr->name);
 				}
@@ -784,7 +864,7 @@ static void parsecopyright(struct rnndb *db, char *file, xmlNode *node) {
 					char* nickname = 0;
 					while(nickattr) {
 						if (!strcmp(nickattr->name, "name"))
-							nickname = strdup(getattrib(db, file, authorchild->line, nickattr));
+							nickname = rnn_strdup(db, getattrib(db, file, authorchild->line, nickattr));
 						else {
 							rnn_err(db, "%s:%d: wrong attribute \"%s\" for nick\n", file, authorchild->line, nickattr->name);
 						}
@@ -865,17 +945,19 @@ static char * find_file(const char *file_orig)
 	return fname;
 }
 
-static int validate_doc(struct rnndb *db, xmlDocPtr doc, xmlNodePtr database)
+/* The schema is the same for every file, so only parse it once: */
+static char *schema_path;
+static xmlSchemaPtr schema;
+
+static int validate_file(struct rnndb *db, xmlTextReaderPtr reader, const char *fname)
 {
 	/* find the schemaLocation property: */
-	xmlAttrPtr attr = database->properties;
 	const char *schema_name = NULL;
-	char *schema_path;
+	char *path;
 
-	while (attr) {
-		if (!strcmp(attr->name, "schemaLocation")) {
-			xmlNodePtr data = attr->children;
-			schema_name = data->content;
+	while (xmlTextReaderMoveToNextAttribute(reader) == 1) {
+		if (!strcmp(xmlTextReaderConstLocalName(reader), "schemaLocation")) {
+			schema_name = xmlTextReaderConstValue(reader);
 			/* we expect this to look like <namespace url> schema.xsd.. I think
 			 * technically it is supposed to be just a URL, but that doesn't
 			 * quite match up to what we do.. Just skip over everything up to
@@ -893,28 +975,35 @@ static int validate_doc(struct rnndb *db, xmlDocPtr doc, xmlNodePtr database)
 		return 0;
 	}
 
-	schema_path = find_file(schema_name);
-	if (!schema_path) {
+	path = find_file(schema_name);
+	if (!path) {
 		rnn_err(db, "%s: couldn't find database file. Please set the env var RNN_PATH.\n", schema_name);
 		return 0;
 	}
 
-	xmlSchemaParserCtxtPtr parser = xmlSchemaNewParserCtxt(schema_path);
-	xmlSchemaPtr schema = xmlSchemaParse(parser);
+	if (!schema_path || strcmp(schema_path, path)) {
+		xmlSchemaParserCtxtPtr parser = xmlSchemaNewParserCtxt(path);
+		if (schema)
+			xmlSchemaFree(schema);
+		schema = xmlSchemaParse(parser);
+		xmlSchemaFreeParserCtxt(parser);
+		free(schema_path);
+		schema_path = path;
+	} else {
+		free(path);
+	}
+
+	/* validation is done in a separate streaming pass over the file: */
 	xmlSchemaValidCtxtPtr validCtxt = xmlSchemaNewValidCtxt(schema);
-	int ret = xmlSchemaValidateDoc(validCtxt, doc);
+	int ret = xmlSchemaValidateFile(validCtxt, fname, 0);
 
 	xmlSchemaFreeValidCtxt(validCtxt);
-	xmlSchemaFree(schema);
-	xmlSchemaFreeParserCtxt(parser);
-
-	free(schema_path);
 
 	return ret;
 }
 
 void rnn_parsefile (struct rnndb *db, char *file_orig) {
-	int i;
+	int i, ret;
 	char *fname;
 
 	fname = find_file(file_orig);
@@ -928,49 +1017,80 @@ void rnn_parsefile (struct rnndb *db, char *file_orig) {
 			return;
 		
 	ADDARRAY(db->files, fname);
-	xmlDocPtr doc = xmlParseFile(fname);
-	if (!doc) {
+	xmlTextReaderPtr reader = xmlReaderForFile(fname, NULL, 0);
+	if (!reader) {
 		rnn_err(db, "%s: couldn't open database file. Please set the env var RNN_PATH.\n", fname);
 		return;
 	}
-	xmlNode *root = doc->children;
-	while (root) {
-		if (root->type != XML_ELEMENT_NODE) {
-		} else if (strcmp(root->name, "database")) {
-			rnn_err(db, "%s:%d: wrong top-level tag <%s>\n", fname, root->line, root->name);
-		} else {
-			xmlNode *chain = root->children;
-			if (validate_doc(db, doc, root)) {
+
+	/* Rather than building the tree for the whole file, stream through
+	 * it and only expand one top-level element (or one element of a
+	 * top-level domain) at a time, which is freed by the reader once we
+	 * move past it:
+	 */
+	ret = xmlTextReaderRead(reader);
+	while (ret == 1) {
+		if (xmlTextReaderNodeType(reader) != XML_READER_TYPE_ELEMENT) {
+			ret = xmlTextReaderRead(reader);
+		} else if (xmlTextReaderDepth(reader) == 0) {
+			if (strcmp(xmlTextReaderConstName(reader), "database")) {
+				rnn_err(db, "%s:%d: wrong top-level tag <%s>\n", fname,
+						xmlTextReaderGetParserLineNumber(reader),
+						xmlTextReaderConstName(reader));
+				break;
+			}
+			if (db->validate && validate_file(db, reader, fname)) {
 				rnn_err(db, "%s: database file has errors\n", fname);
-				return;
+				break;
 			}
-			while (chain) {
-				if (chain->type != XML_ELEMENT_NODE) {
-				} else if (!trytop(db, fname, chain) && !trydoc(db, fname, chain)) {
-					rnn_err(db, "%s:%d: wrong tag in database: <%s>\n", fname, chain->line, chain->name);
-				}
-				chain = chain->next;
+			xmlTextReaderMoveToElement(reader);
+			ret = xmlTextReaderRead(reader);
+		} else if (!strcmp(xmlTextReaderConstName(reader), "domain")) {
+			ret = streamdomain(db, fname, reader);
+		} else {
+			xmlNode *chain = xmlTextReaderExpand(reader);
+			if (!chain) {
+				ret = -1;
+				break;
+			}
+			if (!trytop(db, fname, chain) && !trydoc(db, fname, chain)) {
+				rnn_err(db, "%s:%d: wrong tag in database: <%s>\n", fname, chain->line, chain->name);
 			}
+			ret = xmlTextReaderNext(reader);
 		}
-		root = root->next;
 	}
-	xmlFreeDoc(doc);
+	if (ret < 0)
+		rnn_err(db, "%s: couldn't parse database file\n", fname);
+	xmlFreeTextReader(reader);
 }
 
-static struct rnnvalue *copyvalue (struct rnnvalue *val, char *file) {
-	struct rnnvalue *res = calloc (sizeof *res, 1);
+/* the copy gets its own varsets array, so that it can be grown (and
+ * trimmed) independently of the original:
+ */
+static void copyvarinfo (struct rnnvarinfo *dst, struct rnnvarinfo *src) {
+	int i;
+	*dst = *src;
+	dst->varsets = 0;
+	dst->varsetsnum = 0;
+	dst->varsetsmax = 0;
+	for (i = 0; i < src->varsetsnum; i++)
+		ADDARRAY(dst->varsets, src->varsets[i]);
+}
+
+static struct rnnvalue *copyvalue (struct rnndb *db, struct rnnvalue *val, char *file) {
+	struct rnnvalue *res = rnn_alloc(db, sizeof *res);
 	res->name = val->name;
 	res->valvalid = val->valvalid;
 	res->value = val->value;
-	res->varinfo = val->varinfo;
+	copyvarinfo(&res->varinfo, &val->varinfo);
 	res->file = file;
 	return res;
 }
 
-static struct rnnbitfield *copybitfield (struct rnnbitfield *bf, char *file);
+static struct rnnbitfield *copybitfield (struct rnndb *db, struct rnnbitfield *bf, char *file);
 
 
-static void copytypeinfo (struct rnntypeinfo *dst, struct rnntypeinfo *src, char *file) {
+static void copytypeinfo (struct rnndb *db, struct rnntypeinfo *dst, struct rnntypeinfo *src, char *file) {
 	int i;
 	dst->name = src->name;
 	dst->shr = src->shr;
@@ -981,22 +1101,22 @@ static void copytypeinfo (struct rnntypeinfo *dst, struct rnntypeinfo *src, char
 	dst->align = src->align;
 	dst->addvariant = src->addvariant;
 	for (i = 0; i < src->valsnum; i++)
-		ADDARRAY(dst->vals, copyvalue(src->vals[i], file));
+		ADDARRAY(dst->vals, copyvalue(db, src->vals[i], file));
 	for (i = 0; i < src->bitfieldsnum; i++)
-		ADDARRAY(dst->bitfields, copybitfield(src->bitfields[i], file));
+		ADDARRAY(dst->bitfields, copybitfield(db, src->bitfields[i], file));
 }
 
-static struct rnnbitfield *copybitfield (struct rnnbitfield *bf, char *file) {
-	struct rnnbitfield *res = calloc (sizeof *res, 1);
+static struct rnnbitfield *copybitfield (struct rnndb *db, struct rnnbitfield *bf, char *file) {
+	struct rnnbitfield *res = rnn_alloc(db, sizeof *res);
 	res->name = bf->name;
-	res->varinfo = bf->varinfo;
+	copyvarinfo(&res->varinfo, &bf->varinfo);
 	res->file = file;
-	copytypeinfo(&res->typeinfo, &bf->typeinfo, file);
+	copytypeinfo(db, &res->typeinfo, &bf->typeinfo, file);
 	return res;
 }
 
-static struct rnndelem *copydelem (struct rnndelem *elem, char *file) {
-	struct rnndelem *res = calloc (sizeof *res, 1);
+static struct rnndelem *copydelem (struct rnndb *db, struct rnndelem *elem, char *file) {
+	struct rnndelem *res = rnn_alloc(db, sizeof *res);
 	res->type = elem->type;
 	res->name = elem->name;
 	res->width = elem->width;
@@ -1004,21 +1124,21 @@ static struct rnndelem *copydelem (struct rnndelem *elem, char *file) {
 	res->offset = elem->offset;
 	res->length = elem->length;
 	res->stride = elem->stride;
-	res->varinfo = elem->varinfo;
+	copyvarinfo(&res->varinfo, &elem->varinfo);
 	res->file = file;
-	copytypeinfo(&res->typeinfo, &elem->typeinfo, file);
+	copytypeinfo(db, &res->typeinfo, &elem->typeinfo, file);
 	int i;
 	for (i = 0; i < elem->subelemsnum; i++)
-		ADDARRAY(res->subelems, copydelem(elem->subelems[i], file));
+		ADDARRAY(res->subelems, copydelem(db, elem->subelems[i], file));
 	for (i = 0; i < elem->offsetsnum; i++)
 		ADDARRAY(res->offsets, elem->offsets[i]);
 	return res;
 }
 
-static struct rnnvarset *copyvarset (struct rnnvarset *varset) {
-	struct rnnvarset *res = calloc(sizeof *res, 1);
+static struct rnnvarset *copyvarset (struct rnndb *db, struct rnnvarset *varset) {
+	struct rnnvarset *res = rnn_alloc(db, sizeof *res);
 	res->venum = varset->venum;
-	res->variants = calloc(sizeof *res->variants, res->venum->valsnum);
+	res->variants = rnn_alloc(db, sizeof *res->variants * res->venum->valsnum);
 	int i;
 	for (i = 0; i < res->venum->valsnum; i++)
 		res->variants[i] = varset->variants[i];
@@ -1046,9 +1166,12 @@ static void prepvarinfo (struct rnndb *db, char *what, struct rnnvarinfo *vi, st
 			vi->prefenum = rnn_findenum(db, vi->prefixstr); // XXX
 	}
 	int i;
+	/* the parent's varsets are shared until the variants attribute
+	 * narrows one of them down, see below:
+	 */
 	if (parent)
 		for (i = 0; i < parent->varsetsnum; i++)
-			ADDARRAY(vi->varsets, copyvarset(parent->varsets[i]));
+			ADDARRAY(vi->varsets, parent->varsets[i]);
 	struct rnnenum *varset = vi->prefenum;
 	if (!varset && !vi->varsetstr && parent)
 		vi->varsetstr = parent->varsetstr;
@@ -1064,13 +1187,13 @@ static void prepvarinfo (struct rnndb *db, char *what, struct rnnvarinfo *vi, st
 		int nvars = varset->valsnum;
 		for (i = 0; i < vi->varsetsnum; i++)
 			if (vi->varsets[i]->venum == varset) {
-				vs = vi->varsets[i];
+				vs = vi->varsets[i] = copyvarset(db, vi->varsets[i]);
 				break;
 			}
 		if (!vs) {
-			vs = calloc (sizeof *vs, 1);
+			vs = rnn_alloc(db, sizeof *vs);
 			vs->venum = varset;
-			vs->variants = calloc(sizeof *vs->variants, nvars);
+			vs->variants = rnn_alloc(db, sizeof *vs->variants * nvars);
 			for (i = 0; i < nvars; i++)
 				vs->variants[i] = 1;
 			ADDARRAY(vi->varsets, vs);
@@ -1143,12 +1266,12 @@ static void prepvarinfo (struct rnndb *db, char *what, struct rnnvarinfo *vi, st
 }
 
 static void prepvalue(struct rnndb *db, struct rnnvalue *val, char *prefix, struct rnnvarinfo *parvi) {
-	val->fullname = catstr(prefix, val->name);
+	val->fullname = catstr(db, prefix, val->name);
 	prepvarinfo (db, val->fullname, &val->varinfo, parvi);
 	if (val->varinfo.dead)
 		return;
 	if (val->varinfo.prefix)
-		val->fullname = catstr(val->varinfo.prefix, val->fullname);
+		val->fullname = catstr(db, val->varinfo.prefix, val->fullname);
 }
 
 static void prepbitfield(struct rnndb *db, struct rnnbitfield *bf, char *prefix, struct rnnvarinfo *parvi);
@@ -1164,7 +1287,7 @@ static void preptypeinfo(struct rnndb *db, struct rnntypeinfo *ti, char *prefix,
 				ti->type = RNN_TTYPE_INLINE_ENUM;
 				int j;
 				for (j = 0; j < en->valsnum; j++)
-					ADDARRAY(ti->vals, copyvalue(en->vals[j], file));
+					ADDARRAY(ti->vals, copyvalue(db, en->vals[j], file));
 			} else {
 				ti->type = RNN_TTYPE_ENUM;
 				ti->eenum = en;
@@ -1174,7 +1297,7 @@ static void preptypeinfo(struct rnndb *db, struct rnntypeinfo *ti, char *prefix,
 				ti->type = RNN_TTYPE_INLINE_BITSET;
 				int j;
 				for (j = 0; j < bs->bitfieldsnum; j++)
-					ADDARRAY(ti->bitfields, copybitfield(bs->bitfields[j], file));
+					ADDARRAY(ti->bitfields, copybitfield(db, bs->bitfields[j], file));
 			} else {
 				ti->type = RNN_TTYPE_BITSET;
 				ti->ebitset = bs;
@@ -1231,13 +1354,13 @@ static void preptypeinfo(struct rnndb *db, struct rnntypeinfo *ti, char *prefix,
 }
 
 static void prepbitfield(struct rnndb *db, struct rnnbitfield *bf, char *prefix, struct rnnvarinfo *parvi) {
-	bf->fullname = catstr(prefix, bf->name);
+	bf->fullname = catstr(db, prefix, bf->name);
 	prepvarinfo (db, bf->fullname, &bf->varinfo, parvi);
 	if (bf->varinfo.dead)
 		return;
 	preptypeinfo(db, &bf->typeinfo, bf->fullname, &bf->varinfo, bf->file);
 	if (bf->varinfo.prefix)
-		bf->fullname = catstr(bf->varinfo.prefix, bf->fullname);
+		bf->fullname = catstr(db, bf->varinfo.prefix, bf->fullname);
 }
 
 static void prepdelem(struct rnndb *db, struct rnndelem *elem, char *prefix, struct rnnvarinfo *parvi, int width) {
@@ -1251,7 +1374,7 @@ static void prepdelem(struct rnndb *db, struct rnndelem *elem, char *prefix, str
 			}
 		if (gr) {
 			for (i = 0; i < gr->subelemsnum; i++)
-				ADDARRAY(elem->subelems, copydelem(gr->subelems[i], elem->file));
+				ADDARRAY(elem->subelems, copydelem(db, gr->subelems[i], elem->file));
 		} else {
 			rnn_err(db, "group %s not found!\n", elem->name);
 		}
@@ -1260,7 +1383,7 @@ static void prepdelem(struct rnndb *db, struct rnndelem *elem, char *prefix, str
 		elem->name = 0;
 	}
 	if (elem->name)
-		elem->fullname = catstr(prefix, elem->name);
+		elem->fullname = catstr(db, prefix, elem->name);
 	prepvarinfo (db, elem->fullname?elem->fullname:prefix, &elem->varinfo, parvi);
 	if (elem->varinfo.dead)
 		return;
@@ -1277,7 +1400,7 @@ static void prepdelem(struct rnndb *db, struct rnndelem *elem, char *prefix, str
 	for (i = 0; i < elem->subelemsnum; i++)
 		prepdelem(db,  elem->subelems[i], elem->name?elem->fullname:prefix, &elem->varinfo, width);
 	if (elem->varinfo.prefix && elem->name)
-		elem->fullname = catstr(elem->varinfo.prefix, elem->fullname);
+		elem->fullname = catstr(db, elem->varinfo.prefix, elem->fullname);
 }
 
 static void prepdomain(struct rnndb *db, struct rnndomain *dom) {
@@ -1285,7 +1408,7 @@ static void prepdomain(struct rnndb *db, struct rnndomain *dom) {
 	int i;
 	for (i = 0; i < dom->subelemsnum; i++)
 		prepdelem(db, dom->subelems[i], dom->bare?0:dom->name, &dom->varinfo, dom->width);
-	dom->fullname = catstr(dom->varinfo.prefix, dom->name);
+	dom->fullname = catstr(db, dom->varinfo.prefix, dom->name);
 }
 
 static void prepenum(struct rnndb *db, struct rnnenum *en) {
@@ -1297,7 +1420,7 @@ static void prepenum(struct rnndb *db, struct rnnenum *en) {
 		return;
 	for (i = 0; i < en->valsnum; i++)
 		prepvalue(db, en->vals[i], en->bare?0:en->name, &en->varinfo);
-	en->fullname = catstr(en->varinfo.prefix, en->name);
+	en->fullname = catstr(db, en->varinfo.prefix, en->name);
 	en->prepared = 1;
 }
 
@@ -1308,13 +1431,83 @@ static void prepbitset(struct rnndb *db, struct rnnbitset *bs) {
 		return;
 	for (i = 0; i < bs->bitfieldsnum; i++)
 		prepbitfield(db, bs->bitfields[i], bs->bare?0:bs->name, &bs->varinfo);
-	bs->fullname = catstr(bs->varinfo.prefix, bs->name);
+	bs->fullname = catstr(db, bs->varinfo.prefix, bs->name);
 }
 
 static void prepspectype(struct rnndb *db, struct rnnspectype *st) {
 	preptypeinfo(db, &st->typeinfo, st->name, 0, st->file); // XXX doesn't exactly make sense...
 }
 
+static void trimvarinfo(struct rnnvarinfo *vi) {
+	TRIMARRAY(vi->varsets);
+}
+
+static void trimtypeinfo(struct rnntypeinfo *ti) {
+	int i;
+	TRIMARRAY(ti->bitfields);
+	TRIMARRAY(ti->vals);
+	for (i = 0; i < ti->bitfieldsnum; i++) {
+		trimvarinfo(&ti->bitfields[i]->varinfo);
+		trimtypeinfo(&ti->bitfields[i]->typeinfo);
+	}
+	for (i = 0; i < ti->valsnum; i++)
+		trimvarinfo(&ti->vals[i]->varinfo);
+}
+
+static void trimdelem(struct rnndelem *elem) {
+	int i;
+	TRIMARRAY(elem->offsets);
+	TRIMARRAY(elem->doffsets);
+	TRIMARRAY(elem->subelems);
+	trimvarinfo(&elem->varinfo);
+	trimtypeinfo(&elem->typeinfo);
+	for (i = 0; i < elem->subelemsnum; i++)
+		trimdelem(elem->subelems[i]);
+}
+
+/* the db doesn't grow any further once prepared, so shrink all the arrays
+ * down to size:
+ */
+static void trimdb(struct rnndb *db) {
+	int i, j;
+	for (i = 0; i < db->enumsnum; i++) {
+		struct rnnenum *en = db->enums[i];
+		TRIMARRAY(en->vals);
+		trimvarinfo(&en->varinfo);
+		for (j = 0; j < en->valsnum; j++)
+			trimvarinfo(&en->vals[j]->varinfo);
+	}
+	for (i = 0; i < db->bitsetsnum; i++) {
+		struct rnnbitset *bs = db->bitsets[i];
+		TRIMARRAY(bs->bitfields);
+		trimvarinfo(&bs->varinfo);
+		for (j = 0; j < bs->bitfieldsnum; j++) {
+			trimvarinfo(&bs->bitfields[j]->varinfo);
+			trimtypeinfo(&bs->bitfields[j]->typeinfo);
+		}
+	}
+	for (i = 0; i < db->domainsnum; i++) {
+		struct rnndomain *dom = db->domains[i];
+		TRIMARRAY(dom->subelems);
+		trimvarinfo(&dom->varinfo);
+		for (j = 0; j < dom->subelemsnum; j++)
+			trimdelem(dom->subelems[j]);
+	}
+	for (i = 0; i < db->groupsnum; i++) {
+		struct rnngroup *gr = db->groups[i];
+		TRIMARRAY(gr->subelems);
+		for (j = 0; j < gr->subelemsnum; j++)
+			trimdelem(gr->subelems[j]);
+	}
+	for (i = 0; i < db->spectypesnum; i++)
+		trimtypeinfo(&db->spectypes[i]->typeinfo);
+	TRIMARRAY(db->enums);
+	TRIMARRAY(db->bitsets);
+	TRIMARRAY(db->domains);
+	TRIMARRAY(db->groups);
+	TRIMARRAY(db->spectypes);
+}
+
 void rnn_prepdb (struct rnndb *db) {
 	int i;
 	for (i = 0; i < db->enumsnum; i++)
@@ -1325,6 +1518,7 @@ void rnn_prepdb (struct rnndb *db) {
 		prepdomain(db, db->domains[i]);
 	for (i = 0; i < db->spectypesnum; i++)
 		prepspectype(db, db->spectypes[i]);
+	trimdb(db);
 }
 
 struct rnnenum *rnn_findenum (struct rnndb *db, const char *name) {
@@ -29,6 +29,8 @@
 #include <stdint.h>
 #include <stdlib.h>
 
+struct set;
+
 struct rnnauthor {
 	char* name;
 	char* email;
@@ -68,6 +70,9 @@ struct rnndb {
 	int filesnum;
 	int filesmax;
 	int estatus;
+	int validate;	/* validate files against the schema when parsing */
+	void *mem;	/* linear allocator the db contents live in */
+	struct set *strings;	/* interned strings */
 };
 
 struct rnnvarset {
@@ -79,12 +84,12 @@ struct rnnvarinfo {
 	char *prefixstr;
 	char *varsetstr;
 	char *variantsstr;
-	int dead;
 	struct rnnenum *prefenum;
 	char *prefix;
 	struct rnnvarset **varsets;
 	int varsetsnum;
 	int varsetsmax;
+	int dead;
 };
 
 struct rnnenum {
@@ -127,19 +132,21 @@ struct rnntypeinfo {
 		RNN_TTYPE_UFIXED,
 		RNN_TTYPE_A3XX_REGID,
 	} type;
-	struct rnnenum *eenum;
-	struct rnnbitset *ebitset;
-	struct rnnspectype *spectype;
+	int shr, low, high;
+	union {
+		struct rnnenum *eenum;		/* RNN_TTYPE_ENUM */
+		struct rnnbitset *ebitset;	/* RNN_TTYPE_BITSET */
+		struct rnnspectype *spectype;	/* RNN_TTYPE_SPECTYPE */
+	};
 	struct rnnbitfield **bitfields;
 	int bitfieldsnum;
 	int bitfieldsmax;
 	struct rnnvalue **vals;
 	int valsnum;
 	int valsmax;
-	int shr, low, high;
 	uint64_t min, max, align, radix;
-	int addvariant;
-	int minvalid, maxvalid, alignvalid, radixvalid;
+	unsigned addvariant : 1;
+	unsigned minvalid : 1, maxvalid : 1, alignvalid : 1, radixvalid : 1;
 };
 
 static inline uint64_t typeinfo_mask(struct rnntypeinfo *ti)
@@ -198,13 +205,13 @@ struct rnndelem {
 		RNN_ETYPE_STRIPE,
 		RNN_ETYPE_USE_GROUP,
 	} type;
-	char *name;
-	int width;
 	enum rnnaccess {
 		RNN_ACCESS_R,
 		RNN_ACCESS_W,
 		RNN_ACCESS_RW,
 	} access;
+	int width;
+	char *name;
 	uint64_t offset;
 	uint64_t *offsets;       /* for "array" with irregular offsets */
 	int offsetsnum;
@@ -233,6 +240,7 @@ struct rnnspectype {
 
 void rnn_init(void);
 struct rnndb *rnn_newdb(void);
+void rnn_freedb(struct rnndb *db);
 void rnn_parsefile (struct rnndb *db, char *file);
 void rnn_prepdb (struct rnndb *db);
 struct rnnenum *rnn_findenum (struct rnndb *db, const char *name);
@@ -240,4 +248,9 @@ struct rnnbitset *rnn_findbitset (struct rnndb *db, const char *name);
 struct rnndomain *rnn_finddomain (struct rnndb *db, const char *name);
 struct rnnspectype *rnn_findspectype (struct rnndb *db, const char *name);
 
+/* prepared databases generated at build time by rnndbgen, or NULL if the
+ * file was not built in:
+ */
+struct rnndb *rnn_builtin_db (const char *file);
+
 #endif
@@ -0,0 +1,272 @@
+/*
+ * Copyright © 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Benchmarks for the register database: loading and preparing each
+ * adreno generation, and the rnndec lookups that the decoders spend their
+ * time in.  Prints one line per measurement:
+ *
+ *   <domain> <what> <ops> <msecs> <ops/sec> <heap KiB>
+ *
+ * where heap is the growth in malloc'd memory over the measurement (or
+ * "-" where that can't be determined).  For "load" that is the size of a
+ * single db, not of all the passes.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef HAVE_MALLINFO2
+#include <malloc.h>
+#endif
+
+#include "rnn.h"
+#include "rnndec.h"
+#include "util.h"
+
+static const struct {
+	const char *file;
+	char *domain;
+} gens[] = {
+	{ "adreno/a2xx.xml", "A2XX" },
+	{ "adreno/a3xx.xml", "A3XX" },
+	{ "adreno/a4xx.xml", "A4XX" },
+	{ "adreno/a5xx.xml", "A5XX" },
+	{ "adreno/a6xx.xml", "A6XX" },
+};
+
+static int passes = 3;
+
+struct measurement {
+	struct timespec start;
+	size_t heap;
+};
+
+static size_t heap_used(void) {
+#ifdef HAVE_MALLINFO2
+	return mallinfo2().uordblks;
+#else
+	return 0;
+#endif
+}
+
+static void start(struct measurement *m) {
+	m->heap = heap_used();
+	clock_gettime(CLOCK_MONOTONIC, &m->start);
+}
+
+static void report(struct measurement *m, const char *domain, const char *what, uint64_t ops) {
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	double ms = (end.tv_sec - m->start.tv_sec) * 1000.0 +
+		(end.tv_nsec - m->start.tv_nsec) / 1000000.0;
+	printf("%-6s %-12s %10"PRIu64" %10.2f %14.1f ", domain, what, ops, ms,
+			ms > 0 ? ops * 1000.0 / ms : 0.0);
+#ifdef HAVE_MALLINFO2
+	printf("%10ld\n", ((long)heap_used() - (long)m->heap) / 1024);
+#else
+	printf("%10s\n", "-");
+#endif
+}
+
+/* one past the last address covered by the elements: */
+static uint64_t elems_end(struct rnndelem **elems, int elemsnum) {
+	uint64_t end = 0;
+	int i;
+	for (i = 0; i < elemsnum; i++) {
+		struct rnndelem *elem = elems[i];
+		uint64_t e;
+		if (elem->type == RNN_ETYPE_REG) {
+			e = elem->offset + (elem->length ? elem->length : 1) * (elem->stride ? elem->stride : 1);
+		} else if (elem->offsetsnum) {
+			e = elem->offsets[elem->offsetsnum - 1] +
+				elems_end(elem->subelems, elem->subelemsnum);
+		} else {
+			e = elem->offset + elem->length * elem->stride;
+			if (!elem->length || !elem->stride)
+				e = elem->offset + elems_end(elem->subelems, elem->subelemsnum);
+		}
+		if (e > end)
+			end = e;
+	}
+	return end;
+}
+
+static struct rnndb *load(const char *file) {
+	struct rnndb *db = rnn_newdb();
+	rnn_parsefile(db, (char *)file);
+	rnn_prepdb(db);
+	if (db->estatus) {
+		fprintf(stderr, "failed to load %s\n", file);
+		exit(db->estatus);
+	}
+	return db;
+}
+
+static void bench(const char *file, char *domain) {
+	struct measurement m;
+	struct rnndb *db = NULL;
+	int p, i;
+
+	/* rnn_freedb() only takes empty dbs, so the dbs of the later passes
+	 * leak; keep them out of the heap count:
+	 */
+	start(&m);
+	db = load(file);
+	size_t heap = heap_used();
+	for (p = 1; p < passes; p++)
+		db = load(file);
+	m.heap += heap_used() - heap;
+	report(&m, domain, "load", passes);
+
+	struct rnndomain *dom = rnn_finddomain(db, domain);
+	if (!dom) {
+		fprintf(stderr, "no domain %s in %s\n", domain, file);
+		exit(1);
+	}
+
+	struct rnndeccontext *ctx = rnndec_newcontext(db);
+	ctx->colors = &envy_null_colors;
+	rnndec_varadd(ctx, "chip", domain);
+
+	/* the registers which decode, and their names and types: */
+	uint64_t end = elems_end(dom->subelems, dom->subelemsnum);
+	char **names = calloc(end, sizeof(names[0]));
+	struct rnntypeinfo **types = calloc(end, sizeof(types[0]));
+	int regsnum = 0;
+
+	start(&m);
+	for (p = 0; p < passes; p++) {
+		uint64_t addr;
+		for (addr = 0; addr < end; addr++) {
+			struct rnndecaddrinfo *info = rnndec_decodeaddr(ctx, dom, addr, 0);
+			if (p == 0 && info->typeinfo) {
+				names[regsnum] = info->name;
+				types[regsnum] = info->typeinfo;
+				regsnum++;
+			} else {
+				free(info->name);
+			}
+			free(info);
+		}
+	}
+	report(&m, domain, "decodeaddr", passes * end);
+
+	start(&m);
+	for (p = 0; p < passes; p++) {
+		uint64_t addr;
+		for (addr = 0; addr < end; addr++)
+			rnndec_regname(ctx, dom, addr, 0);
+	}
+	report(&m, domain, "regname", passes * end);
+
+	/* note that the names made up for the upper half of 64b registers
+	 * (FOO+0x1, or FOO_HI) don't decode back to an address, but those
+	 * are looked up as much as any other:
+	 */
+	start(&m);
+	for (p = 0; p < passes; p++)
+		for (i = 0; i < regsnum; i++)
+			rnndec_decodereg(ctx, dom, names[i]);
+	report(&m, domain, "decodereg", passes * regsnum);
+
+	srand(0);
+	start(&m);
+	for (p = 0; p < passes; p++) {
+		for (i = 0; i < regsnum; i++) {
+			uint64_t val = ((uint64_t)rand() << 32) ^ rand();
+			free(rnndec_decodeval(ctx, types[i], val));
+		}
+	}
+	report(&m, domain, "decodeval", passes * regsnum);
+
+	/* values of every enum, plus some which are not: */
+	uint64_t ops = 0;
+	start(&m);
+	for (p = 0; p < passes; p++) {
+		for (i = 0; i < db->enumsnum; i++) {
+			struct rnnenum *en = db->enums[i];
+			int j;
+			if (en->isinline)
+				continue;
+			for (j = 0; j < en->valsnum; j++) {
+				rnndec_decode_enum(ctx, en->name, en->vals[j]->value);
+				rnndec_decode_enum(ctx, en->name, rand());
+				ops += 2;
+			}
+		}
+	}
+	report(&m, domain, "decode_enum", ops);
+
+	for (i = 0; i < regsnum; i++)
+		free(names[i]);
+	free(names);
+	free(types);
+}
+
+static void usage(void) {
+	fprintf(stderr, "Usage:\n\n"
+			"\trnnbench [OPTIONS] [DOMAIN...]\n\n"
+			"Options:\n"
+			"\t-n, --passes=N  - repeat each measurement N times (default 3)\n"
+			"\t-h, --help      - show this message\n\n"
+			"Benchmarks all adreno generations, unless DOMAIN (ie. A6XX) is given.\n");
+	exit(2);
+}
+
+static const struct option opts[] = {
+	{ "passes", required_argument, 0, 'n' },
+	{ "help",   no_argument,       0, 'h' },
+	{ 0, 0, 0, 0 }
+};
+
+int main(int argc, char **argv) {
+	int c, i;
+
+	while ((c = getopt_long(argc, argv, "n:h", opts, NULL)) != -1) {
+		switch (c) {
+		case 'n':
+			passes = atoi(optarg);
+			if (passes < 1)
+				usage();
+			break;
+		default:
+			usage();
+		}
+	}
+
+	rnn_init();
+
+	printf("%-6s %-12s %10s %10s %14s %10s\n", "domain", "what", "ops", "msecs", "ops/sec", "heap KiB");
+	for (i = 0; i < ARRAY_SIZE(gens); i++) {
+		int j, match = optind == argc;
+		for (j = optind; j < argc; j++)
+			if (!strcasecmp(argv[j], gens[i].domain))
+				match = 1;
+		if (match)
+			bench(gens[i].file, gens[i].domain);
+	}
+
+	return 0;
+}
@@ -0,0 +1,505 @@
+/*
+ * Copyright © 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Generates C source for prepared (ie. after rnn_prepdb()) databases,
+ * as static const data, so that the decoders do not need to parse the
+ * xml at runtime.  See rnn_builtin_db().
+ */
+
+#include "rnn.h"
+#include "util.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <ctype.h>
+#include <string.h>
+
+#include "util/hash_table.h"
+
+static FILE *decls, *defs;
+static struct hash_table *names;    /* object -> C identifier */
+static struct hash_table *varsets;  /* varset contents -> C identifier */
+static char *prefix;                /* identifier prefix for current db */
+static const char *pathprefix;      /* path stripped from file names */
+static unsigned nextid;
+
+/* file names are relative to the search path at runtime: */
+static const char *relpath(const char *file) {
+	if (file && !strncmp(file, pathprefix, strlen(pathprefix)))
+		return file + strlen(pathprefix);
+	return file;
+}
+
+typedef void (*emit_fn)(FILE *pre, FILE *body, const void *obj);
+
+static void printstr(FILE *f, const char *field, const char *str) {
+	if (!str)
+		return;
+	fprintf(f, "\t.%s = (char *)\"", field);
+	for (; *str; str++) {
+		unsigned char c = *str;
+		if ((c == '"') || (c == '\\'))
+			fprintf(f, "\\%c", c);
+		else if (isprint(c))
+			fputc(c, f);
+		else
+			fprintf(f, "\\%03o", c);
+	}
+	fprintf(f, "\",\n");
+}
+
+static void printint(FILE *f, const char *field, int64_t val) {
+	if (val)
+		fprintf(f, "\t.%s = %"PRId64",\n", field, val);
+}
+
+static void printu64(FILE *f, const char *field, uint64_t val) {
+	if (val)
+		fprintf(f, "\t.%s = 0x%"PRIx64"ull,\n", field, val);
+}
+
+static char *newname(const char *suffix) {
+	char *name;
+	asprintf(&name, "%s_%u%s", prefix, nextid++, suffix);
+	return name;
+}
+
+/* Returns the identifier of the object, emitting it first if needed.  The
+ * object definition is emitted to 'defs' only after any objects it refers
+ * to, so that it is not interleaved with their definitions.
+ */
+static const char *ref(const void *obj, const char *type, emit_fn emit) {
+	struct hash_entry *entry = _mesa_hash_table_search(names, obj);
+	char *pre, *body;
+	size_t presz, bodysz;
+	FILE *fpre, *fbody;
+	char *name;
+
+	if (entry)
+		return entry->data;
+
+	name = newname("");
+	_mesa_hash_table_insert(names, obj, name);
+
+	fprintf(decls, "static const struct %s %s;\n", type, name);
+
+	fpre = open_memstream(&pre, &presz);
+	fbody = open_memstream(&body, &bodysz);
+
+	fprintf(fbody, "static const struct %s %s = {\n", type, name);
+	emit(fpre, fbody, obj);
+	fprintf(fbody, "};\n\n");
+
+	fclose(fpre);
+	fclose(fbody);
+
+	fputs(pre, defs);
+	fputs(body, defs);
+
+	free(pre);
+	free(body);
+
+	return name;
+}
+
+static void printref(FILE *f, const char *field, const char *type, const void *obj, emit_fn emit) {
+	if (!obj)
+		return;
+	const char *name = ref(obj, type, emit);
+	fprintf(f, "\t.%s = (struct %s *)&%s,\n", field, type, name);
+}
+
+/* Emit an array of pointers to objects, and the corresponding num/max
+ * fields:
+ */
+static void printarray(FILE *pre, FILE *f, const char *field, const char *type,
+		void *const *objs, int num, emit_fn emit) {
+	const char **elems;
+	char *name;
+	int i;
+
+	if (!num)
+		return;
+
+	elems = calloc(num, sizeof(elems[0]));
+	for (i = 0; i < num; i++)
+		elems[i] = ref(objs[i], type, emit);
+
+	name = newname("");
+	fprintf(pre, "static struct %s *const %s[] = {\n", type, name);
+	for (i = 0; i < num; i++)
+		fprintf(pre, "\t(struct %s *)&%s,\n", type, elems[i]);
+	fprintf(pre, "};\n\n");
+
+	fprintf(f, "\t.%s = (struct %s **)%s,\n", field, type, name);
+	fprintf(f, "\t.%snum = %d,\n", field, num);
+	fprintf(f, "\t.%smax = %d,\n", field, num);
+
+	free(elems);
+	free(name);
+}
+
+static void emit_enum(FILE *pre, FILE *f, const void *obj);
+static void emit_bitset(FILE *pre, FILE *f, const void *obj);
+static void emit_spectype(FILE *pre, FILE *f, const void *obj);
+
+/* varsets are copied for each object that inherits them, so de-duplicate
+ * them by contents:
+ */
+static const char *refvarset(const struct rnnvarset *vs) {
+	const char *venum = ref(vs->venum, "rnnenum", emit_enum);
+	struct hash_entry *entry;
+	char *key, *name;
+	size_t keysz;
+	FILE *f;
+	int i;
+
+	f = open_memstream(&key, &keysz);
+	fprintf(f, "%s:", venum);
+	for (i = 0; i < vs->venum->valsnum; i++)
+		fprintf(f, "%d,", vs->variants[i]);
+	fclose(f);
+
+	entry = _mesa_hash_table_search(varsets, key);
+	if (entry) {
+		free(key);
+		return entry->data;
+	}
+
+	name = newname("");
+	_mesa_hash_table_insert(varsets, key, name);
+
+	fprintf(defs, "static const int %s_variants[] = {", name);
+	for (i = 0; i < vs->venum->valsnum; i++)
+		fprintf(defs, " %d,", vs->variants[i]);
+	fprintf(defs, " };\n\n");
+
+	fprintf(defs, "static const struct rnnvarset %s = {\n", name);
+	fprintf(defs, "\t.venum = (struct rnnenum *)&%s,\n", venum);
+	fprintf(defs, "\t.variants = (int *)%s_variants,\n", name);
+	fprintf(defs, "};\n\n");
+
+	return name;
+}
+
+static void printvarinfo(FILE *pre, FILE *f, const struct rnnvarinfo *vi) {
+	const char **elems;
+	char *name;
+	int i;
+
+	fprintf(f, ".varinfo = {\n");
+	printstr(f, "prefixstr", vi->prefixstr);
+	printstr(f, "varsetstr", vi->varsetstr);
+	printstr(f, "variantsstr", vi->variantsstr);
+	printint(f, "dead", vi->dead);
+	printref(f, "prefenum", "rnnenum", vi->prefenum, emit_enum);
+	printstr(f, "prefix", vi->prefix);
+
+	if (vi->varsetsnum) {
+		elems = calloc(vi->varsetsnum, sizeof(elems[0]));
+		for (i = 0; i < vi->varsetsnum; i++)
+			elems[i] = refvarset(vi->varsets[i]);
+
+		name = newname("");
+		fprintf(pre, "static struct rnnvarset *const %s[] = {\n", name);
+		for (i = 0; i < vi->varsetsnum; i++)
+			fprintf(pre, "\t(struct rnnvarset *)&%s,\n", elems[i]);
+		fprintf(pre, "};\n\n");
+
+		fprintf(f, "\t.varsets = (struct rnnvarset **)%s,\n", name);
+		fprintf(f, "\t.varsetsnum = %d,\n", vi->varsetsnum);
+		fprintf(f, "\t.varsetsmax = %d,\n", vi->varsetsnum);
+
+		free(elems);
+		free(name);
+	}
+
+	fprintf(f, "},\n");
+}
+
+static void emit_value(FILE *pre, FILE *f, const void *obj) {
+	const struct rnnvalue *val = obj;
+
+	printstr(f, "name", val->name);
+	printint(f, "valvalid", val->valvalid);
+	printu64(f, "value", val->value);
+	printvarinfo(pre, f, &val->varinfo);
+	printstr(f, "fullname", val->fullname);
+	printstr(f, "file", relpath(val->file));
+}
+
+static void emit_bitfield(FILE *pre, FILE *f, const void *obj);
+
+static void printtypeinfo(FILE *pre, FILE *f, const struct rnntypeinfo *ti) {
+	fprintf(f, ".typeinfo = {\n");
+	printstr(f, "name", ti->name);
+	printint(f, "type", ti->type);
+	if (ti->type == RNN_TTYPE_ENUM)
+		printref(f, "eenum", "rnnenum", ti->eenum, emit_enum);
+	else if (ti->type == RNN_TTYPE_BITSET)
+		printref(f, "ebitset", "rnnbitset", ti->ebitset, emit_bitset);
+	else if (ti->type == RNN_TTYPE_SPECTYPE)
+		printref(f, "spectype", "rnnspectype", ti->spectype, emit_spectype);
+	printarray(pre, f, "bitfields", "rnnbitfield", (void *const *)ti->bitfields,
+			ti->bitfieldsnum, emit_bitfield);
+	printarray(pre, f, "vals", "rnnvalue", (void *const *)ti->vals,
+			ti->valsnum, emit_value);
+	printint(f, "shr", ti->shr);
+	printint(f, "low", ti->low);
+	printint(f, "high", ti->high);
+	printu64(f, "min", ti->min);
+	printu64(f, "max", ti->max);
+	printu64(f, "align", ti->align);
+	printu64(f, "radix", ti->radix);
+	printint(f, "addvariant", ti->addvariant);
+	printint(f, "minvalid", ti->minvalid);
+	printint(f, "maxvalid", ti->maxvalid);
+	printint(f, "alignvalid", ti->alignvalid);
+	printint(f, "radixvalid", ti->radixvalid);
+	fprintf(f, "},\n");
+}
+
+static void emit_enum(FILE *pre, FILE *f, const void *obj) {
+	const struct rnnenum *en = obj;
+
+	printstr(f, "name", en->name);
+	printint(f, "bare", en->bare);
+	printint(f, "isinline", en->isinline);
+	printvarinfo(pre, f, &en->varinfo);
+	printarray(pre, f, "vals", "rnnvalue", (void *const *)en->vals,
+			en->valsnum, emit_value);
+	printstr(f, "fullname", en->fullname);
+	printint(f, "prepared", en->prepared);
+	printstr(f, "file", relpath(en->file));
+}
+
+static void emit_bitfield(FILE *pre, FILE *f, const void *obj) {
+	const struct rnnbitfield *bf = obj;
+
+	printstr(f, "name", bf->name);
+	printvarinfo(pre, f, &bf->varinfo);
+	printtypeinfo(pre, f, &bf->typeinfo);
+	printstr(f, "fullname", bf->fullname);
+	printstr(f, "file", relpath(bf->file));
+}
+
+static void emit_bitset(FILE *pre, FILE *f, const void *obj) {
+	const struct rnnbitset *bs = obj;
+
+	printstr(f, "name", bs->name);
+	printint(f, "bare", bs->bare);
+	printint(f, "isinline", bs->isinline);
+	printvarinfo(pre, f, &bs->varinfo);
+	printarray(pre, f, "bitfields", "rnnbitfield", (void *const *)bs->bitfields,
+			bs->bitfieldsnum, emit_bitfield);
+	printstr(f, "fullname", bs->fullname);
+	printstr(f, "file", relpath(bs->file));
+}
+
+static void emit_spectype(FILE *pre, FILE *f, const void *obj) {
+	const struct rnnspectype *st = obj;
+
+	printstr(f, "name", st->name);
+	printtypeinfo(pre, f, &st->typeinfo);
+	printstr(f, "file", relpath(st->file));
+}
+
+static void emit_delem(FILE *pre, FILE *f, const void *obj) {
+	const struct rnndelem *elem = obj;
+	char *name;
+	int i;
+
+	printint(f, "type", elem->type);
+	printstr(f, "name", elem->name);
+	printint(f, "width", elem->width);
+	printint(f, "access", elem->access);
+	printu64(f, "offset", elem->offset);
+	if (elem->offsetsnum) {
+		name = newname("_offsets");
+		fprintf(pre, "static const uint64_t %s[] = {", name);
+		for (i = 0; i < elem->offsetsnum; i++)
+			fprintf(pre, " 0x%"PRIx64"ull,", elem->offsets[i]);
+		fprintf(pre, " };\n\n");
+		fprintf(f, "\t.offsets = (uint64_t *)%s,\n", name);
+		fprintf(f, "\t.offsetsnum = %d,\n", elem->offsetsnum);
+		fprintf(f, "\t.offsetsmax = %d,\n", elem->offsetsnum);
+		free(name);
+	}
+	printstr(f, "doffset", elem->doffset);
+	if (elem->doffsetsnum) {
+		name = newname("_doffsets");
+		fprintf(pre, "static char *const %s[] = {\n", name);
+		for (i = 0; i < elem->doffsetsnum; i++)
+			fprintf(pre, "\t(char *)\"%s\",\n", elem->doffsets[i]);
+		fprintf(pre, "};\n\n");
+		fprintf(f, "\t.doffsets = (char **)%s,\n", name);
+		fprintf(f, "\t.doffsetsnum = %d,\n", elem->doffsetsnum);
+		fprintf(f, "\t.doffsetsmax = %d,\n", elem->doffsetsnum);
+		free(name);
+	}
+	printu64(f, "length", elem->length);
+	printu64(f, "stride", elem->stride);
+	printarray(pre, f, "subelems", "rnndelem", (void *const *)elem->subelems,
+			elem->subelemsnum, emit_delem);
+	printvarinfo(pre, f, &elem->varinfo);
+	printtypeinfo(pre, f, &elem->typeinfo);
+	printref(f, "index", "rnnenum", elem->index, emit_enum);
+	printstr(f, "fullname", elem->fullname);
+	printstr(f, "file", relpath(elem->file));
+}
+
+static void emit_domain(FILE *pre, FILE *f, const void *obj) {
+	const struct rnndomain *dom = obj;
+
+	printstr(f, "name", dom->name);
+	printint(f, "bare", dom->bare);
+	printint(f, "width", dom->width);
+	printu64(f, "size", dom->size);
+	printint(f, "sizevalid", dom->sizevalid);
+	printvarinfo(pre, f, &dom->varinfo);
+	printarray(pre, f, "subelems", "rnndelem", (void *const *)dom->subelems,
+			dom->subelemsnum, emit_delem);
+	printstr(f, "fullname", dom->fullname);
+	printstr(f, "file", relpath(dom->file));
+}
+
+static void emit_group(FILE *pre, FILE *f, const void *obj) {
+	const struct rnngroup *group = obj;
+
+	printstr(f, "name", group->name);
+	printarray(pre, f, "subelems", "rnndelem", (void *const *)group->subelems,
+			group->subelemsnum, emit_delem);
+}
+
+static void emit_db(FILE *pre, FILE *f, const void *obj) {
+	const struct rnndb *db = obj;
+	char *name;
+	int i;
+
+	printarray(pre, f, "enums", "rnnenum", (void *const *)db->enums,
+			db->enumsnum, emit_enum);
+	printarray(pre, f, "bitsets", "rnnbitset", (void *const *)db->bitsets,
+			db->bitsetsnum, emit_bitset);
+	printarray(pre, f, "domains", "rnndomain", (void *const *)db->domains,
+			db->domainsnum, emit_domain);
+	printarray(pre, f, "groups", "rnngroup", (void *const *)db->groups,
+			db->groupsnum, emit_group);
+	printarray(pre, f, "spectypes", "rnnspectype", (void *const *)db->spectypes,
+			db->spectypesnum, emit_spectype);
+
+	name = newname("_files");
+	fprintf(pre, "static char *const %s[] = {\n", name);
+	for (i = 0; i < db->filesnum; i++) {
+		fprintf(pre, "\t(char *)\"%s\",\n", relpath(db->files[i]));
+	}
+	fprintf(pre, "};\n\n");
+	fprintf(f, "\t.files = (char **)%s,\n", name);
+	fprintf(f, "\t.filesnum = %d,\n", db->filesnum);
+	fprintf(f, "\t.filesmax = %d,\n", db->filesnum);
+	free(name);
+}
+
+int main(int argc, char **argv) {
+	const char **dbnames;
+	FILE *out;
+	int i;
+
+	if (argc < 3) {
+		fprintf(stderr, "Usage:\n\trnndbgen output.c database-file...\n");
+		exit(1);
+	}
+
+	out = fopen(argv[1], "w");
+	if (!out) {
+		perror(argv[1]);
+		exit(1);
+	}
+
+	char *declsbuf, *defsbuf;
+	size_t declssz, defssz;
+	decls = open_memstream(&declsbuf, &declssz);
+	defs = open_memstream(&defsbuf, &defssz);
+
+	dbnames = calloc(argc, sizeof(dbnames[0]));
+
+	rnn_init();
+
+	for (i = 2; i < argc; i++) {
+		char *file = argv[i];
+		struct rnndb *db = rnn_newdb();
+		char *p;
+
+		db->validate = 1;
+		rnn_parsefile(db, file);
+		rnn_prepdb(db);
+		if (db->estatus)
+			return db->estatus;
+
+		/* strip the search path from file names: */
+		pathprefix = strdup(db->files[0]);
+		((char *)pathprefix)[strlen(db->files[0]) - strlen(file)] = '\0';
+
+		prefix = strdup(file);
+		for (p = prefix; *p; p++)
+			if (!isalnum(*p))
+				*p = '_';
+
+		names = _mesa_hash_table_create(NULL, _mesa_hash_pointer,
+				_mesa_key_pointer_equal);
+		varsets = _mesa_hash_table_create(NULL, _mesa_hash_string,
+				_mesa_key_string_equal);
+		nextid = 0;
+
+		dbnames[i] = ref(db, "rnndb", emit_db);
+	}
+
+	fclose(decls);
+	fclose(defs);
+
+	fprintf(out, "/* generated by rnndbgen, do not edit */\n\n");
+	fprintf(out, "#include <string.h>\n");
+	fprintf(out, "#include \"rnn.h\"\n\n");
+	fputs(declsbuf, out);
+	fprintf(out, "\n");
+	fputs(defsbuf, out);
+
+	fprintf(out, "static const struct {\n");
+	fprintf(out, "\tconst char *file;\n");
+	fprintf(out, "\tconst struct rnndb *db;\n");
+	fprintf(out, "} builtin_dbs[] = {\n");
+	for (i = 2; i < argc; i++)
+		fprintf(out, "\t{ \"%s\", &%s },\n", argv[i], dbnames[i]);
+	fprintf(out, "};\n\n");
+
+	fprintf(out, "struct rnndb *rnn_builtin_db(const char *file) {\n");
+	fprintf(out, "\tfor (unsigned i = 0; i < sizeof(builtin_dbs) / sizeof(builtin_dbs[0]); i++)\n");
+	fprintf(out, "\t\tif (!strcmp(builtin_dbs[i].file, file))\n");
+	fprintf(out, "\t\t\treturn (struct rnndb *)builtin_dbs[i].db;\n");
+	fprintf(out, "\treturn NULL;\n");
+	fprintf(out, "}\n");
+
+	fclose(out);
+
+	return 0;
+}
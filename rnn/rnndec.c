@@ -31,6 +31,9 @@
 #include <inttypes.h>
 #include "util.h"
 #include "util/compiler.h"
+#include "util/bitset.h"
+#include "util/hash_table.h"
+#include "util/set.h"
 
 struct rnndeccontext *rnndec_newcontext(struct rnndb *db) {
 	struct rnndeccontext *res = calloc (sizeof *res, 1);
@@ -39,6 +42,11 @@ struct rnndeccontext *rnndec_newcontext(struct rnndb *db) {
 	return res;
 }
 
+/* Selects the variant of varset to decode with.  Adding a variant of a
+ * varset that already has one replaces it, ie. the last one added wins,
+ * which is what addvariant fields (the variant changes from one packet to
+ * the next) rely on.
+ */
 int rnndec_varadd(struct rnndeccontext *ctx, char *varset, const char *variant) {
 	struct rnnenum *en = rnn_findenum(ctx->db, varset);
 	if (!en) {
@@ -47,13 +55,8 @@ int rnndec_varadd(struct rnndeccontext *ctx, char *varset, const char *variant)
 	}
 	int i, j;
 	for (i = 0; i < en->valsnum; i++)
-		if (!strcasecmp(en->vals[i]->name, variant)) {
-			struct rnndecvariant *ci = calloc (sizeof *ci, 1);
-			ci->en = en;
-			ci->variant = i;
-			ADDARRAY(ctx->vars, ci);
-			return 1;
-		}
+		if (!strcasecmp(en->vals[i]->name, variant))
+			break;
 
 	if (i == en->valsnum) {
 		fprintf (stderr, "Variant %s doesn't exist in enum %s!\n", variant, varset);
@@ -61,19 +64,24 @@ int rnndec_varadd(struct rnndeccontext *ctx, char *varset, const char *variant)
 	}
 
 	for (j = 0; j < ctx->varsnum; j++) {
-		if (ctx->vars[j]->en == en) {
-			ctx->vars[j]->variant = i;
+		if (ctx->vars[j]->en == en)
 			break;
-		}
 	}
 
-	if (i == ctx->varsnum) {
+	if (j == ctx->varsnum) {
 		struct rnndecvariant *ci = calloc (sizeof *ci, 1);
 		ci->en = en;
 		ci->variant = i;
 		ADDARRAY(ctx->vars, ci);
+	} else if (ctx->vars[j]->variant != i) {
+		ctx->vars[j]->variant = i;
+	} else {
+		/* same variant as before, the caches are still valid: */
+		return 1;
 	}
 
+	ctx->vargen++;
+
 	return 1;
 }
 
@@ -127,20 +135,154 @@ static float float16(uint16_t val)
 	return u.f;
 }
 
+/*
+ * Enum values are decoded for every packet and most register fields, so
+ * rather than scanning the values each time, the values matching the
+ * current variant are collected into a table which is directly indexed
+ * if the values are dense, or otherwise binary searched.  The tables are
+ * rebuilt if the variant changes.
+ */
+
+struct rnndecenumval {
+	uint64_t value;
+	const char *name;
+	int idx;
+};
+
+struct rnndecenumvals {
+	unsigned vargen;
+	uint64_t min;
+	/* dense table, indexed by value - min: */
+	const char **names;
+	uint64_t namesnum;
+	/* or sorted table: */
+	struct rnndecenumval *sorted;
+	int sortednum;
+};
+
+static int cmp_enumval(const void *a, const void *b) {
+	const struct rnndecenumval *va = a, *vb = b;
+	if (va->value != vb->value)
+		return (va->value < vb->value) ? -1 : 1;
+	return va->idx - vb->idx;
+}
+
+static void build_enumvals(struct rnndeccontext *ctx, struct rnndecenumvals *ev,
+		struct rnnvalue **vals, int valsnum)
+{
+	struct rnndecenumval *sorted = calloc(valsnum, sizeof(*sorted));
+	uint64_t min = ~0ull, max = 0;
+	int i, num = 0;
+
+	for (i = 0; i < valsnum; i++) {
+		if (!vals[i]->valvalid || !rnndec_varmatch(ctx, &vals[i]->varinfo))
+			continue;
+		sorted[num].value = vals[i]->value;
+		sorted[num].name = vals[i]->name;
+		sorted[num].idx = i;
+		if (vals[i]->value < min)
+			min = vals[i]->value;
+		if (vals[i]->value > max)
+			max = vals[i]->value;
+		num++;
+	}
+
+	free(ev->names);
+	free(ev->sorted);
+	memset(ev, 0, sizeof(*ev));
+	ev->vargen = ctx->vargen;
+
+	if (!num) {
+		free(sorted);
+		return;
+	}
+
+	if ((max - min) < (4 * (uint64_t)num + 16)) {
+		ev->min = min;
+		ev->namesnum = max - min + 1;
+		ev->names = calloc(ev->namesnum, sizeof(ev->names[0]));
+		/* in case of duplicates, the first matching value wins: */
+		for (i = num - 1; i >= 0; i--)
+			ev->names[sorted[i].value - min] = sorted[i].name;
+		free(sorted);
+	} else {
+		int j = 0;
+		qsort(sorted, num, sizeof(*sorted), cmp_enumval);
+		for (i = 0; i < num; i++)
+			if (!j || (sorted[i].value != sorted[j - 1].value))
+				sorted[j++] = sorted[i];
+		ev->sorted = sorted;
+		ev->sortednum = j;
+	}
+}
+
 static const char *rnndec_decode_enum_val(struct rnndeccontext *ctx,
 		struct rnnvalue **vals, int valsnum, uint64_t value)
 {
-	int i;
-	for (i = 0; i < valsnum; i++)
-		if (rnndec_varmatch(ctx, &vals[i]->varinfo) &&
-				vals[i]->valvalid && vals[i]->value == value)
-			return vals[i]->name;
+	struct rnndecenumvals *ev;
+	struct hash_entry *entry;
+
+	if (!valsnum)
+		return NULL;
+
+	if (!ctx->enumvals)
+		ctx->enumvals = _mesa_hash_table_create(NULL, _mesa_hash_pointer,
+				_mesa_key_pointer_equal);
+
+	entry = _mesa_hash_table_search(ctx->enumvals, vals);
+	if (entry) {
+		ev = entry->data;
+		if (ev->vargen != ctx->vargen)
+			build_enumvals(ctx, ev, vals, valsnum);
+	} else {
+		ev = calloc(1, sizeof(*ev));
+		build_enumvals(ctx, ev, vals, valsnum);
+		_mesa_hash_table_insert(ctx->enumvals, vals, ev);
+	}
+
+	if (ev->names) {
+		if ((value < ev->min) || ((value - ev->min) >= ev->namesnum))
+			return NULL;
+		return ev->names[value - ev->min];
+	}
+
+	int lo = 0, hi = ev->sortednum;
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (ev->sorted[mid].value == value)
+			return ev->sorted[mid].name;
+		if (ev->sorted[mid].value < value)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
 	return NULL;
 }
 
+static struct rnnenum *findenum(struct rnndeccontext *ctx, const char *name)
+{
+	struct hash_entry *entry;
+	struct rnnenum *en;
+
+	if (!ctx->enums)
+		ctx->enums = _mesa_hash_table_create(NULL, _mesa_hash_string,
+				_mesa_key_string_equal);
+
+	entry = _mesa_hash_table_search(ctx->enums, name);
+	if (entry)
+		return entry->data;
+
+	en = rnn_findenum(ctx->db, name);
+	if (en)
+		_mesa_hash_table_insert(ctx->enums, en->name, en);
+
+	return en;
+}
+
 const char *rnndec_decode_enum(struct rnndeccontext *ctx, const char *enumname, uint64_t enumval)
 {
-	struct rnnenum *en = rnn_findenum (ctx->db, enumname);
+	struct rnnenum *en = findenum(ctx, enumname);
 	if (en) {
 		return rnndec_decode_enum_val(ctx, en->vals, en->valsnum, enumval);
 	}
@@ -468,17 +610,331 @@ static struct rnndecaddrinfo *trymatch (struct rnndeccontext *ctx, struct rnndel
 	return 0;
 }
 
-int rnndec_checkaddr(struct rnndeccontext *ctx, struct rnndomain *domain, uint64_t addr, int write) {
-	struct rnndecaddrinfo *res = trymatch(ctx, domain->subelems, domain->subelemsnum, addr, write, domain->width, 0, 0);
+/*
+ * Rather than trying every element of the domain in turn, the address
+ * space of the domain is split into segments, each with the (usually
+ * one) list of top-level elements that could possibly contain an
+ * address in the segment.  So finding the element is a binary search,
+ * after which trymatch() only has to do the arithmetic for the
+ * candidate elements.  Since which elements exist depends on the
+ * variant, the index is built per context, and rebuilt if the variant
+ * changes.
+ */
+
+struct rnndecdomainindex {
+	unsigned vargen;
+	uint64_t *starts;    /* start address of each segment */
+	int *first;          /* index of each segment's first candidate */
+	int *cands;          /* candidate element indices, in domain order */
+	int segnum;
+};
+
+struct rnndecinterval {
+	uint64_t start, end;
+	int idx;
+};
+
+#define ADDR_UNBOUNDED (~(uint64_t)0)
+
+/* The (exclusive) end of the address range that trymatch() could match
+ * for the element, relative to the parent:
+ */
+static uint64_t elem_end(struct rnndelem *elem, int dwidth)
+{
+	uint64_t end = 0;
+	int i;
+
+	switch (elem->type) {
+	case RNN_ETYPE_REG:
+		if (!(elem->width / dwidth))
+			return elem->offset;
+		if (!elem->stride)
+			return elem->offset + elem->width / dwidth;
+		if (!elem->length)
+			return ADDR_UNBOUNDED;
+		return elem->offset + elem->stride * (elem->length - 1) + elem->width / dwidth;
+	case RNN_ETYPE_ARRAY:
+		if (elem->offsets) {
+			for (i = 0; i < elem->offsetsnum; i++)
+				if (elem->offsets[i] + elem->stride > end)
+					end = elem->offsets[i] + elem->stride;
+			return end;
+		}
+		if (!elem->length)
+			return ADDR_UNBOUNDED;
+		return elem->offset + elem->stride * elem->length;
+	case RNN_ETYPE_STRIPE:
+		for (i = 0; i < elem->subelemsnum; i++) {
+			uint64_t subend = elem_end(elem->subelems[i], dwidth);
+			if (subend > end)
+				end = subend;
+		}
+		if (!elem->length || (end == ADDR_UNBOUNDED))
+			return ADDR_UNBOUNDED;
+		return elem->offset + elem->stride * (elem->length - 1) + end;
+	default:
+		return elem->offset;
+	}
+}
+
+static uint64_t elem_start(struct rnndelem *elem)
+{
+	uint64_t start = elem->offset;
+	int i;
+
+	if ((elem->type == RNN_ETYPE_ARRAY) && elem->offsets)
+		for (i = 0; i < elem->offsetsnum; i++)
+			if (elem->offsets[i] < start)
+				start = elem->offsets[i];
+
+	return start;
+}
+
+static int cmp_u64(const void *a, const void *b) {
+	uint64_t va = *(const uint64_t *)a, vb = *(const uint64_t *)b;
+	return (va < vb) ? -1 : (va > vb);
+}
+
+static int cmp_start(const void *a, const void *b) {
+	const struct rnndecinterval *ia = a, *ib = b;
+	return cmp_u64(&ia->start, &ib->start);
+}
+
+static int cmp_end(const void *a, const void *b) {
+	const struct rnndecinterval *ia = a, *ib = b;
+	return cmp_u64(&ia->end, &ib->end);
+}
+
+static void build_domainindex(struct rnndeccontext *ctx, struct rnndecdomainindex *di,
+		struct rnndomain *domain)
+{
+	int n = domain->subelemsnum;
+	struct rnndecinterval *bystart = calloc(n + 1, sizeof(*bystart));
+	struct rnndecinterval *byend = calloc(n + 1, sizeof(*byend));
+	uint64_t *starts = calloc(2 * n + 1, sizeof(*starts));
+	BITSET_WORD *active = calloc(BITSET_WORDS(n + 1), sizeof(BITSET_WORD));
+	int i, num = 0, segnum = 0, candsnum = 0, candsmax = 0;
+
+	free(di->starts);
+	free(di->first);
+	free(di->cands);
+	memset(di, 0, sizeof(*di));
+	di->vargen = ctx->vargen;
+
+	for (i = 0; i < n; i++) {
+		struct rnndelem *elem = domain->subelems[i];
+		if (!rnndec_varmatch(ctx, &elem->varinfo))
+			continue;
+		uint64_t start = elem_start(elem);
+		uint64_t end = elem_end(elem, domain->width);
+		if (end <= start)
+			continue;
+		bystart[num].start = start;
+		bystart[num].end = end;
+		bystart[num].idx = i;
+		num++;
+	}
+
+	/* segment boundaries are every start and (bounded) end address: */
+	for (i = 0; i < num; i++) {
+		starts[segnum++] = bystart[i].start;
+		if (bystart[i].end != ADDR_UNBOUNDED)
+			starts[segnum++] = bystart[i].end;
+	}
+	qsort(starts, segnum, sizeof(starts[0]), cmp_u64);
+	int j = 0;
+	for (i = 0; i < segnum; i++)
+		if (!j || (starts[i] != starts[j - 1]))
+			starts[j++] = starts[i];
+	segnum = j;
+
+	memcpy(byend, bystart, num * sizeof(*byend));
+	qsort(bystart, num, sizeof(*bystart), cmp_start);
+	qsort(byend, num, sizeof(*byend), cmp_end);
+
+	/* sweep over the segments, tracking which elements are active: */
+	di->first = calloc(segnum + 1, sizeof(di->first[0]));
+	int s = 0, e = 0;
+	for (i = 0; i < segnum; i++) {
+		for (; (s < num) && (bystart[s].start <= starts[i]); s++)
+			BITSET_SET(active, bystart[s].idx);
+		for (; (e < num) && (byend[e].end <= starts[i]); e++)
+			BITSET_CLEAR(active, byend[e].idx);
+		di->first[i] = candsnum;
+		BITSET_FOREACH_SET(j, active, n) {
+			if (candsnum >= candsmax) {
+				candsmax = candsmax ? candsmax * 2 : 16;
+				di->cands = realloc(di->cands, candsmax * sizeof(di->cands[0]));
+			}
+			di->cands[candsnum++] = j;
+		}
+	}
+	di->first[segnum] = candsnum;
+
+	di->starts = starts;
+	di->segnum = segnum;
+
+	free(bystart);
+	free(byend);
+	free(active);
+}
+
+static struct rnndecdomainindex *get_domainindex(struct rnndeccontext *ctx,
+		struct rnndomain *domain)
+{
+	struct rnndecdomainindex *di;
+	struct hash_entry *entry;
+
+	if (!ctx->domains)
+		ctx->domains = _mesa_hash_table_create(NULL, _mesa_hash_pointer,
+				_mesa_key_pointer_equal);
+
+	entry = _mesa_hash_table_search(ctx->domains, domain);
+	if (entry) {
+		di = entry->data;
+		if (di->vargen != ctx->vargen)
+			build_domainindex(ctx, di, domain);
+	} else {
+		di = calloc(1, sizeof(*di));
+		build_domainindex(ctx, di, domain);
+		_mesa_hash_table_insert(ctx->domains, domain, di);
+	}
+
+	return di;
+}
+
+static struct rnndecaddrinfo *trymatch_domain(struct rnndeccontext *ctx,
+		struct rnndomain *domain, uint64_t addr, int write)
+{
+	struct rnndecdomainindex *di = get_domainindex(ctx, domain);
+	int lo, hi, i;
+
+	/* find the last segment starting at or before addr: */
+	lo = 0;
+	hi = di->segnum;
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (di->starts[mid] <= addr)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (!lo)
+		return NULL;
+
+	for (i = di->first[lo - 1]; i < di->first[lo]; i++) {
+		struct rnndecaddrinfo *res = trymatch(ctx, &domain->subelems[di->cands[i]], 1,
+				addr, write, domain->width, 0, 0);
+		if (res)
+			return res;
+	}
+
+	return NULL;
+}
+
+/*
+ * Register names are decoded for every register written, so the name of
+ * each register (in this context's color mode) is decoded once and kept
+ * in an intern table.  The returned names are stable for the lifetime of
+ * the context, so callers need neither free nor copy them.
+ */
+
+struct rnndecregkey {
+	struct rnndomain *domain;
+	uint64_t addr;
+	int write;
+};
+
+struct rnndecregname {
+	struct rnndecregkey key;
+	const char *name;
+	int valid;
+};
+
+static uint32_t hash_regkey(const void *key) {
+	return _mesa_hash_data(key, sizeof(struct rnndecregkey));
+}
+
+static bool regkey_equal(const void *a, const void *b) {
+	return !memcmp(a, b, sizeof(struct rnndecregkey));
+}
+
+static void free_regname(struct hash_entry *entry) {
+	free(entry->data);
+}
+
+static const char *intern(struct rnndeccontext *ctx, char *str) {
+	struct set_entry *entry;
+
+	if (!ctx->strings)
+		ctx->strings = _mesa_set_create(NULL, _mesa_hash_string,
+				_mesa_key_string_equal);
+
+	entry = _mesa_set_search(ctx->strings, str);
+	if (entry) {
+		free(str);
+		return entry->key;
+	}
+
+	_mesa_set_add(ctx->strings, str);
+	return str;
+}
+
+static struct rnndecregname *lookup_regname(struct rnndeccontext *ctx,
+		struct rnndomain *domain, uint64_t addr, int write)
+{
+	struct rnndecregname *rn;
+	struct rnndecaddrinfo *res;
+	struct hash_entry *entry;
+	struct rnndecregkey key;
+	char *name;
+
+	if (!ctx->regnames) {
+		ctx->regnames = _mesa_hash_table_create(NULL, hash_regkey,
+				regkey_equal);
+		ctx->regnamesgen = ctx->vargen;
+	} else if (ctx->regnamesgen != ctx->vargen) {
+		/* names can depend on the variant: */
+		_mesa_hash_table_clear(ctx->regnames, free_regname);
+		ctx->regnamesgen = ctx->vargen;
+	}
+
+	memset(&key, 0, sizeof(key));
+	key.domain = domain;
+	key.addr = addr;
+	key.write = write;
+
+	entry = _mesa_hash_table_search(ctx->regnames, &key);
+	if (entry)
+		return entry->data;
+
+	res = trymatch_domain(ctx, domain, addr, write);
 	if (res) {
-		free(res->name);
+		name = res->name;
 		free(res);
+	} else {
+		asprintf (&name, "%s%#"PRIx64"%s", ctx->colors->err, addr, ctx->colors->reset);
 	}
-	return res != NULL;
+
+	rn = calloc (sizeof *rn, 1);
+	rn->key = key;
+	rn->name = intern(ctx, name);
+	rn->valid = !!res;
+	_mesa_hash_table_insert(ctx->regnames, &rn->key, rn);
+
+	return rn;
+}
+
+const char *rnndec_regname(struct rnndeccontext *ctx, struct rnndomain *domain, uint64_t addr, int write) {
+	return lookup_regname(ctx, domain, addr, write)->name;
+}
+
+int rnndec_checkaddr(struct rnndeccontext *ctx, struct rnndomain *domain, uint64_t addr, int write) {
+	return lookup_regname(ctx, domain, addr, write)->valid;
 }
 
 struct rnndecaddrinfo *rnndec_decodeaddr(struct rnndeccontext *ctx, struct rnndomain *domain, uint64_t addr, int write) {
-	struct rnndecaddrinfo *res = trymatch(ctx, domain->subelems, domain->subelemsnum, addr, write, domain->width, 0, 0);
+	struct rnndecaddrinfo *res = trymatch_domain(ctx, domain, addr, write);
 	if (res)
 		return res;
 	res = calloc (sizeof *res, 1);
@@ -556,3 +1012,193 @@ uint64_t rnndec_decodereg(struct rnndeccontext *ctx, struct rnndomain *domain, c
 		return 0;
 	}
 }
+
+/*
+ * Index of the names of all the registers in a domain, and the names of
+ * their bitfields and enum values, sorted by name for prefix searches
+ * (ie. "which registers have a field starting with FOO?").  Like the
+ * domain index, what is in it depends on the variant, so it is built per
+ * context on first use, and rebuilt if the variant changes.
+ */
+
+struct rnndecnameindex {
+	unsigned vargen;
+	struct rnndecname *names;
+	int namesnum;
+	int namesmax;
+};
+
+static void addname(struct rnndecnameindex *ni, enum rnndecnamekind kind,
+		const char *name, uint64_t addr, const char *regname,
+		struct rnntypeinfo *typeinfo, struct rnnbitfield *bitfield,
+		struct rnnvalue *value)
+{
+	struct rnndecname n = {
+		.kind = kind,
+		.name = name,
+		.addr = addr,
+		.regname = regname,
+		.typeinfo = typeinfo,
+		.bitfield = bitfield,
+		.value = value,
+	};
+	ADDARRAY(ni->names, n);
+}
+
+static void addtypenames(struct rnndeccontext *ctx, struct rnndecnameindex *ni,
+		struct rnntypeinfo *ti, uint64_t addr, const char *regname,
+		struct rnntypeinfo *regti, struct rnnbitfield *bitfield)
+{
+	struct rnnbitfield **bitfields = NULL;
+	struct rnnvalue **vals = NULL;
+	int bitfieldsnum = 0, valsnum = 0;
+	int i;
+
+	switch (ti->type) {
+	case RNN_TTYPE_ENUM:
+		vals = ti->eenum->vals;
+		valsnum = ti->eenum->valsnum;
+		break;
+	case RNN_TTYPE_INLINE_ENUM:
+		vals = ti->vals;
+		valsnum = ti->valsnum;
+		break;
+	case RNN_TTYPE_BITSET:
+		bitfields = ti->ebitset->bitfields;
+		bitfieldsnum = ti->ebitset->bitfieldsnum;
+		break;
+	case RNN_TTYPE_INLINE_BITSET:
+		bitfields = ti->bitfields;
+		bitfieldsnum = ti->bitfieldsnum;
+		break;
+	default:
+		break;
+	}
+
+	for (i = 0; i < valsnum; i++) {
+		if (!rnndec_varmatch(ctx, &vals[i]->varinfo))
+			continue;
+		addname(ni, RNNDEC_NAME_VALUE, vals[i]->name, addr, regname,
+				regti, bitfield, vals[i]);
+	}
+
+	for (i = 0; i < bitfieldsnum; i++) {
+		if (!rnndec_varmatch(ctx, &bitfields[i]->varinfo))
+			continue;
+		addname(ni, RNNDEC_NAME_BITFIELD, bitfields[i]->name, addr, regname,
+				regti, bitfields[i], NULL);
+		addtypenames(ctx, ni, &bitfields[i]->typeinfo, addr, regname,
+				regti, bitfields[i]);
+	}
+}
+
+static int cmp_name(const void *a, const void *b) {
+	const struct rnndecname *na = a, *nb = b;
+	int ret = strcmp(na->name, nb->name);
+	if (ret)
+		return ret;
+	if (na->addr != nb->addr)
+		return na->addr < nb->addr ? -1 : 1;
+	return (int)na->kind - (int)nb->kind;
+}
+
+static void build_nameindex(struct rnndeccontext *ctx, struct rnndecnameindex *ni,
+		struct rnndomain *domain)
+{
+	struct rnndecdomainindex *di = get_domainindex(ctx, domain);
+	const struct envy_colors *colors = ctx->colors;
+	struct rnntypeinfo *lastti = NULL;
+	uint64_t lastend = 0;
+	int i, j;
+
+	free(ni->names);
+	memset(ni, 0, sizeof(*ni));
+	ni->vargen = ctx->vargen;
+
+	/* index the plain names, regardless of the context's color mode: */
+	ctx->colors = &envy_null_colors;
+
+	/* every address covered by a segment of the domain index, except the
+	 * last segment, which is either empty or unbounded:
+	 */
+	for (i = 0; i + 1 < di->segnum; i++) {
+		uint64_t addr;
+
+		if (di->first[i] == di->first[i + 1])
+			continue;
+
+		for (addr = di->starts[i]; addr < di->starts[i + 1]; addr++) {
+			struct rnndecaddrinfo *res = NULL;
+
+			for (j = di->first[i]; !res && j < di->first[i + 1]; j++)
+				res = trymatch(ctx, &domain->subelems[di->cands[j]], 1,
+						addr, 0, domain->width, 0, 0);
+			if (!res)
+				continue;
+
+			/* skip holes in arrays, and the remaining dwords of 64b
+			 * registers:
+			 */
+			if (res->typeinfo && !(res->typeinfo == lastti && addr < lastend)) {
+				const char *regname = intern(ctx, res->name);
+
+				addname(ni, RNNDEC_NAME_REG, regname, addr, regname,
+						res->typeinfo, NULL, NULL);
+				addtypenames(ctx, ni, res->typeinfo, addr, regname,
+						res->typeinfo, NULL);
+
+				lastti = res->typeinfo;
+				lastend = addr + MAX2(res->width / domain->width, 1);
+			} else {
+				free(res->name);
+			}
+			free(res);
+		}
+	}
+
+	ctx->colors = colors;
+
+	qsort(ni->names, ni->namesnum, sizeof(ni->names[0]), cmp_name);
+}
+
+int rnndec_findnames(struct rnndeccontext *ctx, struct rnndomain *domain,
+		const char *prefix, const struct rnndecname **names)
+{
+	struct rnndecnameindex *ni;
+	struct hash_entry *entry;
+	size_t len = strlen(prefix);
+	int lo, hi, end;
+
+	if (!ctx->names)
+		ctx->names = _mesa_hash_table_create(NULL, _mesa_hash_pointer,
+				_mesa_key_pointer_equal);
+
+	entry = _mesa_hash_table_search(ctx->names, domain);
+	if (entry) {
+		ni = entry->data;
+		if (ni->vargen != ctx->vargen)
+			build_nameindex(ctx, ni, domain);
+	} else {
+		ni = calloc(1, sizeof(*ni));
+		build_nameindex(ctx, ni, domain);
+		_mesa_hash_table_insert(ctx->names, domain, ni);
+	}
+
+	/* find the first name not sorting before the prefix: */
+	lo = 0;
+	hi = ni->namesnum;
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (strcmp(ni->names[mid].name, prefix) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	for (end = lo; end < ni->namesnum; end++)
+		if (strncmp(ni->names[end].name, prefix, len))
+			break;
+
+	*names = &ni->names[lo];
+	return end - lo;
+}
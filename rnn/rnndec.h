@@ -33,12 +33,25 @@ struct rnndecvariant {
 	int variant;
 };
 
+struct hash_table;
+struct set;
+
 struct rnndeccontext {
 	struct rnndb *db;
 	struct rnndecvariant **vars;
 	int varsnum;
 	int varsmax;
 	const struct envy_colors *colors;
+	/* lookup tables for enum decoding, built on first use: */
+	struct hash_table *enums;     /* name -> rnnenum */
+	struct hash_table *enumvals;  /* vals array -> rnndecenumvals */
+	unsigned vargen;              /* incremented when vars change */
+	/* decoded register names, see rnndec_regname(): */
+	struct hash_table *regnames;  /* domain/addr -> rnndecregname */
+	unsigned regnamesgen;
+	struct set *strings;          /* interned names */
+	struct hash_table *domains;   /* domain -> rnndecdomainindex */
+	struct hash_table *names;     /* domain -> rnndecnameindex */
 };
 
 struct rnndecaddrinfo {
@@ -54,6 +67,30 @@ const char *rnndec_decode_enum(struct rnndeccontext *ctx, const char *enumname,
 char *rnndec_decodeval(struct rnndeccontext *ctx, struct rnntypeinfo *ti, uint64_t value);
 int rnndec_checkaddr(struct rnndeccontext *ctx, struct rnndomain *domain, uint64_t addr, int write);
 struct rnndecaddrinfo *rnndec_decodeaddr(struct rnndeccontext *ctx, struct rnndomain *domain, uint64_t addr, int write);
+const char *rnndec_regname(struct rnndeccontext *ctx, struct rnndomain *domain, uint64_t addr, int write);
 uint64_t rnndec_decodereg(struct rnndeccontext *ctx, struct rnndomain *domain, const char *name);
 
+enum rnndecnamekind {
+	RNNDEC_NAME_REG,
+	RNNDEC_NAME_BITFIELD,
+	RNNDEC_NAME_VALUE,      /* enum value of the register or a bitfield */
+};
+
+struct rnndecname {
+	enum rnndecnamekind kind;
+	const char *name;
+	uint64_t addr;                  /* the register the name is found in */
+	const char *regname;
+	struct rnntypeinfo *typeinfo;   /* the register's type */
+	struct rnnbitfield *bitfield;   /* the bitfield, or the enum typed bitfield of a value */
+	struct rnnvalue *value;
+};
+
+/* Find the registers, bitfields and enum values in the domain with names
+ * starting with prefix.  Returns the number of matches, sorted by name,
+ * which stay valid until the context's variant changes:
+ */
+int rnndec_findnames(struct rnndeccontext *ctx, struct rnndomain *domain,
+		const char *prefix, const struct rnndecname **names);
+
 #endif
@@ -42,6 +42,15 @@
 	(a)[(a ## num)++] = (e); \
 	} while(0)
 
+/* give back the slack left over by ADDARRAY: */
+#define TRIMARRAY(a) \
+	do { \
+	if ((a ## max) > (a ## num)) { \
+		(a ## max) = (a ## num); \
+		(a) = realloc((a), (a ## max)*sizeof(*(a))); \
+	} \
+	} while(0)
+
 #define FINDARRAY(a, tmp, pred)				\
 	({							\
 		int __i;					\
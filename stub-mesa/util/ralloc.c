@@ -84,6 +84,11 @@ __declspec(align(16))
    struct ralloc_header *next;
 
    void (*destructor)(void *);
+
+   /* For linear contexts and their descendants, the linear parent that
+    * the descendants are sub-allocated from (see ralloc_linear_context).
+    */
+   void *linear;
 };
 
 typedef struct ralloc_header ralloc_header;
@@ -102,6 +107,15 @@ get_header(const void *ptr)
 
 #define PTR_FROM_HEADER(info) (((char *) info) + sizeof(ralloc_header))
 
+/* Is this a node sub-allocated from a linear context, rather than the
+ * context itself?
+ */
+static inline bool
+is_linear_child(ralloc_header *info)
+{
+   return info->parent != NULL && info->parent->linear != NULL;
+}
+
 static void
 add_child(ralloc_header *parent, ralloc_header *info)
 {
@@ -121,6 +135,66 @@ ralloc_context(const void *ctx)
    return ralloc_size(ctx, 0);
 }
 
+void *
+ralloc_linear_context(const void *ctx)
+{
+   void *ptr, *buffers;
+   ralloc_header *info;
+
+   assert(!ctx || !get_header(ctx)->linear);
+
+   ptr = ralloc_size(ctx, 0);
+   if (unlikely(ptr == NULL))
+      return NULL;
+
+   /* The linear buffers are ralloc'd from a separate child context, since
+    * anything allocated from the linear context itself is sub-allocated:
+    */
+   buffers = ralloc_context(ptr);
+   info = get_header(ptr);
+   info->linear = buffers ? linear_alloc_parent(buffers, 0) : NULL;
+   if (unlikely(info->linear == NULL)) {
+      ralloc_free(ptr);
+      return NULL;
+   }
+
+   return ptr;
+}
+
+/* Sub-allocate a node from a linear context.  The header is aligned the
+ * same as for a malloc'd node, and preceded by the size of the node, which
+ * is only needed by resize().
+ */
+static void *
+linear_ralloc_size(ralloc_header *parent, size_t size)
+{
+   ralloc_header *info;
+   char *block;
+
+   block = linear_alloc_child(parent->linear,
+                              sizeof(size_t) + alignof(ralloc_header) +
+                              sizeof(ralloc_header) + size);
+   if (unlikely(block == NULL))
+      return NULL;
+
+   info = (ralloc_header *) ALIGN_POT((uintptr_t)block + sizeof(size_t),
+                                      alignof(ralloc_header));
+   ((size_t *) info)[-1] = size;
+
+   info->parent = parent;
+   info->child = NULL;
+   info->prev = NULL;
+   info->next = NULL;
+   info->destructor = NULL;
+   info->linear = parent->linear;
+
+#ifndef NDEBUG
+   info->canary = CANARY;
+#endif
+
+   return PTR_FROM_HEADER(info);
+}
+
 void *
 ralloc_size(const void *ctx, size_t size)
 {
@@ -131,11 +205,15 @@ ralloc_size(const void *ctx, size_t size)
     *  - Allocations of a size that rounds up to a multiple of 8 bytes and
     *    not 16 bytes, are only required to have at least 8 byte alignment.
     */
-   void *block = malloc(align64(size + sizeof(ralloc_header),
-                                alignof(ralloc_header)));
+   ralloc_header *parent = ctx != NULL ? get_header(ctx) : NULL;
    ralloc_header *info;
-   ralloc_header *parent;
+   void *block;
 
+   if (parent != NULL && parent->linear != NULL)
+      return linear_ralloc_size(parent, size);
+
+   block = malloc(align64(size + sizeof(ralloc_header),
+                          alignof(ralloc_header)));
    if (unlikely(block == NULL))
       return NULL;
 
@@ -149,8 +227,7 @@ ralloc_size(const void *ctx, size_t size)
    info->prev = NULL;
    info->next = NULL;
    info->destructor = NULL;
-
-   parent = ctx != NULL ? get_header(ctx) : NULL;
+   info->linear = NULL;
 
    add_child(parent, info);
 
@@ -179,6 +256,16 @@ resize(void *ptr, size_t size)
    ralloc_header *child, *old, *info;
 
    old = get_header(ptr);
+
+   if (is_linear_child(old)) {
+      size_t old_size = ((size_t *) old)[-1];
+      void *new_ptr = linear_ralloc_size(old->parent, size);
+
+      if (likely(new_ptr != NULL))
+         memcpy(new_ptr, ptr, MIN2(old_size, size));
+      return new_ptr;
+   }
+
    info = realloc(old, align64(size + sizeof(ralloc_header),
                                alignof(ralloc_header)));
 
@@ -275,6 +362,11 @@ ralloc_free(void *ptr)
       return;
 
    info = get_header(ptr);
+
+   /* Linear children are only freed along with their linear context. */
+   if (is_linear_child(info))
+      return;
+
    unlink_block(info);
    unsafe_free(info);
 }
@@ -327,6 +419,9 @@ ralloc_steal(const void *new_ctx, void *ptr)
    info = get_header(ptr);
    parent = new_ctx ? get_header(new_ctx) : NULL;
 
+   assert(!is_linear_child(info));
+   assert(!parent || !parent->linear);
+
    unlink_block(info);
 
    add_child(parent, info);
@@ -343,6 +438,8 @@ ralloc_adopt(const void *new_ctx, void *old_ctx)
    old_info = get_header(old_ctx);
    new_info = get_header(new_ctx);
 
+   assert(!old_info->linear && !new_info->linear);
+
    /* If there are no children, bail. */
    if (unlikely(old_info->child == NULL))
       return;
@@ -377,6 +474,7 @@ void
 ralloc_set_destructor(const void *ptr, void(*destructor)(void *))
 {
    ralloc_header *info = get_header(ptr);
+   assert(!is_linear_child(info));
    info->destructor = destructor;
 }
 
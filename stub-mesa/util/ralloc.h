@@ -91,6 +91,20 @@ extern "C" {
  */
 void *ralloc_context(const void *ctx);
 
+/**
+ * Allocate a new linear ralloc context.
+ *
+ * This is a context for lots of small, short-lived allocations.  Everything
+ * allocated from it (or from its descendants) is sub-allocated from linear
+ * buffers, rather than malloc'd individually, and ralloc_free() of any of
+ * them is a no-op.  The memory is only released when the context itself is
+ * freed.
+ *
+ * Allocations from a linear context can't be stolen or have destructors,
+ * and the context can't be nested in another linear context.
+ */
+void *ralloc_linear_context(const void *ctx);
+
 /**
  * Allocate memory chained off of the given context.
  *
@@ -0,0 +1,344 @@
+/*
+ * Copyright © 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _U64_MAP_H
+#define _U64_MAP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/bitscan.h"
+#include "util/macros.h"
+#include "util/u_endian.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * An open addressing hash map from uint64_t keys (gpu addresses, register
+ * offsets, etc) to pointers, for when the boxed keys and hash/compare
+ * callbacks of hash_table_u64 are too much overhead.  Everything is inline,
+ * and the entries are stored in the table itself, so there is no allocation
+ * other than when the table grows.
+ *
+ * Besides the entries, the table has a control byte per slot, which is
+ * either empty, deleted, or holds 7 bits of the key's hash.  The slots are
+ * probed a group of 8 at a time, by matching the hash bits against all of
+ * the group's control bytes at once as a single 64-bit word, so that the
+ * keys themselves are only compared for likely matches.  The groups are
+ * probed in triangular order, which visits every group since the number of
+ * groups is a power of two.
+ *
+ * Any key, including 0, can be stored.  Pointers to entries are valid until
+ * the next insertion.
+ */
+
+#define U64_MAP_GROUP_SIZE 8
+
+#define U64_MAP_EMPTY   0x80
+#define U64_MAP_DELETED 0xfe
+
+struct u64_map_entry {
+   uint64_t key;
+   void *data;
+};
+
+struct u64_map {
+   uint8_t *ctrl;
+   struct u64_map_entry *entries;
+   uint32_t size;     /* number of slots, a multiple of the group size */
+   uint32_t entries_used;
+   uint32_t deleted_entries;
+};
+
+static inline void
+u64_map_init(struct u64_map *map)
+{
+   memset(map, 0, sizeof(*map));
+}
+
+static inline void
+u64_map_fini(struct u64_map *map)
+{
+   free(map->ctrl);
+   memset(map, 0, sizeof(*map));
+}
+
+static inline void
+u64_map_clear(struct u64_map *map)
+{
+   if (map->size)
+      memset(map->ctrl, U64_MAP_EMPTY, map->size);
+   map->entries_used = 0;
+   map->deleted_entries = 0;
+}
+
+static inline uint64_t
+u64_map_hash(uint64_t key)
+{
+   /* The finalizer from murmur3, since gpu addresses and register offsets
+    * mostly differ in their low-but-not-lowest bits:
+    */
+   key ^= key >> 33;
+   key *= 0xff51afd7ed558ccdull;
+   key ^= key >> 33;
+   key *= 0xc4ceb9fe1a85ec53ull;
+   key ^= key >> 33;
+   return key;
+}
+
+static inline uint64_t
+u64_map_load_group(const struct u64_map *map, uint32_t group)
+{
+   uint64_t word;
+   memcpy(&word, &map->ctrl[group * U64_MAP_GROUP_SIZE], sizeof(word));
+#if UTIL_ARCH_BIG_ENDIAN
+   word = __builtin_bswap64(word);
+#endif
+   return word;
+}
+
+#define U64_MAP_LSB 0x0101010101010101ull
+#define U64_MAP_MSB 0x8080808080808080ull
+
+/* Returns a mask with the top bit of each control byte that is equal to
+ * tag set.  There can be false positives (only for bytes following a real
+ * match), which are weeded out by comparing the keys.
+ */
+static inline uint64_t
+u64_map_match_tag(uint64_t group, uint8_t tag)
+{
+   uint64_t x = group ^ (U64_MAP_LSB * tag);
+   return (x - U64_MAP_LSB) & ~x & U64_MAP_MSB;
+}
+
+/* Empty is the only control byte with the top bit set and bit 1 clear: */
+static inline uint64_t
+u64_map_match_empty(uint64_t group)
+{
+   return group & ~(group << 6) & U64_MAP_MSB;
+}
+
+static inline uint64_t
+u64_map_match_free(uint64_t group)
+{
+   return group & U64_MAP_MSB;
+}
+
+static inline struct u64_map_entry *
+u64_map_search(const struct u64_map *map, uint64_t key)
+{
+   if (unlikely(!map->size))
+      return NULL;
+
+   uint64_t hash = u64_map_hash(key);
+   uint8_t tag = hash & 0x7f;
+   uint32_t mask = map->size / U64_MAP_GROUP_SIZE - 1;
+   uint32_t group = (hash >> 7) & mask;
+
+   for (uint32_t i = 1;; i++) {
+      uint64_t ctrl = u64_map_load_group(map, group);
+      uint64_t match = u64_map_match_tag(ctrl, tag);
+
+      while (match) {
+         uint32_t slot = group * U64_MAP_GROUP_SIZE + u_bit_scan64(&match) / 8;
+         if (likely(map->entries[slot].key == key))
+            return &map->entries[slot];
+      }
+
+      if (likely(u64_map_match_empty(ctrl)))
+         return NULL;
+
+      group = (group + i) & mask;
+   }
+}
+
+/* Find the first free slot for a key that is not in the table: */
+static inline uint32_t
+u64_map_find_free(const struct u64_map *map, uint64_t hash)
+{
+   uint32_t mask = map->size / U64_MAP_GROUP_SIZE - 1;
+   uint32_t group = (hash >> 7) & mask;
+
+   for (uint32_t i = 1;; i++) {
+      uint64_t match = u64_map_match_free(u64_map_load_group(map, group));
+
+      if (likely(match))
+         return group * U64_MAP_GROUP_SIZE + u_bit_scan64(&match) / 8;
+
+      group = (group + i) & mask;
+   }
+}
+
+static inline bool
+u64_map_rehash(struct u64_map *map, uint32_t new_size)
+{
+   struct u64_map old = *map;
+   uint8_t *ctrl;
+
+   ctrl = malloc(new_size * (1 + sizeof(struct u64_map_entry)));
+   if (unlikely(!ctrl))
+      return false;
+
+   /* The entries follow the control bytes, which keeps them aligned since
+    * the size is a multiple of 8:
+    */
+   map->ctrl = ctrl;
+   map->entries = (struct u64_map_entry *)&ctrl[new_size];
+   map->size = new_size;
+   u64_map_clear(map);
+
+   for (uint32_t i = 0; i < old.size; i++) {
+      if (old.ctrl[i] & 0x80)
+         continue;
+
+      uint64_t hash = u64_map_hash(old.entries[i].key);
+      uint32_t slot = u64_map_find_free(map, hash);
+
+      map->ctrl[slot] = hash & 0x7f;
+      map->entries[slot] = old.entries[i];
+   }
+   map->entries_used = old.entries_used;
+
+   free(old.ctrl);
+
+   return true;
+}
+
+/* Pre-size the table for the given number of entries. */
+static inline bool
+u64_map_reserve(struct u64_map *map, uint32_t count)
+{
+   uint32_t size = U64_MAP_GROUP_SIZE * 2;
+
+   /* Keep the load factor (including deleted entries) under 7/8, so that
+    * every probe sequence ends with an empty slot:
+    */
+   while (size - size / 8 <= count)
+      size *= 2;
+
+   if (size <= map->size)
+      return true;
+
+   return u64_map_rehash(map, size);
+}
+
+/* Returns the entry for key, inserting it (with NULL data) if it is not in
+ * the table yet.  Returns NULL if the table could not be grown.
+ */
+static inline struct u64_map_entry *
+u64_map_get(struct u64_map *map, uint64_t key)
+{
+   struct u64_map_entry *entry = u64_map_search(map, key);
+   if (entry)
+      return entry;
+
+   uint32_t used = map->entries_used + map->deleted_entries;
+   if (unlikely(used + 1 >= map->size - map->size / 8)) {
+      /* Grow if it is mostly live entries, otherwise just clean out the
+       * deleted ones:
+       */
+      uint32_t size = map->size;
+      if (map->entries_used + 1 >= size / 2)
+         size = size ? size * 2 : U64_MAP_GROUP_SIZE * 2;
+      if (unlikely(!u64_map_rehash(map, size)))
+         return NULL;
+   }
+
+   uint64_t hash = u64_map_hash(key);
+   uint32_t slot = u64_map_find_free(map, hash);
+
+   if (map->ctrl[slot] == U64_MAP_DELETED)
+      map->deleted_entries--;
+   map->ctrl[slot] = hash & 0x7f;
+   map->entries_used++;
+
+   entry = &map->entries[slot];
+   entry->key = key;
+   entry->data = NULL;
+
+   return entry;
+}
+
+static inline struct u64_map_entry *
+u64_map_insert(struct u64_map *map, uint64_t key, void *data)
+{
+   struct u64_map_entry *entry = u64_map_get(map, key);
+   if (likely(entry))
+      entry->data = data;
+   return entry;
+}
+
+static inline void *
+u64_map_lookup(const struct u64_map *map, uint64_t key)
+{
+   struct u64_map_entry *entry = u64_map_search(map, key);
+   return entry ? entry->data : NULL;
+}
+
+static inline void
+u64_map_remove_entry(struct u64_map *map, struct u64_map_entry *entry)
+{
+   uint32_t slot = entry - map->entries;
+
+   map->ctrl[slot] = U64_MAP_DELETED;
+   map->entries_used--;
+   map->deleted_entries++;
+}
+
+static inline void
+u64_map_remove(struct u64_map *map, uint64_t key)
+{
+   struct u64_map_entry *entry = u64_map_search(map, key);
+   if (entry)
+      u64_map_remove_entry(map, entry);
+}
+
+static inline struct u64_map_entry *
+u64_map_next_entry(const struct u64_map *map, struct u64_map_entry *entry)
+{
+   uint32_t slot = entry ? entry - map->entries + 1 : 0;
+
+   for (; slot < map->size; slot++)
+      if (!(map->ctrl[slot] & 0x80))
+         return &map->entries[slot];
+
+   return NULL;
+}
+
+/**
+ * This foreach is safe against removal, but not against insertion.
+ */
+#define u64_map_foreach(map, entry)                                     \
+   for (struct u64_map_entry *entry = u64_map_next_entry(map, NULL);    \
+        entry != NULL;                                                  \
+        entry = u64_map_next_entry(map, entry))
+
+#ifdef __cplusplus
+} /* extern C */
+#endif
+
+#endif /* _U64_MAP_H */
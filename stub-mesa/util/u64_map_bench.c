@@ -0,0 +1,391 @@
+/*
+ * Copyright © 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Microbenchmark of u64_map against hash_table_u64 and rb_tree, for the
+ * kinds of keys the decoders use.  Prints one line per measurement:
+ *
+ *   <keys> <map> <what> <ops> <msecs> <Mops/sec> <heap KiB>
+ *
+ * where heap is the growth in malloc'd memory over the measurement (or
+ * "-" where that can't be determined).
+ */
+
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#ifdef HAVE_MALLINFO2
+#include <malloc.h>
+#endif
+
+#include "util/hash_table.h"
+#include "util/rb_tree.h"
+#include "util/u64_map.h"
+
+static unsigned nkeys = 1 << 18;
+static unsigned passes = 4;
+
+/* Keep the results live, so the lookups are not optimized away: */
+static volatile uintptr_t sink;
+
+struct measurement {
+   struct timespec start;
+   size_t heap;
+};
+
+static size_t
+heap_used(void)
+{
+#ifdef HAVE_MALLINFO2
+   return mallinfo2().uordblks;
+#else
+   return 0;
+#endif
+}
+
+static void
+start(struct measurement *m)
+{
+   m->heap = heap_used();
+   clock_gettime(CLOCK_MONOTONIC, &m->start);
+}
+
+static void
+report(struct measurement *m, const char *keys, const char *map,
+       const char *what, uint64_t ops)
+{
+   struct timespec end;
+   clock_gettime(CLOCK_MONOTONIC, &end);
+   double ms = (end.tv_sec - m->start.tv_sec) * 1000.0 +
+               (end.tv_nsec - m->start.tv_nsec) / 1000000.0;
+   printf("%-8s %-10s %-8s %10" PRIu64 " %10.2f %10.2f ", keys, map, what,
+          ops, ms, ms > 0 ? ops / (ms * 1000.0) : 0.0);
+#ifdef HAVE_MALLINFO2
+   printf("%10ld\n", ((long)heap_used() - (long)m->heap) / 1024);
+#else
+   printf("%10s\n", "-");
+#endif
+}
+
+/*
+ * Key sets:
+ */
+
+static uint64_t
+gpuaddr_key(unsigned i)
+{
+   /* buffers of a few pages, scattered over a 48b address space (the low
+    * bits alone are unique, as long as there are less than 2^25 keys):
+    */
+   return ((uint64_t)((i * 2654435761u) & 0xff) << 40) +
+          0x100000000ull + (uint64_t)i * 0x5000;
+}
+
+static uint64_t
+regoff_key(unsigned i)
+{
+   /* dense, like register offsets: */
+   return i;
+}
+
+static const struct {
+   const char *name;
+   uint64_t (*key)(unsigned i);
+} keysets[] = {
+   { "gpuaddr", gpuaddr_key },
+   { "regoff", regoff_key },
+};
+
+/* The lookups are done in a shuffled order, so the rb_tree is not helped
+ * by walking the same path over and over:
+ */
+static uint64_t *
+make_keys(uint64_t (*key)(unsigned i), unsigned first, unsigned n)
+{
+   uint64_t *keys = malloc(n * sizeof(*keys));
+   uint64_t state = 1;
+
+   for (unsigned i = 0; i < n; i++)
+      keys[i] = key(first + i);
+
+   for (unsigned i = n - 1; i > 0; i--) {
+      state = state * 6364136223846793005ull + 1442695040888963407ull;
+      unsigned j = (state >> 33) % (i + 1);
+      uint64_t tmp = keys[i];
+      keys[i] = keys[j];
+      keys[j] = tmp;
+   }
+
+   return keys;
+}
+
+/*
+ * u64_map:
+ */
+
+static void
+bench_u64_map(const char *name, const uint64_t *keys, const uint64_t *misses)
+{
+   struct measurement m;
+   struct u64_map map;
+
+   u64_map_init(&map);
+
+   start(&m);
+   for (unsigned i = 0; i < nkeys; i++)
+      u64_map_insert(&map, keys[i], (void *)(uintptr_t)(i + 1));
+   report(&m, name, "u64_map", "insert", nkeys);
+
+   start(&m);
+   for (unsigned p = 0; p < passes; p++)
+      for (unsigned i = 0; i < nkeys; i++)
+         sink += (uintptr_t)u64_map_lookup(&map, keys[i]);
+   report(&m, name, "u64_map", "hit", (uint64_t)passes * nkeys);
+
+   start(&m);
+   for (unsigned p = 0; p < passes; p++)
+      for (unsigned i = 0; i < nkeys; i++)
+         sink += (uintptr_t)u64_map_lookup(&map, misses[i]);
+   report(&m, name, "u64_map", "miss", (uint64_t)passes * nkeys);
+
+   start(&m);
+   for (unsigned i = 0; i < nkeys; i += 2)
+      u64_map_remove(&map, keys[i]);
+   for (unsigned i = 0; i < nkeys; i += 2)
+      u64_map_insert(&map, keys[i], (void *)(uintptr_t)(i + 1));
+   report(&m, name, "u64_map", "churn", nkeys);
+
+   u64_map_fini(&map);
+}
+
+/*
+ * hash_table_u64:
+ */
+
+static void
+bench_hash_table(const char *name, const uint64_t *keys, const uint64_t *misses)
+{
+   struct measurement m;
+   struct hash_table_u64 *ht = _mesa_hash_table_u64_create(NULL);
+
+   start(&m);
+   for (unsigned i = 0; i < nkeys; i++)
+      _mesa_hash_table_u64_insert(ht, keys[i], (void *)(uintptr_t)(i + 1));
+   report(&m, name, "hash_table", "insert", nkeys);
+
+   start(&m);
+   for (unsigned p = 0; p < passes; p++)
+      for (unsigned i = 0; i < nkeys; i++)
+         sink += (uintptr_t)_mesa_hash_table_u64_search(ht, keys[i]);
+   report(&m, name, "hash_table", "hit", (uint64_t)passes * nkeys);
+
+   start(&m);
+   for (unsigned p = 0; p < passes; p++)
+      for (unsigned i = 0; i < nkeys; i++)
+         sink += (uintptr_t)_mesa_hash_table_u64_search(ht, misses[i]);
+   report(&m, name, "hash_table", "miss", (uint64_t)passes * nkeys);
+
+   start(&m);
+   for (unsigned i = 0; i < nkeys; i += 2)
+      _mesa_hash_table_u64_remove(ht, keys[i]);
+   for (unsigned i = 0; i < nkeys; i += 2)
+      _mesa_hash_table_u64_insert(ht, keys[i], (void *)(uintptr_t)(i + 1));
+   report(&m, name, "hash_table", "churn", nkeys);
+
+   _mesa_hash_table_u64_destroy(ht, NULL);
+}
+
+/*
+ * rb_tree, with the nodes embedded in the values like buffers.c does:
+ */
+
+struct rb_value {
+   struct rb_node node;
+   uint64_t key;
+   void *data;
+};
+
+static int
+rb_value_insert_cmp(const struct rb_node *n1, const struct rb_node *n2)
+{
+   const struct rb_value *v1 = (const struct rb_value *)n1;
+   const struct rb_value *v2 = (const struct rb_value *)n2;
+   if (v1->key < v2->key)
+      return -1;
+   return v1->key > v2->key;
+}
+
+static int
+rb_value_search_cmp(const struct rb_node *node, const void *keyptr)
+{
+   const struct rb_value *v = (const struct rb_value *)node;
+   uint64_t key = *(const uint64_t *)keyptr;
+   if (v->key < key)
+      return -1;
+   return v->key > key;
+}
+
+static void *
+rb_lookup(struct rb_tree *tree, uint64_t key)
+{
+   struct rb_value *v = (struct rb_value *)
+      rb_tree_search(tree, &key, rb_value_search_cmp);
+   return v ? v->data : NULL;
+}
+
+static void
+bench_rb_tree(const char *name, const uint64_t *keys, const uint64_t *misses)
+{
+   struct measurement m;
+   struct rb_tree tree;
+   struct rb_value *values;
+
+   rb_tree_init(&tree);
+
+   start(&m);
+   values = calloc(nkeys, sizeof(*values));
+   for (unsigned i = 0; i < nkeys; i++) {
+      values[i].key = keys[i];
+      values[i].data = (void *)(uintptr_t)(i + 1);
+      rb_tree_insert(&tree, &values[i].node, rb_value_insert_cmp);
+   }
+   report(&m, name, "rb_tree", "insert", nkeys);
+
+   start(&m);
+   for (unsigned p = 0; p < passes; p++)
+      for (unsigned i = 0; i < nkeys; i++)
+         sink += (uintptr_t)rb_lookup(&tree, keys[i]);
+   report(&m, name, "rb_tree", "hit", (uint64_t)passes * nkeys);
+
+   start(&m);
+   for (unsigned p = 0; p < passes; p++)
+      for (unsigned i = 0; i < nkeys; i++)
+         sink += (uintptr_t)rb_lookup(&tree, misses[i]);
+   report(&m, name, "rb_tree", "miss", (uint64_t)passes * nkeys);
+
+   start(&m);
+   for (unsigned i = 0; i < nkeys; i += 2)
+      rb_tree_remove(&tree, &values[i].node);
+   for (unsigned i = 0; i < nkeys; i += 2)
+      rb_tree_insert(&tree, &values[i].node, rb_value_insert_cmp);
+   report(&m, name, "rb_tree", "churn", nkeys);
+
+   free(values);
+}
+
+/* Check u64_map against hash_table_u64, so a broken map can't look fast: */
+static void
+check(const uint64_t *keys, const uint64_t *misses)
+{
+   struct hash_table_u64 *ht = _mesa_hash_table_u64_create(NULL);
+   struct u64_map map;
+   unsigned count = 0;
+
+   u64_map_init(&map);
+
+   for (unsigned i = 0; i < nkeys; i++) {
+      void *data = (void *)(uintptr_t)(i + 1);
+      u64_map_insert(&map, keys[i], data);
+      _mesa_hash_table_u64_insert(ht, keys[i], data);
+      if (i % 3 == 0) {
+         u64_map_remove(&map, keys[i / 2]);
+         _mesa_hash_table_u64_remove(ht, keys[i / 2]);
+      }
+   }
+
+   for (unsigned i = 0; i < nkeys; i++) {
+      if (u64_map_lookup(&map, keys[i]) !=
+          _mesa_hash_table_u64_search(ht, keys[i]) ||
+          u64_map_lookup(&map, misses[i])) {
+         fprintf(stderr, "u64_map mismatch for key %" PRIx64 "\n", keys[i]);
+         exit(1);
+      }
+   }
+
+   u64_map_foreach (&map, entry) {
+      if (_mesa_hash_table_u64_search(ht, entry->key) != entry->data) {
+         fprintf(stderr, "u64_map stray key %" PRIx64 "\n", entry->key);
+         exit(1);
+      }
+      count++;
+   }
+
+   if (count != map.entries_used) {
+      fprintf(stderr, "u64_map has %u entries, expected %u\n", count,
+              map.entries_used);
+      exit(1);
+   }
+
+   u64_map_fini(&map);
+   _mesa_hash_table_u64_destroy(ht, NULL);
+}
+
+static void
+usage(const char *name)
+{
+   fprintf(stderr, "usage: %s [-k KEYS] [-p PASSES]\n", name);
+   exit(2);
+}
+
+int
+main(int argc, char **argv)
+{
+   int c;
+
+   while ((c = getopt(argc, argv, "k:p:")) != -1) {
+      switch (c) {
+      case 'k':
+         nkeys = strtoul(optarg, NULL, 0);
+         break;
+      case 'p':
+         passes = strtoul(optarg, NULL, 0);
+         break;
+      default:
+         usage(argv[0]);
+      }
+   }
+
+   if (nkeys < 2 || nkeys >= (1 << 25))
+      usage(argv[0]);
+
+   printf("%-8s %-10s %-8s %10s %10s %10s %10s\n", "keys", "map", "what",
+          "ops", "msecs", "Mops/sec", "heap KiB");
+
+   for (unsigned k = 0; k < ARRAY_SIZE(keysets); k++) {
+      uint64_t *keys = make_keys(keysets[k].key, 0, nkeys);
+      uint64_t *misses = make_keys(keysets[k].key, nkeys, nkeys);
+
+      check(keys, misses);
+
+      bench_u64_map(keysets[k].name, keys, misses);
+      bench_hash_table(keysets[k].name, keys, misses);
+      bench_rb_tree(keysets[k].name, keys, misses);
+
+      free(keys);
+      free(misses);
+   }
+
+   return 0;
+}